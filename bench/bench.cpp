@@ -0,0 +1,944 @@
+#include "bench.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/batch.h"
+#include "../src/blocktexture.h"
+#include "../src/bvh.h"
+#include "../src/countingallocator.h"
+#include "../src/cpu.h"
+#include "../src/framestream.h"
+#include "../src/geometry.h"
+#include "../src/gl.h"
+#include "../src/imagecompare.h"
+#include "../src/lod.h"
+#include "../src/meshlet.h"
+#include "../src/model.h"
+#include "../src/paged.h"
+#include "../src/raycast.h"
+#include "../src/scene.h"
+#include "../src/texturecache.h"
+#include "../src/tgaimage.h"
+
+const int VECTORS = 4096;
+const int MATRICES = 10000;
+const int INVERSES = 1000;
+const int BATCH_VERTICES = 1 << 20;
+const int BVH_QUERIES = 4096;
+const int TEXTURE_SAMPLES = 1 << 16;
+const int OUTPUT_VIEWS = 8;
+const int FRAME_SIZES[] = {256, 512, 700, 1024};
+
+static Matrix sampleMatrix(float seed) {
+  Matrix m(4, 4);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      m(i, j) = (i == j ? 2.f : 0.f) + std::sin(seed + i * 4 + j) * 0.5f;
+    }
+  }
+  return m;
+}
+
+static std::vector<Vec3f> sampleVectors() {
+  std::vector<Vec3f> vectors;
+  for (int i = 0; i < VECTORS; i++) {
+    vectors.push_back(Vec3f(std::sin(i * 0.1f), std::cos(i * 0.7f) + 1.5f,
+                            std::sin(i * 1.3f) * 2.f));
+  }
+  return vectors;
+}
+
+static void benchGeometry(BenchSuite& suite) {
+  Matrix a = sampleMatrix(0.f);
+  Matrix b = sampleMatrix(1.f);
+
+  suite.micro("matrix.multiply4x4", MATRICES, [&] {
+    for (int i = 0; i < MATRICES; i++) {
+      Matrix c = a * b;
+      keep(c(0, 0));
+    }
+  });
+
+  suite.micro("matrix.inverse4x4", INVERSES, [&] {
+    for (int i = 0; i < INVERSES; i++) {
+      Matrix inverse(4, 4);
+      a.inverse(inverse);
+      keep(inverse(0, 0));
+    }
+  });
+
+  suite.micro("matrix.vec4Transform", MATRICES, [&] {
+    Vec4f v(0.3f, 0.2f, 0.1f, 1.f);
+    for (int i = 0; i < MATRICES; i++) {
+      Vec4f result = a * Matrix(v);
+      keep(result);
+    }
+  });
+
+  std::vector<Vec3f> vectors = sampleVectors();
+
+  suite.micro("vec3.dot", VECTORS, [&] {
+    float sum = 0.f;
+    for (int i = 0; i + 1 < VECTORS; i++) sum += vectors[i] * vectors[i + 1];
+    keep(sum);
+  });
+
+  suite.micro("vec3.cross", VECTORS, [&] {
+    Vec3f sum;
+    for (int i = 0; i + 1 < VECTORS; i++) {
+      sum = sum + (vectors[i] ^ vectors[i + 1]);
+    }
+    keep(sum);
+  });
+
+  suite.micro("vec3.normalize", VECTORS, [&] {
+    Vec3f sum;
+    for (int i = 0; i < VECTORS; i++) {
+      Vec3f v = vectors[i];
+      sum = sum + v.normalize();
+    }
+    keep(sum);
+  });
+
+  suite.micro("vec3.normalizeFast", VECTORS, [&] {
+    Vec3f sum;
+    for (int i = 0; i < VECTORS; i++) {
+      Vec3f v = vectors[i];
+      sum = sum + v.normalizeFast();
+    }
+    keep(sum);
+  });
+
+  suite.micro("vec3.lerpMinMax", VECTORS, [&] {
+    Vec3f low = vectors[0], high = vectors[0];
+    for (int i = 0; i + 1 < VECTORS; i++) {
+      Vec3f v = lerp(vectors[i], vectors[i + 1], 0.25f);
+      low = componentMin(low, v);
+      high = componentMax(high, v);
+    }
+    keep(low);
+    keep(high);
+  });
+
+  suite.micro("vec4.addScale", VECTORS, [&] {
+    Vec4f sum;
+    for (int i = 0; i < VECTORS; i++) {
+      sum = sum + Vec4f(vectors[i], 1.f) * 0.5f;
+    }
+    keep(sum);
+  });
+}
+
+static void benchVertices(BenchSuite& suite) {
+  Matrix m = sampleMatrix(2.f);
+  Vec3SoA points;
+  for (int i = 0; i < BATCH_VERTICES; i++) {
+    points.push_back(Vec3f(std::sin(i * 0.1f), std::cos(i * 0.7f),
+                           std::sin(i * 1.3f)));
+  }
+  Vec4SoA clip;
+  Vec3SoA screen;
+  Matrix viewport = Matrix::identity(4);
+
+  suite.micro("vertex.perVertex", BATCH_VERTICES, [&] {
+    for (int i = 0; i < BATCH_VERTICES; i++) {
+      Vec4f v = m * Matrix(Vec4f(points[i], 1.f));
+      keep(v);
+    }
+  });
+
+  suite.micro("vertex.transformBatch", BATCH_VERTICES, [&] {
+    transformBatch(m, points, 1.f, clip);
+    keep(clip.x[0]);
+  });
+
+  suite.micro("vertex.transformBatch.parallel", BATCH_VERTICES, [&] {
+    transformBatch(m, points, 1.f, clip, 0);
+    keep(clip.x[0]);
+  });
+
+  suite.micro("vertex.projectBatch", BATCH_VERTICES, [&] {
+    projectBatch(clip, viewport, screen);
+    keep(screen.x[0]);
+  });
+}
+
+static void benchRaster(BenchSuite& suite) {
+  Vec3f triangle[3] = {Vec3f(10.f, 10.f, 0.f), Vec3f(240.f, 40.f, 0.f),
+                       Vec3f(90.f, 230.f, 0.f)};
+  const int side = 256;
+
+  suite.micro("raster.getBarycentric", side * side, [&] {
+    int inside = 0;
+    Vec3i P;
+    for (P.y = 0; P.y < side; P.y++) {
+      for (P.x = 0; P.x < side; P.x++) {
+        Vec4f bar = getBarycentric(triangle, P);
+        inside += bar.x >= 0.f && bar.y >= 0.f && bar.z >= 0.f;
+      }
+    }
+    keep(inside);
+  });
+
+  // the same triangle through every kernel build the cpu can run
+  RasterTriangle kernelTriangle = {10.f, 10.f, 190.f / 40700.f,
+                                   -80.f / 40700.f, -30.f / 40700.f,
+                                   230.f / 40700.f, 10.f, 20.f, 30.f};
+  std::vector<float> depth(side);
+  std::vector<int> xs(side);
+  std::vector<float> bars(side * 3);
+
+  for (int path = CPU_SCALAR; path < CPU_PATH_COUNT; path++) {
+    std::string name = std::string("raster.row.") + cpuPathName((CpuPath)path);
+    if (!suite.selected(name) || !selectCpuPath((CpuPath)path)) continue;
+
+    RasterRowKernel rasterRow = kernels().rasterRow;
+    suite.micro(name, side * side, [&] {
+      int fragments = 0;
+      for (int y = 0; y < side; y++) {
+        std::fill(depth.begin(), depth.end(), -1e9f);
+        fragments += rasterRow(&kernelTriangle, y, 0, side, depth.data(),
+                               xs.data(), bars.data());
+      }
+      keep(fragments);
+    });
+  }
+  selectCpuPath(bestCpuPath());
+}
+
+static void benchLoading(BenchSuite& suite, const std::string& modelFile) {
+  if (!suite.selected("load.tgaDecode") && !suite.selected("load.tgaCached") &&
+      !suite.selected("load.objParse")) {
+    return;
+  }
+
+  std::string base = modelFile.substr(0, modelFile.find_last_of("."));
+  std::string diffuse = base + "_diffuse.tga";
+
+  long texels;
+  {
+    Silence silence;
+    TGAImage probe;
+    probe.read_tga_file(diffuse.c_str());
+    texels = (long)probe.get_width() * probe.get_height();
+  }
+
+  suite.micro("load.tgaDecode", texels, [&] {
+    TGAImage image;
+    image.read_tga_file(diffuse.c_str());
+    keep(image);
+  });
+
+  // a hit by path only checks the file size and time
+  TextureCache cache;
+  {
+    Silence silence;
+    cache.load(diffuse);
+  }
+  suite.micro("load.tgaCached", texels, [&] { keep(cache.load(diffuse)); });
+
+  // a copy with no textures next to it so only the obj is parsed
+  std::filesystem::path copy =
+      std::filesystem::temp_directory_path() / "tinyrenderer_bench.obj";
+  std::filesystem::copy_file(
+      modelFile, copy, std::filesystem::copy_options::overwrite_existing);
+
+  long faces;
+  {
+    Silence silence;
+    faces = Model(copy.string().c_str()).nfaces();
+  }
+
+  suite.micro("load.objParse", faces, [&] {
+    Model model(copy.string().c_str());
+    keep(model);
+  });
+
+  std::filesystem::remove(copy);
+}
+
+// the chunk parallel parser by thread count, on a generated height field
+// large enough to split into many chunks: faces per second over threads is
+// the scaling curve
+static void benchParseThreads(BenchSuite& suite) {
+  const int THREADS[] = {1, 2, 4, 8, 16, 32};
+  const int SIDE = 400;
+  if (!suite.selected("load.objParse.large")) return;
+
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "tinyrenderer_large.obj";
+  {
+    std::ofstream obj(path);
+    for (int z = 0; z <= SIDE; z++) {
+      for (int x = 0; x <= SIDE; x++) {
+        float u = (float)x / SIDE, v = (float)z / SIDE;
+        obj << "v " << u << " " << std::sin(u * 9.f) * v << " " << v << "\n"
+            << "vt " << u << " " << v << "\nvn 0 1 0\n";
+      }
+    }
+    for (int z = 0; z < SIDE; z++) {
+      for (int x = 0; x < SIDE; x++) {
+        int a = z * (SIDE + 1) + x + 1;
+        int c = a + SIDE + 1;
+        obj << "f " << a << "/" << a << "/" << a << " " << a + 1 << "/"
+            << a + 1 << "/" << a + 1 << " " << c << "/" << c << "/" << c
+            << "\n";
+      }
+    }
+  }
+
+  for (int threads : THREADS) {
+    std::string name =
+        "load.objParse.large.threads" + std::to_string(threads);
+    suite.micro(name, SIDE * SIDE, [&] {
+      Model model(path.string().c_str(), true, threads);
+      keep(model);
+    });
+  }
+
+  std::filesystem::remove(path);
+}
+
+// build time serial and across cores, then ray and nearest point queries
+// around the model as picking would ask them
+static void benchBvh(BenchSuite& suite, Model& model) {
+  bool any = false;
+  for (const char* name :
+       {"bvh.build", "bvh.buildParallel", "bvh.intersect", "bvh.nearestFace",
+        "bvh.cameraRays", "bvh.cameraPackets"}) {
+    any = any || suite.selected(name);
+  }
+  if (!any) return;
+
+  suite.micro("bvh.build", model.nfaces(), [&] {
+    Bvh bvh;
+    bvh.build(model, 1);
+    keep(bvh);
+  });
+
+  suite.micro("bvh.buildParallel", model.nfaces(), [&] {
+    Bvh bvh;
+    bvh.build(model, 0);
+    keep(bvh);
+  });
+
+  Bvh bvh;
+  bvh.build(model, 0);
+
+  // rays from a sphere around the head towards points near its middle, most
+  // of them hit
+  std::vector<Vec3f> origins;
+  std::vector<Vec3f> targets;
+  for (int i = 0; i < BVH_QUERIES; i++) {
+    float yaw = i * 2.39996f;  // golden angle
+    float pitch = std::asin(2.f * (i + 0.5f) / BVH_QUERIES - 1.f);
+    origins.push_back(Vec3f(std::cos(pitch) * std::cos(yaw),
+                            std::sin(pitch), std::cos(pitch) * std::sin(yaw)) *
+                      3.f);
+    targets.push_back(Vec3f(std::sin(i * 0.7f), std::sin(i * 1.1f),
+                            std::sin(i * 1.9f)) *
+                      0.3f);
+  }
+
+  suite.micro("bvh.intersect", BVH_QUERIES, [&] {
+    int hits = 0;
+    for (int i = 0; i < BVH_QUERIES; i++) {
+      RayHit hit;
+      hits += bvh.intersect(origins[i], targets[i] - origins[i], hit);
+    }
+    keep(hits);
+  });
+
+  suite.micro("bvh.nearestFace", BVH_QUERIES, [&] {
+    int sum = 0;
+    for (int i = 0; i < BVH_QUERIES; i++) {
+      Vec3f closest;
+      sum += bvh.nearestFace(origins[i] * 0.5f, closest);
+    }
+    keep(sum);
+  });
+
+  // coherent rays of a 64x64 pixel camera, one at a time and as 2x2 packets
+  const int side = 64;
+  Vec3f eye(0.f, 0.f, 3.f);
+  std::vector<Vec3f> pixels;
+  for (int y = 0; y < side; y += 2) {
+    for (int x = 0; x < side; x += 2) {
+      for (int lane = 0; lane < 4; lane++) {
+        pixels.push_back(Vec3f((x + (lane & 1)) * 2.f / side - 1.f,
+                               (y + (lane >> 1)) * 2.f / side - 1.f, 0.f) -
+                         eye);
+      }
+    }
+  }
+
+  suite.micro("bvh.cameraRays", side * side, [&] {
+    int hits = 0;
+    for (const Vec3f& direction : pixels) {
+      RayHit hit;
+      hits += bvh.intersect(eye, direction, hit);
+    }
+    keep(hits);
+  });
+
+  suite.micro("bvh.cameraPackets", side * side, [&] {
+    int hits = 0;
+    for (int i = 0; i < side * side; i += 4) {
+      RayPacket packet;
+      for (int lane = 0; lane < 4; lane++) {
+        packet.set(lane, eye, pixels[i + lane]);
+      }
+      RayHit packetHits[4];
+      hits += bvh.intersectPacket(packet, packetHits);
+    }
+    keep(hits);
+  });
+}
+
+// 2x2 box filter, src twice the size of dst, both BGRA
+static void downsample2x(TGAImage& src, TGAImage& dst) {
+  const unsigned char* in = src.buffer();
+  unsigned char* out = dst.buffer();
+  int width = dst.get_width();
+  int srcRow = src.get_width() * 4;
+
+  for (int y = 0; y < dst.get_height(); y++) {
+    for (int x = 0; x < width; x++) {
+      const unsigned char* p = in + y * 2 * srcRow + x * 8;
+      for (int c = 0; c < 4; c++) {
+        out[(x + y * width) * 4 + c] =
+            (p[c] + p[c + 4] + p[srcRow + c] + p[srcRow + c + 4] + 2) >> 2;
+      }
+    }
+  }
+}
+
+struct ShadingRateCase {
+  const char* name;
+  int rate;
+  int threshold;
+};
+
+// coarse shading against full rate, with how many fragments it still shaded
+// and how far the image moved
+static void benchShadingRates(BenchSuite& suite, Model& model,
+                              const CameraPose& pose) {
+  const ShadingRateCase CASES[] = {
+      {"frame.africanHead.512.rate2", 2, 0},
+      {"frame.africanHead.512.rate4", 4, 0},
+      {"frame.africanHead.512.rate2.var", 2, 12},
+      {"frame.africanHead.512.rate4.var", 4, 12},
+  };
+
+  RenderContext full(512, 512);
+  full.model = &model;
+  bool rendered = false;
+
+  for (const ShadingRateCase& rateCase : CASES) {
+    if (!suite.selected(rateCase.name)) continue;
+
+    if (!rendered) {
+      renderView(full, pose, Vec3f(1., 1., 1.));
+      rendered = true;
+    }
+
+    RenderContext ctx(512, 512);
+    ctx.model = &model;
+    ctx.shadingRate = rateCase.rate;
+    ctx.rateThreshold = rateCase.threshold;
+
+    suite.frame(rateCase.name, 1,
+                [&] { renderView(ctx, pose, Vec3f(1., 1., 1.)); });
+
+    ImageDiff diff = compareImages(ctx.framebuffer, full.framebuffer, 8);
+    char line[160];
+    snprintf(line, sizeof(line),
+             "  %.1f%% of the full rate fragment shades, psnr %.2f dB, "
+             "%.2f%% pixels off by more than 8\n",
+             100. * ctx.stats.fragmentsShaded / full.stats.fragmentsShaded,
+             diff.psnr, diff.mismatchedFraction() * 100.);
+    std::cout << line;
+  }
+}
+
+struct RaycastCase {
+  const char* name;
+  bool shadows;
+  int occlusionRays;
+};
+
+// the ray caster on the frame the rasterizer draws, items are rays so the
+// rate is rays per second
+static void benchRaycast(BenchSuite& suite, Model& model,
+                         const CameraPose& pose) {
+  const RaycastCase CASES[] = {
+      {"ray.africanHead.512", false, 0},
+      {"ray.africanHead.512.shadows", true, 0},
+      {"ray.africanHead.512.ao16", true, 16},
+  };
+
+  Bvh bvh;
+
+  for (const RaycastCase& rayCase : CASES) {
+    if (!suite.selected(rayCase.name)) continue;
+    if (bvh.empty()) bvh.build(model, 0);
+
+    RaycastOptions options;
+    options.shadows = rayCase.shadows;
+    options.occlusionRays = rayCase.occlusionRays;
+
+    RenderContext ctx(512, 512);
+    ctx.model = &model;
+
+    // the rays of a frame do not change, count them once
+    raycastView(ctx, bvh, pose, Vec3f(1., 1., 1.), options);
+    long rays = ctx.stats.cameraRays + ctx.stats.secondaryRays;
+
+    suite.frame(rayCase.name, std::max(rays, 1L), [&] {
+      raycastView(ctx, bvh, pose, Vec3f(1., 1., 1.), options);
+    });
+  }
+}
+
+// every level of detail drawn on its own at a size where it would be picked
+// for a 1 pixel error, items are its triangles. Then the 64 copy crowd with
+// each copy picking its level
+static void benchLods(BenchSuite& suite, Model& model, const CameraPose& pose) {
+  LodChain chain;
+  if (suite.selected("lod.build")) {
+    suite.micro("lod.build", model.nfaces(), [&] {
+      buildLods(model, chain);
+      keep(chain);
+    });
+  }
+
+  for (int level = 0; level < LOD_LEVELS; level++) {
+    std::string name = "frame.africanHead.128.lod" + std::to_string(level);
+    if (!suite.selected(name)) continue;
+
+    if (!chain.source) buildLods(model, chain);
+    if (level >= chain.levelCount()) continue;
+
+    RenderContext ctx(128, 128);
+    ctx.model = chain.level(level);
+
+    suite.frame(name, ctx.model->nfaces(),
+                [&] { renderView(ctx, pose, Vec3f(1., 1., 1.)); });
+  }
+
+  if (suite.selected("frame.crowd.512.x64.lod")) {
+    if (!chain.source) buildLods(model, chain);
+
+    Scene scene = crowdScene(&model, 64);
+    scene.meshes[0].lods = &chain;
+    RenderContext ctx(512, 512);
+
+    suite.frame("frame.crowd.512.x64.lod", scene.triangleCount(),
+                [&] { renderScene(ctx, scene, pose, Vec3f(1., 1., 1.)); });
+  }
+}
+
+// meshlet culling against the bvh one on the same frames, items are the
+// triangles of the scene. .backfaces also drops the meshlets facing away,
+// .threads1 keeps their vertex stage on one thread
+static void benchMeshlets(BenchSuite& suite, Model& model,
+                          const CameraPose& pose, const CameraPose& corner) {
+  Meshlets meshlets;
+  if (suite.selected("meshlets.build")) {
+    suite.micro("meshlets.build", model.nfaces(), [&] {
+      meshlets.build(model);
+      keep(meshlets);
+    });
+  }
+
+  struct MeshletCase {
+    const char* name;
+    int instances;  // 0 = the model alone
+    bool corner;
+    bool backfaces;
+    int threads;
+  };
+  const MeshletCase CASES[] = {
+      {"frame.africanHead.512.meshlets", 0, false, false, 0},
+      {"frame.africanHead.512.meshlets.backfaces", 0, false, true, 0},
+      {"frame.crowd.512.x64.meshlets", 64, false, false, 0},
+      {"frame.crowd.512.x64.meshlets.threads1", 64, false, false, 1},
+      {"frame.crowd.512.x64.meshlets.backfaces", 64, false, true, 0},
+      {"frame.crowd.512.x64.corner.meshlets", 64, true, false, 0},
+  };
+
+  for (const MeshletCase& meshletCase : CASES) {
+    if (!suite.selected(meshletCase.name)) continue;
+    if (meshlets.empty()) meshlets.build(model);
+
+    RenderContext ctx(512, 512);
+    ctx.model = &model;
+    ctx.meshlets = &meshlets;
+    ctx.cullBackfaces = meshletCase.backfaces;
+    ctx.meshletThreads = meshletCase.threads;
+    const CameraPose& view = meshletCase.corner ? corner : pose;
+
+    if (meshletCase.instances == 0) {
+      suite.frame(meshletCase.name, model.nfaces(),
+                  [&] { renderView(ctx, view, Vec3f(1., 1., 1.)); });
+      continue;
+    }
+
+    Scene scene = crowdScene(&model, meshletCase.instances);
+    scene.meshes[0].meshlets = &meshlets;
+    suite.frame(meshletCase.name, scene.triangleCount(),
+                [&] { renderScene(ctx, scene, view, Vec3f(1., 1., 1.)); });
+  }
+}
+
+// the maps sampled as decoded texels and block compressed, items are
+// samples. Coherent ones walk a corner of the uv square in rows about a
+// texel apart like a rasterized triangle would, random ones jump anywhere
+// and mostly miss the decoded block cache. Then the frame with compressed
+// maps, and what they cost in memory and quality
+static void benchTextures(BenchSuite& suite, const std::string& modelFile) {
+  const char* NAMES[] = {
+      "texture.sample.diffuse",        "texture.sample.diffuse.bc1",
+      "texture.sample.diffuse.random", "texture.sample.diffuse.bc1.random",
+      "texture.sample.normal",         "texture.sample.normal.bc5",
+      "frame.africanHead.512.compressed"};
+  if (!std::any_of(std::begin(NAMES), std::end(NAMES),
+                   [&](const char* name) { return suite.selected(name); })) {
+    return;
+  }
+
+  std::unique_ptr<Model> plain, compressed;
+  {
+    Silence silence;
+    plain.reset(new Model(modelFile.c_str()));
+    compressed.reset(new Model(modelFile.c_str()));
+  }
+  size_t decodedBytes = compressed->textureBytes();
+  compressed->compressTextures();
+
+  std::vector<Vec2f> rows, scattered;
+  int side = 1;
+  while (side * side < TEXTURE_SAMPLES) side++;
+  for (int i = 0; i < TEXTURE_SAMPLES; i++) {
+    rows.push_back(Vec2f((i % side + 0.5f) / (4 * side),
+                         (i / side + 0.5f) / (4 * side)));
+  }
+  unsigned seed = 1;
+  for (int i = 0; i < TEXTURE_SAMPLES; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    float u = (seed >> 8) / 16777216.f;
+    seed = seed * 1664525u + 1013904223u;
+    scattered.push_back(Vec2f(u, (seed >> 8) / 16777216.f));
+  }
+
+  struct SampleCase {
+    const char* name;
+    Model* model;
+    const std::vector<Vec2f>* uvs;
+    bool normals;
+  };
+  const SampleCase CASES[] = {
+      {NAMES[0], plain.get(), &rows, false},
+      {NAMES[1], compressed.get(), &rows, false},
+      {NAMES[2], plain.get(), &scattered, false},
+      {NAMES[3], compressed.get(), &scattered, false},
+      {NAMES[4], plain.get(), &rows, true},
+      {NAMES[5], compressed.get(), &rows, true},
+  };
+
+  for (const SampleCase& sampleCase : CASES) {
+    if (!suite.selected(sampleCase.name)) continue;
+
+    long hits, misses;
+    BlockTexture::cacheCounters(hits, misses);
+    suite.micro(sampleCase.name, TEXTURE_SAMPLES, [&] {
+      int sum = 0;
+      for (const Vec2f& uv : *sampleCase.uvs) {
+        if (sampleCase.normals) {
+          sum += sampleCase.model->getNormal(uv).z > 0.f;
+        } else {
+          sum += sampleCase.model->getDiffuse(uv).bgra[1];
+        }
+      }
+      keep(sum);
+    });
+
+    if (sampleCase.model != compressed.get()) continue;
+    long hitsAfter, missesAfter;
+    BlockTexture::cacheCounters(hitsAfter, missesAfter);
+    char line[120];
+    snprintf(line, sizeof(line), "  %.1f%% decoded block cache hits\n",
+             100. * (hitsAfter - hits) /
+                 std::max(1L, hitsAfter - hits + missesAfter - misses));
+    std::cout << line;
+  }
+
+  CameraPose pose;
+  pose.eye = Vec3f(1, 1, 3);
+  pose.center = Vec3f(0, 0, 0);
+  if (suite.selected(NAMES[6])) {
+    RenderContext full(512, 512);
+    full.model = plain.get();
+    renderView(full, pose, Vec3f(1., 1., 1.));
+
+    RenderContext ctx(512, 512);
+    ctx.model = compressed.get();
+    suite.frame(NAMES[6], 1,
+                [&] { renderView(ctx, pose, Vec3f(1., 1., 1.)); });
+
+    ImageDiff diff = compareImages(ctx.framebuffer, full.framebuffer, 8);
+    char line[120];
+    snprintf(line, sizeof(line), "  frame psnr %.2f dB against decoded maps\n",
+             diff.psnr);
+    std::cout << line;
+  }
+
+  // each compressed map against its source
+  std::string base = modelFile.substr(0, modelFile.find_last_of("."));
+  double psnr[2] = {0., 0.};
+  const char* SUFFIXES[] = {"_diffuse.tga", "_nm_tangent.tga"};
+  for (int i = 0; i < 2; i++) {
+    Silence silence;
+    TGAImage source;
+    if (!source.read_tga_file((base + SUFFIXES[i]).c_str())) continue;
+    BlockTexture blocks(source, i == 0 ? BLOCK_BC1 : BLOCK_BC5);
+    TGAImage decoded = blocks.decode();
+    psnr[i] = compareImages(decoded, source, 8).psnr;
+  }
+
+  char line[160];
+  snprintf(line, sizeof(line),
+           "  maps %.1f MB decoded, %.1f MB compressed | psnr bc1 %.2f dB, "
+           "bc5 %.2f dB\n",
+           decodedBytes / 1048576., compressed->textureBytes() / 1048576.,
+           psnr[0], psnr[1]);
+  std::cout << line;
+}
+
+// out of core: the conversion, then frames with every chunk resident and
+// with a budget that pages the chunks in view in again every frame
+static void benchPaged(BenchSuite& suite, const std::string& modelFile) {
+  const char* NAMES[] = {"load.pagesConvert", "frame.africanHead.512.paged",
+                         "frame.africanHead.512.paged.budget"};
+  if (!std::any_of(std::begin(NAMES), std::end(NAMES),
+                   [&](const char* name) { return suite.selected(name); })) {
+    return;
+  }
+
+  std::string pages =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_bench.pages")
+          .string();
+  PagingOptions options;
+  options.chunkFaces = 256;
+  convertToPages(modelFile, pages, options);
+
+  PagedModel paged;
+  {
+    Silence silence;
+    paged.open(pages, modelFile, options.memoryBudget);
+  }
+
+  suite.micro(NAMES[0], paged.faceCount(),
+              [&] { keep(convertToPages(modelFile, pages, options)); });
+
+  CameraPose pose;
+  pose.eye = Vec3f(1, 1, 3);
+  pose.center = Vec3f(0, 0, 0);
+  RenderContext ctx(512, 512);
+
+  suite.frame(NAMES[1], paged.faceCount(),
+              [&] { renderPaged(ctx, paged, pose, Vec3f(1., 1., 1.)); });
+
+  paged.setMemoryBudget(256 << 10);
+  suite.frame(NAMES[2], paged.faceCount(),
+              [&] { renderPaged(ctx, paged, pose, Vec3f(1., 1., 1.)); });
+
+  std::filesystem::remove(pages);
+}
+
+// a turntable batch written as tga files against streamed to /dev/null as
+// raw rgb and y4m, items are views. The stream writes on its own thread
+// while the next view renders
+static void benchOutput(BenchSuite& suite, Model& model) {
+  const char* NAMES[] = {"output.batch.256.tga", "output.batch.256.rgb",
+                         "output.batch.256.y4m"};
+  std::vector<CameraPose> poses =
+      turntable(OUTPUT_VIEWS, Vec3f(1, 1, 3), Vec3f(0, 0, 0));
+  BatchOptions options;
+  options.width = options.height = 256;
+  options.threads = 1;
+
+  for (int i = 0; i < 3; i++) {
+    if (!suite.selected(NAMES[i])) continue;
+
+    options.outputPrefix =
+        (std::filesystem::temp_directory_path() / "tinyrenderer_bench_out")
+            .string();
+    suite.frame(NAMES[i], OUTPUT_VIEWS, [&] {
+      std::unique_ptr<FrameStream> stream;
+      if (i > 0) {
+        stream.reset(new FrameStream("/dev/null",
+                                     i == 1 ? STREAM_RGB : STREAM_Y4M,
+                                     options.width, options.height, 30., 1));
+      }
+      options.stream = stream.get();
+      keep(renderBatch(model, poses, options).milliseconds);
+    });
+
+    for (int view = 0; i == 0 && view < OUTPUT_VIEWS; view++) {
+      char filename[32];
+      snprintf(filename, sizeof(filename), "_%04d.tga", view);
+      std::filesystem::remove(options.outputPrefix + filename);
+    }
+  }
+}
+
+static void benchFrames(BenchSuite& suite, Model& model) {
+  CameraPose pose;
+  pose.eye = Vec3f(1, 1, 3);
+  pose.center = Vec3f(0, 0, 0);
+
+  for (int size : FRAME_SIZES) {
+    std::string name = "frame.africanHead." + std::to_string(size);
+    if (!suite.selected(name)) continue;
+
+    RenderContext ctx(size, size);
+    ctx.model = &model;
+
+    suite.frame(name, 1, [&] { renderView(ctx, pose, Vec3f(1., 1., 1.)); });
+  }
+
+  // the same frame with a shadow pass, the difference is its cost
+  for (int shadowSize : {1024, 2048}) {
+    std::string name =
+        "frame.africanHead.512.shadow" + std::to_string(shadowSize);
+    if (!suite.selected(name)) continue;
+
+    RenderContext ctx(512, 512);
+    ctx.model = &model;
+    ctx.shadow.resize(shadowSize);
+
+    suite.frame(name, 1, [&] { renderView(ctx, pose, Vec3f(1., 1., 1.)); });
+  }
+
+  // 4 samples per pixel both ways: msaa shades once per pixel, ssaa renders
+  // twice the size and box filters it down
+  if (suite.selected("frame.africanHead.512.msaa4")) {
+    RenderContext ctx(512, 512);
+    ctx.model = &model;
+    ctx.setSamples(4);
+
+    suite.frame("frame.africanHead.512.msaa4", 1,
+                [&] { renderView(ctx, pose, Vec3f(1., 1., 1.)); });
+  }
+
+  if (suite.selected("frame.africanHead.512.ssaa4")) {
+    RenderContext ctx(1024, 1024);
+    ctx.model = &model;
+    TGAImage resolved(512, 512, TGAImage::RGBA);
+
+    suite.frame("frame.africanHead.512.ssaa4", 1, [&] {
+      renderView(ctx, pose, Vec3f(1., 1., 1.));
+      downsample2x(ctx.framebuffer, resolved);
+    });
+  }
+
+  benchShadingRates(suite, model, pose);
+
+  // instanced crowds, items are triangles so the rate compares across counts
+  for (int instances : {16, 64}) {
+    std::string name = "frame.crowd.512.x" + std::to_string(instances);
+    if (!suite.selected(name)) continue;
+
+    Scene scene = crowdScene(&model, instances);
+    RenderContext ctx(512, 512);
+
+    suite.frame(name, scene.triangleCount(),
+                [&] { renderScene(ctx, scene, pose, Vec3f(1., 1., 1.)); });
+  }
+
+  // looking at a corner of the crowd so most of it is off screen, .cull lets
+  // the bvh drop those instances and faces before the vertex stage
+  CameraPose corner = pose;
+  corner.center = Vec3f(0.7f, 0.f, 0.7f);
+  corner.eye = corner.center + Vec3f(0.3f, 0.3f, 0.9f);
+  Bvh bvh;
+
+  for (bool cull : {false, true}) {
+    std::string name = cull ? "frame.crowd.512.x64.corner.cull"
+                            : "frame.crowd.512.x64.corner";
+    if (!suite.selected(name)) continue;
+
+    if (cull && bvh.empty()) bvh.build(model, 0);
+    Scene scene = crowdScene(&model, 64);
+    scene.meshes[0].bvh = cull ? &bvh : nullptr;
+    RenderContext ctx(512, 512);
+
+    suite.frame(name, scene.triangleCount(),
+                [&] { renderScene(ctx, scene, corner, Vec3f(1., 1., 1.)); });
+  }
+
+  benchRaycast(suite, model, pose);
+  benchLods(suite, model, pose);
+  benchMeshlets(suite, model, pose, corner);
+  benchOutput(suite, model);
+}
+
+// TinyRenderer_bench [model.obj] [--iterations N] [--warmup N]
+//                    [--frame-iterations N] [--filter name] [--json out.json]
+int main(int argc, char** argv) {
+  BenchOptions options;
+  std::string modelFile = "obj/african_head.obj";
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+
+    if (!strcmp(argv[i], "--iterations") && hasValue) {
+      options.iterations = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--warmup") && hasValue) {
+      options.warmup = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--frame-iterations") && hasValue) {
+      options.frameIterations = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "--filter") && hasValue) {
+      options.filter = argv[++i];
+    } else if (!strcmp(argv[i], "--json") && hasValue) {
+      options.jsonPath = argv[++i];
+    } else {
+      modelFile = argv[i];
+    }
+  }
+
+  BenchSuite suite(options);
+
+  benchGeometry(suite);
+  benchVertices(suite);
+  benchRaster(suite);
+  benchLoading(suite, modelFile);
+  benchParseThreads(suite);
+  benchPaged(suite, modelFile);
+  benchTextures(suite, modelFile);
+
+  std::unique_ptr<Model> model;
+  {
+    Silence silence;
+    model.reset(new Model(modelFile.c_str()));
+  }
+
+  benchBvh(suite, *model);
+  benchFrames(suite, *model);
+
+  if (!options.jsonPath.empty()) {
+    std::ofstream json(options.jsonPath);
+    suite.writeJson(json);
+    std::cout << "results written to " << options.jsonPath << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// keeps the optimizer from dropping a result nobody reads
+template <class T>
+inline void keep(const T& value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "g"(&value) : "memory");
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
+
+struct BenchResult {
+  std::string name;
+  int warmup = 0;
+  int iterations = 0;
+  long items = 0;  // work units done by one iteration
+  double minimum = 0.;
+  double median = 0.;
+  double p95 = 0.;
+  double mean = 0.;
+
+  double itemsPerSecond() const {
+    return median > 0. ? items / (median / 1000.) : 0.;
+  }
+};
+
+struct BenchOptions {
+  int warmup = 2;
+  int iterations = 15;
+  int frameWarmup = 1;  // full frames are expensive, they get less runs
+  int frameIterations = 5;
+  std::string filter;  // only names that contain it
+  std::string jsonPath;
+};
+
+// loaders log to std::cerr, the table would be unreadable
+struct Silence {
+  std::ostringstream discard;
+  std::streambuf* previous;
+  Silence() : previous(std::cerr.rdbuf(discard.rdbuf())) {}
+  ~Silence() { std::cerr.rdbuf(previous); }
+};
+
+class BenchSuite {
+ private:
+  BenchOptions options;
+  std::vector<BenchResult> results;
+
+ public:
+  BenchSuite(const BenchOptions& options) : options(options) {}
+
+  const BenchOptions& getOptions() const { return options; }
+
+  bool selected(const std::string& name) const {
+    return options.filter.empty() ||
+           name.find(options.filter) != std::string::npos;
+  }
+
+  // times body once per iteration after the warmup runs
+  template <class Body>
+  void run(const std::string& name, long items, int warmup, int iterations,
+           Body body) {
+    if (!selected(name)) return;
+
+    std::vector<double> samples;
+    {
+      Silence silence;
+
+      for (int i = 0; i < warmup; i++) body();
+
+      for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        samples.push_back(std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+      }
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.warmup = warmup;
+    result.iterations = iterations;
+    result.items = items;
+    result.minimum = samples.front();
+    result.median = samples.size() % 2
+                        ? samples[samples.size() / 2]
+                        : (samples[samples.size() / 2 - 1] +
+                           samples[samples.size() / 2]) /
+                              2.;
+    int p95 = (int)(samples.size() * 0.95 + 0.5) - 1;
+    result.p95 = samples[std::max(0, p95)];
+    for (double sample : samples) result.mean += sample;
+    result.mean /= samples.size();
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "%-32s median %10.4f ms  p95 %10.4f ms  min %10.4f ms  %12.0f "
+             "items/s\n",
+             name.c_str(), result.median, result.p95, result.minimum,
+             result.itemsPerSecond());
+    std::cout << line << std::flush;
+
+    results.push_back(result);
+  }
+
+  template <class Body>
+  void micro(const std::string& name, long items, Body body) {
+    run(name, items, options.warmup, options.iterations, body);
+  }
+
+  template <class Body>
+  void frame(const std::string& name, long items, Body body) {
+    run(name, items, options.frameWarmup, options.frameIterations, body);
+  }
+
+  void writeJson(std::ostream& out) const {
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      const BenchResult& r = results[i];
+      char line[400];
+      snprintf(line, sizeof(line),
+               "    {\"name\": \"%s\", \"warmup\": %d, \"iterations\": %d, "
+               "\"items\": %ld, \"min_ms\": %.6f, \"median_ms\": %.6f, "
+               "\"p95_ms\": %.6f, \"mean_ms\": %.6f, \"items_per_second\": "
+               "%.2f}%s\n",
+               r.name.c_str(), r.warmup, r.iterations, r.items, r.minimum,
+               r.median, r.p95, r.mean, r.itemsPerSecond(),
+               i + 1 < results.size() ? "," : "");
+      out << line;
+    }
+    out << "  ]\n}\n";
+  }
+};
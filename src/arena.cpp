@@ -0,0 +1,75 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+const size_t MIN_BLOCK = 64 * 1024;
+
+FrameArena::FrameArena(size_t initialBytes) {
+  if (initialBytes) grow(initialBytes, alignof(std::max_align_t));
+}
+
+FrameArena::~FrameArena() { release(); }
+
+void FrameArena::release() {
+  for (Block& block : blocks) ::operator delete(block.data);
+  blocks.clear();
+  current = 0;
+  offset = 0;
+}
+
+size_t FrameArena::capacity() const {
+  size_t total = 0;
+  for (const Block& block : blocks) total += block.size;
+  return total;
+}
+
+void FrameArena::grow(size_t bytes, size_t alignment) {
+  size_t size = std::max(MIN_BLOCK, bytes + alignment);
+  if (!blocks.empty()) size = std::max(size, blocks.back().size * 2);
+
+  blocks.push_back(Block{(char*)::operator new(size), size});
+  current = blocks.size() - 1;
+  offset = 0;
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+  for (;;) {
+    if (current < blocks.size()) {
+      Block& block = blocks[current];
+      uintptr_t base = (uintptr_t)block.data;
+      uintptr_t start = (base + offset + alignment - 1) & ~(alignment - 1);
+
+      if (start + bytes <= base + block.size) {
+        offset = start + bytes - base;
+        usedBytes += bytes;
+        peakBytes = std::max(peakBytes, usedBytes);
+        return (void*)start;
+      }
+
+      // the next kept block may still fit it
+      if (current + 1 < blocks.size()) {
+        current++;
+        offset = 0;
+        continue;
+      }
+    }
+
+    grow(bytes, alignment);
+  }
+}
+
+void FrameArena::reset() {
+  // one block big enough for the worst frame so far, only when it grew
+  if (blocks.size() > 1) {
+    size_t size = capacity();
+    release();
+    blocks.push_back(Block{(char*)::operator new(size), size});
+  }
+
+  current = 0;
+  offset = 0;
+  usedBytes = 0;
+}
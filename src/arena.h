@@ -0,0 +1,56 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// linear allocator for data that lives one frame. Allocation bumps a pointer,
+// deallocate does nothing and reset() drops everything in O(1). Blocks are
+// kept between frames, after the first reset that outgrew the first block
+// they are merged into one, so a steady frame never reaches malloc.
+// Usable as a std::pmr resource for containers of per-frame scratch
+class FrameArena : public std::pmr::memory_resource {
+ private:
+  struct Block {
+    char* data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks;
+  size_t current = 0;  // block being filled
+  size_t offset = 0;   // first free byte in it
+  size_t usedBytes = 0;
+  size_t peakBytes = 0;
+
+  void grow(size_t bytes, size_t alignment);
+  void release();
+
+ protected:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void*, size_t, size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+
+ public:
+  explicit FrameArena(size_t initialBytes = 0);
+  ~FrameArena();
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  template <class T>
+  T* make(size_t count) {
+    return (T*)allocate(count * sizeof(T), alignof(T));
+  }
+
+  void reset();
+
+  size_t used() const { return usedBytes; }   // since the last reset
+  size_t peak() const { return peakBytes; }   // most used by one frame
+  size_t capacity() const;
+};
+
+#endif  //__ARENA_H__
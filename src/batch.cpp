@@ -0,0 +1,254 @@
+#include "batch.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "framestream.h"
+#include "geometry.h"
+#include "gl.h"
+#include "lod.h"
+#include "model.h"
+#include "paged.h"
+#include "raycast.h"
+#include "scene.h"
+#include "shader.h"
+#include "tgaimage.h"
+#include "trace.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+std::vector<CameraPose> turntable(int count, Vec3f eye, Vec3f center) {
+  std::vector<CameraPose> poses;
+  Vec3f offset = eye - center;
+
+  for (int i = 0; i < count; i++) {
+    float angle = 2.f * M_PI * i / count;
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+
+    CameraPose pose;
+    pose.center = center;
+    pose.eye = center + Vec3f(offset.x * c + offset.z * s, offset.y,
+                              offset.z * c - offset.x * s);
+    poses.push_back(pose);
+  }
+
+  return poses;
+}
+
+void applyCamera(RenderContext& ctx, const CameraPose& pose) {
+  lookat(ctx, pose.eye, pose.center, pose.up);
+  viewport(ctx, ctx.width, ctx.height, 0, 0);
+  projection(ctx, -1.f / (pose.eye - pose.center).norm());
+}
+
+void applyOptions(RenderContext& ctx, const BatchOptions& options) {
+  if (ctx.shadow.size != options.shadowMapSize) {
+    ctx.shadow.resize(options.shadowMapSize);
+  }
+  ctx.shadow.pcf = options.shadowPcf;
+  ctx.setSamples(options.samples);
+  ctx.shadingRate = options.shadingRate;
+  ctx.rateThreshold = options.rateThreshold;
+  ctx.bvh = options.cull ? options.bvh : nullptr;
+  ctx.lods = options.lods;
+  ctx.lodPixelError = options.lodPixelError;
+  ctx.meshlets = options.meshlets;
+  ctx.cullBackfaces = options.cullBackfaces;
+  ctx.meshletThreads = options.threads;
+}
+
+void renderView(RenderContext& ctx, const CameraPose& pose, Vec3f light) {
+  TRACE_SCOPE("renderView");
+
+  ctx.clear();
+  STATS_ONLY(long allocations = heapAllocationCount());
+
+  applyCamera(ctx, pose);
+
+  // a simplified level takes the place of the model for this frame, the bvh
+  // and the meshlets only know the faces of the full one
+  Model* model = ctx.model;
+  const Bvh* bvh = ctx.bvh;
+  const Meshlets* meshlets = ctx.meshlets;
+  if (ctx.lods) {
+    int level = ctx.lods->select(ctx, Matrix::identity(4), ctx.lodPixelError);
+    ctx.model = ctx.lods->level(level);
+    if (level > 0) {
+      ctx.bvh = nullptr;
+      ctx.meshlets = nullptr;
+    }
+    STATS_ADD(ctx.stats, lodDraws[level], 1);
+  }
+
+  if (ctx.shadow.size > 0) renderShadowMap(ctx, light, pose.center);
+
+  TexturingShader shader(&ctx.arena);
+  shader.setup(ctx, light);
+  ctx.shader = &shader;
+
+  drawModel(ctx);
+  resolveSamples(ctx);
+
+  ctx.shader = nullptr;
+  ctx.model = model;
+  ctx.bvh = bvh;
+  ctx.meshlets = meshlets;
+
+  STATS_ADD(ctx.stats, heapAllocations, heapAllocationCount() - allocations);
+  STATS_ADD(ctx.stats, arenaBytes, ctx.arena.used());
+}
+
+void orientForDisplay(TGAImage& image) {
+  image.flip_vertically();
+  image.flip_horizontally();
+}
+
+BatchReport renderBatch(Model& model, const std::vector<CameraPose>& poses,
+                        const BatchOptions& options) {
+  BatchReport report;
+  report.views.resize(poses.size());
+  report.threads = options.threads;
+  if (report.threads <= 0) {
+    report.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  report.threads = std::min<int>(report.threads, poses.size());
+
+  // views already keep the threads busy, the ray caster's tiles stay on the
+  // view's thread
+  RaycastOptions raycast;
+  if (options.raycast) {
+    raycast = *options.raycast;
+    if (report.threads > 1) raycast.threads = 1;
+  }
+
+  std::atomic<int> next(0);
+  Clock::time_point batchStart = Clock::now();
+
+  auto worker = [&]() {
+    TRACE_THREAD("batch worker");
+
+    RenderContext ctx(options.width, options.height);
+    ctx.model = &model;
+    applyOptions(ctx, options);
+    if (report.threads > 1) ctx.meshletThreads = 1;  // like the ray caster
+
+    for (int view = next++; view < (int)poses.size(); view = next++) {
+      Clock::time_point start = Clock::now();
+
+      if (options.scene) {
+        renderScene(ctx, *options.scene, poses[view], options.lightDirection);
+      } else if (options.paged) {
+        renderPaged(ctx, *options.paged, poses[view], options.lightDirection);
+      } else if (options.raycast && options.bvh) {
+        raycastView(ctx, *options.bvh, poses[view], options.lightDirection,
+                    raycast);
+      } else {
+        renderView(ctx, poses[view], options.lightDirection);
+      }
+
+      ViewReport& result = report.views[view];
+      result.stats = ctx.stats;
+      result.coveredPixels = ctx.coveredPixels();
+
+      result.view = view;
+      result.faces = options.scene   ? options.scene->triangleCount()
+                     : options.paged ? options.paged->faceCount()
+                                     : model.nfaces();
+
+      if (options.stream) {
+        // the writer thread orients and writes it while the next one
+        // renders, written is known once the stream is finished
+        options.stream->submit(view, ctx.framebuffer);
+        result.filename = "streamed";
+      } else {
+        orientForDisplay(ctx.framebuffer);
+
+        char filename[32];
+        snprintf(filename, sizeof(filename), "_%04d.tga", view);
+        result.filename = options.outputPrefix + filename;
+        result.written =
+            ctx.framebuffer.write_tga_file(result.filename.c_str());
+      }
+      result.milliseconds = millisecondsSince(start);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i < report.threads; i++) workers.emplace_back(worker);
+  worker();
+  for (std::thread& t : workers) t.join();
+
+  if (options.stream) {
+    bool finished = options.stream->finish();
+    report.streamed = true;
+    report.stream = options.stream->stats();
+
+    // frames go out in view order and the ones after a failed write are
+    // dropped. When only the last flush failed, which of them reached the
+    // reader is unknown
+    long written = report.stream.frames;
+    if (!finished && written == (long)report.views.size()) written = 0;
+    for (ViewReport& result : report.views) {
+      result.written = result.view < written;
+    }
+  }
+
+  report.milliseconds = millisecondsSince(batchStart);
+  return report;
+}
+
+void printReport(std::ostream& out, const BatchReport& report) {
+  double busy = 0.;
+  long faces = 0;
+  PipelineStats stats;
+  long coveredPixels = 0;
+
+  for (const ViewReport& view : report.views) {
+    busy += view.milliseconds;
+    faces += view.faces;
+    stats += view.stats;
+    coveredPixels += view.coveredPixels;
+
+    char line[160];
+    snprintf(line, sizeof(line), "view %4d %9.2f ms %10.0f tris/s  %s%s\n",
+             view.view, view.milliseconds,
+             view.faces / (view.milliseconds / 1000.), view.filename.c_str(),
+             view.written ? "" : " (write failed)");
+    out << line;
+  }
+
+  if (report.views.empty() || report.milliseconds <= 0.) return;
+
+  char line[200];
+  snprintf(line, sizeof(line),
+           "%d views in %.2f ms on %d threads: %.2f views/s, %.0f tris/s, "
+           "%.2f ms/view, %.2f views in flight\n",
+           (int)report.views.size(), report.milliseconds, report.threads,
+           report.views.size() / (report.milliseconds / 1000.),
+           faces / (report.milliseconds / 1000.),
+           busy / report.views.size(), busy / report.milliseconds);
+  out << line;
+
+  if (report.streamed) {
+    const FrameStreamStats& stream = report.stream;
+    snprintf(line, sizeof(line),
+             "streamed %ld frames, %.1f MB in %.2f ms of writing, renderers "
+             "waited %.2f ms%s\n",
+             stream.frames, stream.bytes / 1048576., stream.writeMilliseconds,
+             stream.stallMilliseconds,
+             stream.failed ? " (write failed, rest dropped)" : "");
+    out << line;
+  }
+
+  stats.print(out, coveredPixels);
+}
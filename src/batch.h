@@ -0,0 +1,93 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "framestream.h"
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "stats.h"
+#include "tgaimage.h"
+
+struct Bvh;
+struct LodChain;
+struct Meshlets;
+class PagedModel;
+struct RaycastOptions;
+struct Scene;
+
+struct CameraPose {
+  Vec3f eye;
+  Vec3f center;
+  Vec3f up = Vec3f(0., 1., 0.);
+};
+
+struct BatchOptions {
+  int width = 700;
+  int height = 700;
+  int threads = 0;                     // 0 = one per core
+  std::string outputPrefix = "frame";  // <prefix>_0000.tga, <prefix>_0001.tga
+  Vec3f lightDirection = Vec3f(1., 1., 1.);
+  int shadowMapSize = 0;  // 0 = no shadows
+  int shadowPcf = 1;      // shadow filter radius in texels
+  int samples = 1;        // msaa samples per pixel, 1, 2, 4 or 8
+  int shadingRate = 1;    // pixels per side of a coarse shading block
+  int rateThreshold = 0;  // back to full rate above it, 0 = never
+  const Scene* scene = nullptr;  // rendered instead of the bare model
+  const Bvh* bvh = nullptr;      // of the model, for culling and ray casting
+  bool cull = false;             // with bvh, before the vertex stage
+  const RaycastOptions* raycast = nullptr;  // casts rays through bvh instead
+  const LodChain* lods = nullptr;           // of the model
+  float lodPixelError = 1.f;
+  const Meshlets* meshlets = nullptr;  // of the model, culls instead of bvh
+  bool cullBackfaces = false;          // meshlets facing away too
+  PagedModel* paged = nullptr;  // drawn instead of the model, paged in
+  FrameStream* stream = nullptr;  // gets the frames in order instead of files
+};
+
+struct ViewReport {
+  int view = 0;
+  int faces = 0;
+  double milliseconds = 0.;
+  bool written = false;
+  std::string filename;
+  PipelineStats stats;
+  long coveredPixels = 0;
+};
+
+struct BatchReport {
+  std::vector<ViewReport> views;
+  int threads = 0;
+  double milliseconds = 0.;  // wall time of the whole batch
+  bool streamed = false;
+  FrameStreamStats stream;
+};
+
+// count poses rotating eye around the vertical axis that goes through center
+std::vector<CameraPose> turntable(int count, Vec3f eye, Vec3f center);
+
+// lookat, viewport and projection of ctx for pose
+void applyCamera(RenderContext& ctx, const CameraPose& pose);
+
+// shadow map, msaa, shading rate, culling, levels of detail and meshlets of
+// ctx from options, only what changed is reallocated
+void applyOptions(RenderContext& ctx, const BatchOptions& options);
+
+// renders a single pose with the model bound to ctx, the framebuffer is left
+// in raster coords. A sized ctx.shadow adds a shadow pass first, msaa samples
+// are resolved at the end. With ctx.lods the level its size asks for is drawn
+void renderView(RenderContext& ctx, const CameraPose& pose, Vec3f light);
+
+// raster coords to the orientation the window shows
+void orientForDisplay(TGAImage& image);
+
+// the model is shared read only by all the workers, each one owns a context
+BatchReport renderBatch(Model& model, const std::vector<CameraPose>& poses,
+                        const BatchOptions& options);
+
+void printReport(std::ostream& out, const BatchReport& report);
+
+#endif  //__BATCH_H__
@@ -0,0 +1,339 @@
+#include "blocktexture.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#include "trace.h"
+
+static std::atomic<long> nextId(0);
+
+// decoded blocks of every texture for one thread, direct mapped
+struct DecodedBlocks {
+  static const int SLOTS = 256;  // 16 KB of texels, 16 x 16 blocks
+
+  long owner[SLOTS];
+  int block[SLOTS];
+  uint32_t texels[SLOTS][16];
+  long hits = 0;
+  long misses = 0;
+
+  DecodedBlocks() {
+    std::fill(owner, owner + SLOTS, -1L);
+    std::fill(block, block + SLOTS, -1);
+  }
+};
+
+static thread_local DecodedBlocks decoded;
+
+static uint32_t packTexel(int r, int g, int b) {
+  return (uint32_t)b | (uint32_t)g << 8 | (uint32_t)r << 16;
+}
+
+static uint16_t pack565(const float rgb[3]) {
+  int r = std::clamp((int)std::lround(rgb[0] * 31.f / 255.f), 0, 31);
+  int g = std::clamp((int)std::lround(rgb[1] * 63.f / 255.f), 0, 63);
+  int b = std::clamp((int)std::lround(rgb[2] * 31.f / 255.f), 0, 31);
+  return r << 11 | g << 5 | b;
+}
+
+static void unpack565(uint16_t c, int rgb[3]) {
+  int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+  rgb[0] = r << 3 | r >> 2;
+  rgb[1] = g << 2 | g >> 4;
+  rgb[2] = b << 3 | b >> 2;
+}
+
+// the four colors of a bc1 block, three and black when c0 <= c1
+static void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+  unpack565(c0, palette[0]);
+  unpack565(c1, palette[1]);
+  for (int i = 0; i < 3; i++) {
+    int a = palette[0][i], b = palette[1][i];
+    if (c0 > c1) {
+      palette[2][i] = (2 * a + b + 1) / 3;
+      palette[3][i] = (a + 2 * b + 1) / 3;
+    } else {
+      palette[2][i] = (a + b + 1) / 2;
+      palette[3][i] = 0;
+    }
+  }
+}
+
+// the nearest of the four colors for every texel, c0 > c1 on return.
+// Returns the squared error
+static int bc1Indices(const uint8_t rgb[16][3], uint16_t& c0, uint16_t& c1,
+                      uint32_t& indices) {
+  if (c0 < c1) std::swap(c0, c1);
+  int palette[4][3];
+  bc1Palette(c0, c1, palette);
+
+  indices = 0;
+  int error = 0;
+  for (int t = 0; t < 16; t++) {
+    int best = 0, bestDistance = 1 << 30;
+    for (int p = 0; p < (c0 == c1 ? 1 : 4); p++) {
+      int distance = 0;
+      for (int i = 0; i < 3; i++) {
+        int d = rgb[t][i] - palette[p][i];
+        distance += d * d;
+      }
+      if (distance < bestDistance) bestDistance = distance, best = p;
+    }
+    indices |= (uint32_t)best << (2 * t);
+    error += bestDistance;
+  }
+  return error;
+}
+
+// ends along the principal axis of the colors, then moved to where they fit
+// the picked indices best in the least squares sense while that helps
+static void encodeBc1(const uint8_t rgb[16][3], uint8_t out[8]) {
+  float mean[3] = {0.f, 0.f, 0.f};
+  for (int t = 0; t < 16; t++) {
+    for (int i = 0; i < 3; i++) mean[i] += rgb[t][i] / 16.f;
+  }
+
+  float covariance[3][3] = {};
+  for (int t = 0; t < 16; t++) {
+    float d[3] = {rgb[t][0] - mean[0], rgb[t][1] - mean[1],
+                  rgb[t][2] - mean[2]};
+    for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) covariance[i][j] += d[i] * d[j];
+    }
+  }
+
+  float axis[3] = {1.f, 1.f, 1.f};
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[3];
+    for (int i = 0; i < 3; i++) {
+      next[i] = covariance[i][0] * axis[0] + covariance[i][1] * axis[1] +
+                covariance[i][2] * axis[2];
+    }
+    float length = std::max({std::abs(next[0]), std::abs(next[1]),
+                             std::abs(next[2])});
+    if (length == 0.f) break;
+    for (int i = 0; i < 3; i++) axis[i] = next[i] / length;
+  }
+
+  int low = 0, high = 0;
+  float lowest = 1e30f, highest = -1e30f;
+  for (int t = 0; t < 16; t++) {
+    float p = rgb[t][0] * axis[0] + rgb[t][1] * axis[1] + rgb[t][2] * axis[2];
+    if (p < lowest) lowest = p, low = t;
+    if (p > highest) highest = p, high = t;
+  }
+
+  float a[3] = {(float)rgb[high][0], (float)rgb[high][1], (float)rgb[high][2]};
+  float b[3] = {(float)rgb[low][0], (float)rgb[low][1], (float)rgb[low][2]};
+  uint16_t c0 = pack565(a), c1 = pack565(b);
+  uint32_t indices;
+  int error = bc1Indices(rgb, c0, c1, indices);
+
+  const float WEIGHTS[4] = {1.f, 0.f, 2.f / 3.f, 1.f / 3.f};  // of c0
+  for (int iteration = 0; iteration < 2 && error > 0 && c0 != c1;
+       iteration++) {
+    float aa = 0.f, ab = 0.f, bb = 0.f, ax[3] = {}, bx[3] = {};
+    for (int t = 0; t < 16; t++) {
+      float w = WEIGHTS[(indices >> (2 * t)) & 3];
+      aa += w * w;
+      ab += w * (1.f - w);
+      bb += (1.f - w) * (1.f - w);
+      for (int i = 0; i < 3; i++) {
+        ax[i] += w * rgb[t][i];
+        bx[i] += (1.f - w) * rgb[t][i];
+      }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) break;
+
+    for (int i = 0; i < 3; i++) {
+      a[i] = (ax[i] * bb - bx[i] * ab) / det;
+      b[i] = (bx[i] * aa - ax[i] * ab) / det;
+    }
+    uint16_t r0 = pack565(a), r1 = pack565(b);
+    uint32_t refined;
+    int refinedError = bc1Indices(rgb, r0, r1, refined);
+    if (refinedError >= error) break;
+    c0 = r0, c1 = r1, indices = refined, error = refinedError;
+  }
+
+  std::memcpy(out, &c0, 2);
+  std::memcpy(out + 2, &c1, 2);
+  std::memcpy(out + 4, &indices, 4);
+}
+
+static void decodeBc1(const uint8_t in[8], uint32_t texels[16]) {
+  uint16_t c0, c1;
+  uint32_t indices;
+  std::memcpy(&c0, in, 2);
+  std::memcpy(&c1, in + 2, 2);
+  std::memcpy(&indices, in + 4, 4);
+
+  int palette[4][3];
+  bc1Palette(c0, c1, palette);
+  uint32_t colors[4];
+  for (int p = 0; p < 4; p++) {
+    colors[p] = packTexel(palette[p][0], palette[p][1], palette[p][2]);
+  }
+  for (int t = 0; t < 16; t++) texels[t] = colors[(indices >> (2 * t)) & 3];
+}
+
+// the eight values of a bc4 channel, six with 0 and 255 when e0 <= e1
+static void bc4Palette(int e0, int e1, int palette[8]) {
+  palette[0] = e0;
+  palette[1] = e1;
+  if (e0 > e1) {
+    for (int i = 1; i < 7; i++) {
+      palette[i + 1] = ((7 - i) * e0 + i * e1 + 3) / 7;
+    }
+  } else {
+    for (int i = 1; i < 5; i++) {
+      palette[i + 1] = ((5 - i) * e0 + i * e1 + 2) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+static void encodeBc4(const uint8_t values[16], uint8_t out[8]) {
+  uint8_t e0 = *std::max_element(values, values + 16);
+  uint8_t e1 = *std::min_element(values, values + 16);
+
+  uint64_t indices = 0;
+  if (e0 != e1) {
+    int palette[8];
+    bc4Palette(e0, e1, palette);
+    for (int t = 0; t < 16; t++) {
+      int best = 0;
+      for (int p = 1; p < 8; p++) {
+        if (std::abs(values[t] - palette[p]) <
+            std::abs(values[t] - palette[best])) {
+          best = p;
+        }
+      }
+      indices |= (uint64_t)best << (3 * t);
+    }
+  }
+
+  out[0] = e0;
+  out[1] = e1;
+  for (int i = 0; i < 6; i++) out[2 + i] = indices >> (8 * i);
+}
+
+static void decodeBc4(const uint8_t in[8], int values[16]) {
+  int palette[8];
+  bc4Palette(in[0], in[1], palette);
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; i++) indices |= (uint64_t)in[2 + i] << (8 * i);
+  for (int t = 0; t < 16; t++) values[t] = palette[(indices >> (3 * t)) & 7];
+}
+
+static void decodeBc5(const uint8_t in[16], uint32_t texels[16]) {
+  int x[16], y[16];
+  decodeBc4(in, x);
+  decodeBc4(in + 8, y);
+
+  for (int t = 0; t < 16; t++) {
+    float nx = x[t] / 255.f * 2.f - 1.f;
+    float ny = y[t] / 255.f * 2.f - 1.f;
+    float nz = std::sqrt(std::max(0.f, 1.f - nx * nx - ny * ny));
+    texels[t] = packTexel(x[t], y[t], (int)std::lround((nz + 1.f) * 127.5f));
+  }
+}
+
+static int blockBytes(BlockFormat format) {
+  return format == BLOCK_BC1 ? 8 : 16;
+}
+
+BlockTexture::BlockTexture(TGAImage& image, BlockFormat format)
+    : format_(format),
+      width_(image.get_width()),
+      height_(image.get_height()),
+      blocksWide_((image.get_width() + 3) / 4),
+      id_(nextId++) {
+  TRACE_SCOPE("BlockTexture::BlockTexture");
+
+  int blocksHigh = (height_ + 3) / 4;
+  blocks_.resize((size_t)blocksWide_ * blocksHigh * blockBytes(format));
+
+  for (int by = 0; by < blocksHigh; by++) {
+    for (int bx = 0; bx < blocksWide_; bx++) {
+      uint8_t rgb[16][3];
+      for (int t = 0; t < 16; t++) {
+        int x = std::min(bx * 4 + t % 4, width_ - 1);
+        int y = std::min(by * 4 + t / 4, height_ - 1);
+        TGAColor c = image.get(x, y);
+        rgb[t][0] = c.bgra[2];
+        rgb[t][1] = c.bgra[1];
+        rgb[t][2] = c.bgra[0];
+      }
+
+      uint8_t* out = &blocks_[((size_t)by * blocksWide_ + bx) *
+                              blockBytes(format)];
+      if (format == BLOCK_BC1) {
+        encodeBc1(rgb, out);
+        continue;
+      }
+      uint8_t red[16], green[16];
+      for (int t = 0; t < 16; t++) {
+        red[t] = rgb[t][0];
+        green[t] = rgb[t][1];
+      }
+      encodeBc4(red, out);
+      encodeBc4(green, out + 8);
+    }
+  }
+}
+
+void BlockTexture::decodeBlock(int block, uint32_t texels[16]) const {
+  const uint8_t* in = &blocks_[(size_t)block * blockBytes(format_)];
+  if (format_ == BLOCK_BC1) {
+    decodeBc1(in, texels);
+  } else {
+    decodeBc5(in, texels);
+  }
+}
+
+TGAColor BlockTexture::get(int x, int y) const {
+  if (x < 0 || y < 0 || x >= width_ || y >= height_) return TGAColor();
+
+  // a 16 x 16 square of blocks around the sample fits without conflicts,
+  // whichever way the uvs walk. The same block of another texture lands
+  // elsewhere
+  int bx = x >> 2, by = y >> 2;
+  int block = by * blocksWide_ + bx;
+  int slot = ((by & 15) << 4 | (bx & 15)) ^ ((id_ * 157) & 255);
+  if (decoded.owner[slot] != id_ || decoded.block[slot] != block) {
+    decodeBlock(block, decoded.texels[slot]);
+    decoded.owner[slot] = id_;
+    decoded.block[slot] = block;
+    decoded.misses++;
+  } else {
+    decoded.hits++;
+  }
+
+  uint32_t texel = decoded.texels[slot][(y & 3) * 4 + (x & 3)];
+  return TGAColor((const unsigned char*)&texel, 3);
+}
+
+TGAImage BlockTexture::decode() const {
+  TGAImage image(width_, height_, TGAImage::RGB);
+  uint32_t texels[16];
+  for (int by = 0; by < (height_ + 3) / 4; by++) {
+    for (int bx = 0; bx < blocksWide_; bx++) {
+      decodeBlock(by * blocksWide_ + bx, texels);
+      for (int t = 0; t < 16; t++) {
+        TGAColor c((const unsigned char*)&texels[t], 3);
+        image.set(bx * 4 + t % 4, by * 4 + t / 4, c);
+      }
+    }
+  }
+  return image;
+}
+
+void BlockTexture::cacheCounters(long& hits, long& misses) {
+  hits = decoded.hits;
+  misses = decoded.misses;
+}
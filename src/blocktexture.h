@@ -0,0 +1,54 @@
+#ifndef __BLOCKTEXTURE_H__
+#define __BLOCKTEXTURE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "tgaimage.h"
+
+enum BlockFormat {
+  // rgb, 8 bytes per 4x4 texels: two 565 colors and a 2 bit index per texel
+  // into them and the two colors between
+  BLOCK_BC1,
+  // red and green, 16 bytes per 4x4 texels: each channel two 8 bit values
+  // and a 3 bit index per texel into them and six between. For tangent space
+  // normals, blue is rebuilt from the other two as the unit z
+  BLOCK_BC5,
+};
+
+// a texture kept block compressed in memory, decoded a block at a time as
+// it gets sampled. The last decoded blocks of every texture stay in a small
+// cache per thread, neighbouring samples mostly land in the same block
+class BlockTexture {
+ private:
+  BlockFormat format_;
+  int width_ = 0;
+  int height_ = 0;
+  int blocksWide_ = 0;
+  long id_;  // tells the textures apart in the decoded block cache
+  std::vector<uint8_t> blocks_;
+
+  // bgra texels of a block, row by row
+  void decodeBlock(int block, uint32_t texels[16]) const;
+
+ public:
+  // sizes that aren't a multiple of 4 repeat the last row and column
+  BlockTexture(TGAImage& image, BlockFormat format);
+
+  BlockFormat format() const { return format_; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+  size_t bytes() const { return blocks_.size(); }
+
+  // like TGAImage::get of a 3 byte image, zero outside the texture
+  TGAColor get(int x, int y) const;
+
+  // every texel decoded, for comparing against the source
+  TGAImage decode() const;
+
+  // decoded block cache lookups of the calling thread so far
+  static void cacheCounters(long& hits, long& misses);
+};
+
+#endif  //__BLOCKTEXTURE_H__
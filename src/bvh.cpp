@@ -0,0 +1,630 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "trace.h"
+
+const int BINS = 16;             // SAH split candidates per axis
+const int MAX_LEAF = 8;          // bigger leaves always get split
+const float TRAVERSAL_COST = 1;  // against 1 per triangle test
+const int PARALLEL_MIN = 4096;   // smaller subtrees stay on their thread
+const int STACK_SIZE = 64;
+const int SAH_DEPTH = 40;  // deeper splits are medians, the tree stays < 64
+const float INFINITE = std::numeric_limits<float>::infinity();
+
+struct Bounds {
+  Vec3f min = Vec3f(INFINITE, INFINITE, INFINITE);
+  Vec3f max = Vec3f(-INFINITE, -INFINITE, -INFINITE);
+
+  void grow(Vec3f point) {
+    min = componentMin(min, point);
+    max = componentMax(max, point);
+  }
+
+  void grow(const Bounds& other) {
+    min = componentMin(min, other.min);
+    max = componentMax(max, other.max);
+  }
+
+  float area() const {
+    if (min.x > max.x) return 0.f;
+    Vec3f size = max - min;
+    return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+};
+
+struct BuildInput {
+  std::vector<Bounds> bounds;    // per face
+  std::vector<Vec3f> centroids;  // per face
+  std::vector<int> order;        // faces, partitioned in place by the build
+};
+
+struct Bin {
+  Bounds bounds;
+  int count = 0;
+};
+
+static void setBounds(BvhNode& node, const Bounds& bounds) {
+  for (int i = 0; i < 3; i++) {
+    node.min[i] = bounds.min[i];
+    node.max[i] = bounds.max[i];
+  }
+}
+
+// splits order[begin, end) where the SAH says so, or in the middle when a
+// leaf would be too big and the centroids can't be told apart or the tree
+// got too deep. Returns the split point, begin for a leaf
+static int splitRange(BuildInput& in, int begin, int end, int depth,
+                      const Bounds& box, const Bounds& centroidBox) {
+  int count = end - begin;
+  if (count <= 2) return begin;
+
+  if (depth >= SAH_DEPTH) {
+    if (count <= MAX_LEAF) return begin;
+
+    Vec3f extent = centroidBox.max - centroidBox.min;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                   : (extent.y > extent.z ? 1 : 2);
+    int middle = begin + count / 2;
+    std::nth_element(in.order.begin() + begin, in.order.begin() + middle,
+                     in.order.begin() + end, [&](int a, int b) {
+                       return in.centroids[a][axis] < in.centroids[b][axis];
+                     });
+    return middle;
+  }
+
+  float bestCost = INFINITE;
+  int bestAxis = -1;
+  int bestBin = 0;
+
+  for (int axis = 0; axis < 3; axis++) {
+    float low = centroidBox.min[axis];
+    float extent = centroidBox.max[axis] - low;
+    if (extent <= 0.f) continue;
+
+    Bin bins[BINS];
+    float scale = BINS / extent;
+
+    for (int i = begin; i < end; i++) {
+      int face = in.order[i];
+      int bin = std::min(BINS - 1, (int)((in.centroids[face][axis] - low) *
+                                         scale));
+      bins[bin].count++;
+      bins[bin].bounds.grow(in.bounds[face]);
+    }
+
+    // area * count of everything right of each split, swept from the right
+    float rightCost[BINS];
+    Bounds right;
+    int rightCount = 0;
+    for (int b = BINS - 1; b > 0; b--) {
+      right.grow(bins[b].bounds);
+      rightCount += bins[b].count;
+      rightCost[b] = right.area() * rightCount;
+    }
+
+    Bounds left;
+    int leftCount = 0;
+    for (int b = 0; b < BINS - 1; b++) {
+      left.grow(bins[b].bounds);
+      leftCount += bins[b].count;
+      float cost = left.area() * leftCount + rightCost[b + 1];
+      if (leftCount > 0 && leftCount < count && cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestBin = b;
+      }
+    }
+  }
+
+  float leafCost = box.area() * count;
+  float splitCost = box.area() * TRAVERSAL_COST + bestCost;
+
+  if (bestAxis < 0 || splitCost >= leafCost) {
+    if (count <= MAX_LEAF) return begin;
+    if (bestAxis < 0) return begin + count / 2;  // all centroids in a point
+  }
+
+  float low = centroidBox.min[bestAxis];
+  float scale = BINS / (centroidBox.max[bestAxis] - low);
+
+  int* middle = std::partition(
+      in.order.data() + begin, in.order.data() + end, [&](int face) {
+        int bin = std::min(
+            BINS - 1, (int)((in.centroids[face][bestAxis] - low) * scale));
+        return bin <= bestBin;
+      });
+
+  return middle - in.order.data();
+}
+
+// appends the subtree of order[begin, end) to nodes depth first, the right
+// half goes to another thread while threads are left and it is big enough
+static void buildNode(BuildInput& in, std::vector<BvhNode>& nodes, int begin,
+                      int end, int depth, int threads) {
+  int index = nodes.size();
+  nodes.emplace_back();
+
+  Bounds box;
+  Bounds centroidBox;
+  for (int i = begin; i < end; i++) {
+    box.grow(in.bounds[in.order[i]]);
+    centroidBox.grow(in.centroids[in.order[i]]);
+  }
+  setBounds(nodes[index], box);
+
+  int middle = splitRange(in, begin, end, depth, box, centroidBox);
+
+  if (middle == begin) {
+    nodes[index].start = begin;
+    nodes[index].count = end - begin;
+    return;
+  }
+
+  nodes[index].count = 0;
+
+  if (threads > 1 && end - begin >= PARALLEL_MIN) {
+    std::vector<BvhNode> right;
+    std::thread worker(
+        [&] { buildNode(in, right, middle, end, depth + 1, threads / 2); });
+    buildNode(in, nodes, begin, middle, depth + 1, threads - threads / 2);
+    worker.join();
+
+    // the right subtree moves behind the left one, its links move with it
+    int offset = nodes.size();
+    for (BvhNode& node : right) {
+      if (node.count == 0) node.start += offset;
+      nodes.push_back(node);
+    }
+    nodes[index].start = offset;
+  } else {
+    buildNode(in, nodes, begin, middle, depth + 1, 1);
+    nodes[index].start = nodes.size();
+    buildNode(in, nodes, middle, end, depth + 1, 1);
+  }
+}
+
+void Bvh::build(Model& model, int threads) {
+  TRACE_SCOPE("Bvh::build");
+
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  int faces = model.nfaces();
+  BuildInput in;
+  in.bounds.resize(faces);
+  in.centroids.resize(faces);
+  in.order.resize(faces);
+
+  for (int i = 0; i < faces; i++) {
+    const std::vector<int>& face = model.face(i);
+    for (int j = 0; j < 3; j++) in.bounds[i].grow(model.vert(face[j]));
+    in.centroids[i] = (in.bounds[i].min + in.bounds[i].max) * 0.5f;
+    in.order[i] = i;
+  }
+
+  nodes.clear();
+  triangles.clear();
+  if (faces == 0) return;
+
+  nodes.reserve(2 * faces);
+  buildNode(in, nodes, 0, faces, 0, threads);
+
+  triangles.resize(faces);
+  for (int i = 0; i < faces; i++) {
+    const std::vector<int>& face = model.face(in.order[i]);
+    Vec3f a = model.vert(face[0]);
+    triangles[i].a = a;
+    triangles[i].e1 = model.vert(face[1]) - a;
+    triangles[i].e2 = model.vert(face[2]) - a;
+    triangles[i].face = in.order[i];
+  }
+}
+
+// 1 / d for the slab tests, large instead of infinite along an axis the ray
+// does not move on so a box face through the origin gives 0, not NaN
+static float slabInverse(float d) {
+  return d != 0.f ? 1.f / d : std::copysign(1e30f, d);
+}
+
+// distance along the ray where it enters node, INFINITE when it misses or
+// enters past tMax
+static float enterNode(const BvhNode& node, Vec3f origin, Vec3f inverse,
+                       float tMax) {
+  float enter = 0.f;
+  float exit = tMax;
+
+  for (int i = 0; i < 3; i++) {
+    float t0 = (node.min[i] - origin[i]) * inverse[i];
+    float t1 = (node.max[i] - origin[i]) * inverse[i];
+    enter = std::max(enter, std::min(t0, t1));
+    exit = std::min(exit, std::max(t0, t1));
+  }
+
+  return enter <= exit ? enter : INFINITE;
+}
+
+struct StackEntry {
+  int node;
+  float distance;  // lower bound of anything in it, to skip it once beaten
+};
+
+bool Bvh::intersect(Vec3f origin, Vec3f direction, RayHit& hit,
+                    float maxT) const {
+  hit = RayHit();
+  hit.t = maxT;
+  if (nodes.empty()) return false;
+
+  Vec3f inverse(slabInverse(direction.x), slabInverse(direction.y),
+                slabInverse(direction.z));
+  StackEntry stack[STACK_SIZE];
+  int top = 0;
+
+  float rootEnter = enterNode(nodes[0], origin, inverse, hit.t);
+  if (rootEnter != INFINITE) stack[top++] = {0, rootEnter};
+
+  while (top > 0) {
+    StackEntry entry = stack[--top];
+    if (entry.distance >= hit.t) continue;
+
+    const BvhNode& node = nodes[entry.node];
+
+    if (node.count > 0) {
+      // Moller-Trumbore
+      for (int i = node.start; i < node.start + node.count; i++) {
+        const BvhTriangle& triangle = triangles[i];
+        Vec3f p = direction ^ triangle.e2;
+        float determinant = triangle.e1 * p;
+        if (std::abs(determinant) < 1e-12f) continue;
+
+        float inverseDeterminant = 1.f / determinant;
+        Vec3f s = origin - triangle.a;
+        float u = (s * p) * inverseDeterminant;
+        if (u < 0.f || u > 1.f) continue;
+
+        Vec3f q = s ^ triangle.e1;
+        float v = (direction * q) * inverseDeterminant;
+        if (v < 0.f || u + v > 1.f) continue;
+
+        float t = (triangle.e2 * q) * inverseDeterminant;
+        if (t < 0.f || t >= hit.t) continue;
+
+        hit.t = t;
+        hit.u = u;
+        hit.v = v;
+        hit.face = triangle.face;
+      }
+      continue;
+    }
+
+    // the nearer child goes on top
+    int left = entry.node + 1;
+    int right = node.start;
+    float leftEnter = enterNode(nodes[left], origin, inverse, hit.t);
+    float rightEnter = enterNode(nodes[right], origin, inverse, hit.t);
+
+    if (leftEnter > rightEnter) {
+      std::swap(left, right);
+      std::swap(leftEnter, rightEnter);
+    }
+    if (rightEnter != INFINITE) stack[top++] = {right, rightEnter};
+    if (leftEnter != INFINITE) stack[top++] = {left, leftEnter};
+  }
+
+  if (hit.face < 0) hit.t = INFINITE;
+  return hit.face >= 0;
+}
+
+// enterNode for the four rays of a packet, the mask of the ones that enter.
+// nearest gets the smallest entry distance among them
+static int enterNodePacket(const BvhNode& node, const float4 origin[3],
+                           const float4 inverse[3], float4 tMax,
+                           float& nearest) {
+  float4 enter = f4splat(0.f);
+  float4 exit = tMax;
+
+  for (int i = 0; i < 3; i++) {
+    float4 t0 = f4mul(f4sub(f4splat(node.min[i]), origin[i]), inverse[i]);
+    float4 t1 = f4mul(f4sub(f4splat(node.max[i]), origin[i]), inverse[i]);
+    enter = f4max(enter, f4min(t0, t1));
+    exit = f4min(exit, f4max(t0, t1));
+  }
+
+  int mask = f4lessEqualMask(enter, exit);
+
+  float lanes[4];
+  f4store(lanes, enter);
+  nearest = INFINITE;
+  for (int i = 0; i < 4; i++) {
+    if (mask & (1 << i)) nearest = std::min(nearest, lanes[i]);
+  }
+
+  return mask;
+}
+
+int Bvh::intersectPacket(const RayPacket& packet, RayHit hits[4],
+                         float maxT) const {
+  // inactive rays get a negative limit, no box or triangle can pass it
+  float best[4];
+  for (int i = 0; i < 4; i++) {
+    hits[i] = RayHit();
+    best[i] = packet.active & (1 << i) ? maxT : -INFINITE;
+  }
+  if (nodes.empty() || !packet.active) return 0;
+
+  float4 origin[3];
+  float4 direction[3];
+  float4 inverse[3];
+  for (int i = 0; i < 3; i++) {
+    float lanes[4];
+    for (int lane = 0; lane < 4; lane++) {
+      lanes[lane] = slabInverse(packet.direction[i][lane]);
+    }
+    origin[i] = f4load(packet.origin[i]);
+    direction[i] = f4load(packet.direction[i]);
+    inverse[i] = f4load(lanes);
+  }
+
+  float4 tBest = f4load(best);
+  float farthest = maxT;  // largest best of the active rays
+  int hitMask = 0;
+
+  StackEntry stack[STACK_SIZE];
+  int top = 0;
+
+  float rootEnter;
+  if (enterNodePacket(nodes[0], origin, inverse, tBest, rootEnter)) {
+    stack[top++] = {0, rootEnter};
+  }
+
+  const float4 zero = f4splat(0.f);
+  const float4 one = f4splat(1.f);
+  const float4 epsilon = f4splat(1e-12f);
+
+  while (top > 0) {
+    StackEntry entry = stack[--top];
+    if (entry.distance >= farthest) continue;
+
+    const BvhNode& node = nodes[entry.node];
+
+    if (node.count > 0) {
+      // Moller-Trumbore, one triangle against the four rays
+      for (int i = node.start; i < node.start + node.count; i++) {
+        const BvhTriangle& triangle = triangles[i];
+        float4 e1[3], e2[3], s[3];
+        for (int j = 0; j < 3; j++) {
+          e1[j] = f4splat(triangle.e1[j]);
+          e2[j] = f4splat(triangle.e2[j]);
+          s[j] = f4sub(origin[j], f4splat(triangle.a[j]));
+        }
+
+        float4 p[3] = {
+            f4sub(f4mul(direction[1], e2[2]), f4mul(direction[2], e2[1])),
+            f4sub(f4mul(direction[2], e2[0]), f4mul(direction[0], e2[2])),
+            f4sub(f4mul(direction[0], e2[1]), f4mul(direction[1], e2[0]))};
+        float4 determinant =
+            f4add(f4add(f4mul(e1[0], p[0]), f4mul(e1[1], p[1])),
+                  f4mul(e1[2], p[2]));
+        int mask = f4lessMask(epsilon, f4max(determinant,
+                                             f4sub(zero, determinant)));
+        if (!mask) continue;
+
+        float4 inverseDeterminant = f4div(one, determinant);
+        float4 u = f4mul(f4add(f4add(f4mul(s[0], p[0]), f4mul(s[1], p[1])),
+                               f4mul(s[2], p[2])),
+                         inverseDeterminant);
+
+        float4 q[3] = {f4sub(f4mul(s[1], e1[2]), f4mul(s[2], e1[1])),
+                       f4sub(f4mul(s[2], e1[0]), f4mul(s[0], e1[2])),
+                       f4sub(f4mul(s[0], e1[1]), f4mul(s[1], e1[0]))};
+        float4 v = f4mul(
+            f4add(f4add(f4mul(direction[0], q[0]), f4mul(direction[1], q[1])),
+                  f4mul(direction[2], q[2])),
+            inverseDeterminant);
+        float4 t = f4mul(f4add(f4add(f4mul(e2[0], q[0]), f4mul(e2[1], q[1])),
+                               f4mul(e2[2], q[2])),
+                         inverseDeterminant);
+
+        mask &= f4lessEqualMask(zero, u) & f4lessEqualMask(zero, v) &
+                f4lessEqualMask(f4add(u, v), one) &
+                f4lessEqualMask(zero, t) & f4lessMask(t, tBest);
+        if (!mask) continue;
+
+        float ts[4], us[4], vs[4];
+        f4store(ts, t);
+        f4store(us, u);
+        f4store(vs, v);
+        for (int lane = 0; lane < 4; lane++) {
+          if (!(mask & (1 << lane))) continue;
+          best[lane] = ts[lane];
+          hits[lane].t = ts[lane];
+          hits[lane].u = us[lane];
+          hits[lane].v = vs[lane];
+          hits[lane].face = triangle.face;
+        }
+        hitMask |= mask;
+
+        tBest = f4load(best);
+        farthest = -INFINITE;
+        for (int lane = 0; lane < 4; lane++) {
+          if (packet.active & (1 << lane)) {
+            farthest = std::max(farthest, best[lane]);
+          }
+        }
+      }
+      continue;
+    }
+
+    // the child some ray enters first goes on top
+    int left = entry.node + 1;
+    int right = node.start;
+    float leftEnter, rightEnter;
+    int leftMask = enterNodePacket(nodes[left], origin, inverse, tBest,
+                                   leftEnter);
+    int rightMask = enterNodePacket(nodes[right], origin, inverse, tBest,
+                                    rightEnter);
+
+    if (leftMask && rightMask && leftEnter > rightEnter) {
+      std::swap(left, right);
+      std::swap(leftMask, rightMask);
+      std::swap(leftEnter, rightEnter);
+    }
+    if (rightMask) stack[top++] = {right, rightEnter};
+    if (leftMask) stack[top++] = {left, leftEnter};
+  }
+
+  return hitMask;
+}
+
+static float squaredDistance(const BvhNode& node, Vec3f point) {
+  float distance = 0.f;
+  for (int i = 0; i < 3; i++) {
+    float outside = std::max(std::max(node.min[i] - point[i], 0.f),
+                             point[i] - node.max[i]);
+    distance += outside * outside;
+  }
+  return distance;
+}
+
+// Ericson, Real-Time Collision Detection 5.1.5
+static Vec3f closestOnTriangle(Vec3f p, const BvhTriangle& triangle) {
+  Vec3f a = triangle.a;
+  Vec3f ab = triangle.e1;
+  Vec3f ac = triangle.e2;
+  Vec3f ap = p - a;
+
+  float d1 = ab * ap;
+  float d2 = ac * ap;
+  if (d1 <= 0.f && d2 <= 0.f) return a;
+
+  Vec3f bp = p - (a + ab);
+  float d3 = ab * bp;
+  float d4 = ac * bp;
+  if (d3 >= 0.f && d4 <= d3) return a + ab;
+
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) return a + ab * (d1 / (d1 - d3));
+
+  Vec3f cp = p - (a + ac);
+  float d5 = ab * cp;
+  float d6 = ac * cp;
+  if (d6 >= 0.f && d5 <= d6) return a + ac;
+
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) return a + ac * (d2 / (d2 - d6));
+
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f) {
+    float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return (a + ab) + (ac - ab) * w;
+  }
+
+  float denominator = 1.f / (va + vb + vc);
+  return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+int Bvh::nearestFace(Vec3f point, Vec3f& closest, float maxDistance) const {
+  if (nodes.empty()) return -1;
+
+  float best = maxDistance * maxDistance;
+  int bestFace = -1;
+  StackEntry stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = {0, squaredDistance(nodes[0], point)};
+
+  while (top > 0) {
+    StackEntry entry = stack[--top];
+    if (entry.distance >= best) continue;
+
+    const BvhNode& node = nodes[entry.node];
+
+    if (node.count > 0) {
+      for (int i = node.start; i < node.start + node.count; i++) {
+        Vec3f candidate = closestOnTriangle(point, triangles[i]);
+        Vec3f offset = candidate - point;
+        float distance = offset * offset;
+        if (distance < best) {
+          best = distance;
+          bestFace = triangles[i].face;
+          closest = candidate;
+        }
+      }
+      continue;
+    }
+
+    int left = entry.node + 1;
+    int right = node.start;
+    float leftDistance = squaredDistance(nodes[left], point);
+    float rightDistance = squaredDistance(nodes[right], point);
+
+    if (leftDistance > rightDistance) {
+      std::swap(left, right);
+      std::swap(leftDistance, rightDistance);
+    }
+    stack[top++] = {right, rightDistance};
+    stack[top++] = {left, leftDistance};
+  }
+
+  return bestFace;
+}
+
+int Bvh::cullFaces(const Matrix& clip, std::vector<int>& faces) const {
+  faces.clear();
+  if (nodes.empty()) return 0;
+
+  float planes[5][4];
+  frustumPlanes(clip, planes);
+
+  int stack[STACK_SIZE];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top > 0) {
+    int index = stack[--top];
+    const BvhNode& node = nodes[index];
+    bool outside = false;
+    bool inside = true;
+
+    // the box corner furthest along the normal and the one furthest against
+    for (int p = 0; p < 5 && !outside; p++) {
+      float far = planes[p][3];
+      float near = planes[p][3];
+      for (int i = 0; i < 3; i++) {
+        float a = planes[p][i] * node.min[i];
+        float b = planes[p][i] * node.max[i];
+        far += std::max(a, b);
+        near += std::min(a, b);
+      }
+      outside = far < 0.f;
+      inside = inside && near >= 0.f;
+    }
+
+    if (outside) continue;
+
+    if (inside || node.count > 0) {
+      // a subtree owns one run of triangles, from its leftmost leaf to its
+      // rightmost one
+      int first = index;
+      while (nodes[first].count == 0) first++;
+      int last = index;
+      while (nodes[last].count == 0) last = nodes[last].start;
+
+      for (int i = nodes[first].start;
+           i < nodes[last].start + nodes[last].count; i++) {
+        faces.push_back(triangles[i].face);
+      }
+      continue;
+    }
+
+    stack[top++] = node.start;
+    stack[top++] = index + 1;
+  }
+
+  return triangles.size() - faces.size();
+}
@@ -0,0 +1,87 @@
+#ifndef __BVH_H__
+#define __BVH_H__
+
+#include <limits>
+#include <vector>
+
+#include "geometry.h"
+
+class Model;
+
+// 32 bytes, two per cache line. Nodes are stored depth first: an interior
+// node has its left child right after it and the right one at start
+struct BvhNode {
+  float min[3];
+  int start;  // first triangle of a leaf, right child of an interior node
+  float max[3];
+  int count;  // triangles of a leaf, 0 for an interior node
+};
+
+// in leaf order so a leaf reads its triangles from consecutive memory, kept
+// as a corner and two edges for the ray test
+struct BvhTriangle {
+  Vec3f a;
+  Vec3f e1;  // b - a
+  Vec3f e2;  // c - a
+  int face;  // in the model
+};
+
+// rays traced together by Bvh::intersectPacket, stored by axis so a lane of
+// a float4 is one ray. Set every lane, inactive ones included
+struct RayPacket {
+  float origin[3][4];
+  float direction[3][4];
+  int active = 0xf;  // bit per lane
+
+  void set(int lane, Vec3f from, Vec3f along) {
+    for (int i = 0; i < 3; i++) {
+      origin[i][lane] = from[i];
+      direction[i][lane] = along[i];
+    }
+  }
+};
+
+struct RayHit {
+  int face = -1;  // -1 when nothing was hit
+  float t = std::numeric_limits<float>::infinity();
+  float u = 0.f;  // barycentrics of the second and third vertex
+  float v = 0.f;
+};
+
+// bounding volume hierarchy over the triangles of a model, built with the
+// surface area heuristic. Object space, read only once built so any number
+// of threads can query it
+struct Bvh {
+  std::vector<BvhNode> nodes;
+  std::vector<BvhTriangle> triangles;
+
+  // threads <= 0 uses one per core, the top subtrees get built in parallel
+  void build(Model& model, int threads = 1);
+
+  bool empty() const { return nodes.empty(); }
+
+  // closest hit along origin + t * direction with t in [0, maxT), direction
+  // needs no normalizing and t is in its units
+  bool intersect(Vec3f origin, Vec3f direction, RayHit& hit,
+                 float maxT = std::numeric_limits<float>::infinity()) const;
+
+  // intersect for the active rays of packet at once: a node is visited when
+  // any of them enters it and each triangle is tested against the four in
+  // SIMD lanes. Returns the mask of the rays that hit
+  int intersectPacket(const RayPacket& packet, RayHit hits[4],
+                      float maxT = std::numeric_limits<float>::infinity())
+      const;
+
+  // face closest to point within maxDistance, -1 when there is none. closest
+  // gets the nearest point on it
+  int nearestFace(Vec3f point, Vec3f& closest,
+                  float maxDistance = std::numeric_limits<float>::infinity())
+      const;
+
+  // faces of the leaves that may be visible through clip (projection *
+  // modelview * object transform), the rest can skip the vertex stage.
+  // Returns the faces culled
+  int cullFaces(const Matrix& clip, std::vector<int>& faces) const;
+};
+
+#endif  //__BVH_H__
@@ -0,0 +1,33 @@
+#include "camera.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "geometry.h"
+
+const float MAX_PITCH = 1.5f;  // keeps the up vector away from the view axis
+const float MIN_DISTANCE = 1.05f;
+const float MAX_DISTANCE = 50.f;
+
+OrbitCamera::OrbitCamera(Vec3f eye, Vec3f center) : center(center) {
+  Vec3f offset = eye - center;
+  distance = offset.norm();
+  yaw = std::atan2(offset.x, offset.z);
+  pitch = std::asin(offset.y / distance);
+}
+
+void OrbitCamera::orbit(float dyaw, float dpitch) {
+  yaw += dyaw;
+  pitch = std::max(-MAX_PITCH, std::min(MAX_PITCH, pitch + dpitch));
+}
+
+void OrbitCamera::zoom(float factor) {
+  distance = std::max(MIN_DISTANCE, std::min(MAX_DISTANCE, distance * factor));
+}
+
+Vec3f OrbitCamera::eye() const {
+  float horizontal = distance * std::cos(pitch);
+
+  return center + Vec3f(horizontal * std::sin(yaw), distance * std::sin(pitch),
+                        horizontal * std::cos(yaw));
+}
@@ -0,0 +1,22 @@
+#ifndef __CAMERA_H__
+#define __CAMERA_H__
+
+#include "geometry.h"
+
+// camera orbiting around center, angles in radians
+struct OrbitCamera {
+  Vec3f center;
+  float yaw = 0.f;    // around the vertical axis
+  float pitch = 0.f;  // above (+) or below (-) the horizon
+  float distance = 1.f;
+
+  OrbitCamera() {}
+  OrbitCamera(Vec3f eye, Vec3f center);
+
+  void orbit(float dyaw, float dpitch);
+  void zoom(float factor);  // < 1 gets closer
+
+  Vec3f eye() const;
+};
+
+#endif  //__CAMERA_H__
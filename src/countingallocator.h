@@ -0,0 +1,69 @@
+#ifndef __COUNTINGALLOCATOR_H__
+#define __COUNTINGALLOCATOR_H__
+
+// replaces the global operator new of the program with one that counts the
+// calls per thread for PipelineStats::heapAllocations. Include it from
+// exactly one source file of an executable, never from the library. Every
+// plain, array and nothrow form is replaced, so each delete frees what its
+// new got from malloc; the over-aligned ones stay the standard library's
+#include "stats.h"
+
+#if TINYRENDERER_STATS
+
+#include <cstdlib>
+#include <new>
+
+// kept out of line: gcc pairs a free inlined into the caller with the
+// operator new there and warns (-Wmismatched-new-delete)
+#if defined(__GNUC__)
+#define COUNTING_NOINLINE __attribute__((noinline))
+#else
+#define COUNTING_NOINLINE
+#endif
+
+static COUNTING_NOINLINE void* countedAllocation(std::size_t size) noexcept {
+  countHeapAllocation();
+  return std::malloc(size ? size : 1);
+}
+
+static COUNTING_NOINLINE void countedRelease(void* p) noexcept {
+  std::free(p);
+}
+
+void* operator new(std::size_t size) {
+  if (void* p = countedAllocation(size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  if (void* p = countedAllocation(size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocation(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocation(size);
+}
+
+void operator delete(void* p) noexcept { countedRelease(p); }
+
+void operator delete[](void* p) noexcept { countedRelease(p); }
+
+void operator delete(void* p, std::size_t) noexcept { countedRelease(p); }
+
+void operator delete[](void* p, std::size_t) noexcept { countedRelease(p); }
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  countedRelease(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  countedRelease(p);
+}
+
+#endif
+
+#endif  //__COUNTINGALLOCATOR_H__
@@ -0,0 +1,109 @@
+#include "cpu.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static KernelTable activeTable;
+static CpuPath activePath = CPU_SCALAR;
+
+const char* cpuPathName(CpuPath path) {
+  switch (path) {
+    case CPU_SCALAR:
+      return "scalar";
+    case CPU_SSE2:
+      return "sse2";
+    case CPU_AVX2:
+      return "avx2";
+    case CPU_AVX512:
+      return "avx512";
+    default:
+      return "?";
+  }
+}
+
+static bool cpuHas(CpuPath path) {
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  switch (path) {
+    case CPU_SCALAR:
+      return true;
+    case CPU_SSE2:
+      return __builtin_cpu_supports("sse2");
+    case CPU_AVX2:
+      return __builtin_cpu_supports("avx2");
+    case CPU_AVX512:
+      return __builtin_cpu_supports("avx512f");
+    default:
+      return false;
+  }
+#else
+  return path == CPU_SCALAR;
+#endif
+}
+
+// every level up to path on top of each other, false if one is missing
+static bool fillTable(CpuPath path, KernelTable* table) {
+  typedef bool (*Filler)(KernelTable*);
+  const Filler fillers[CPU_PATH_COUNT] = {scalarKernels, sse2Kernels,
+                                          avx2Kernels, avx512Kernels};
+
+  for (int level = CPU_SCALAR; level <= path; level++) {
+    if (!fillers[level](table)) return false;
+  }
+  return true;
+}
+
+bool cpuSupports(CpuPath path) {
+  KernelTable table;
+  return path >= CPU_SCALAR && path < CPU_PATH_COUNT && cpuHas(path) &&
+         fillTable(path, &table);
+}
+
+CpuPath bestCpuPath() {
+  for (int path = CPU_PATH_COUNT - 1; path > CPU_SCALAR; path--) {
+    if (cpuSupports((CpuPath)path)) return (CpuPath)path;
+  }
+  return CPU_SCALAR;
+}
+
+static bool initialize() {
+  CpuPath path = bestCpuPath();
+
+  const char* requested = std::getenv("TINYRENDERER_ISA");
+  if (requested && *requested) {
+    int cap = CPU_PATH_COUNT;
+    for (int i = 0; i < CPU_PATH_COUNT; i++) {
+      if (!strcmp(requested, cpuPathName((CpuPath)i))) cap = i;
+    }
+
+    if (cap == CPU_PATH_COUNT) {
+      std::cerr << "unknown TINYRENDERER_ISA " << requested << "\n";
+    } else if (cap < path) {
+      path = (CpuPath)cap;
+    }
+  }
+
+  fillTable(path, &activeTable);
+  activePath = path;
+  return true;
+}
+
+const KernelTable& kernels() {
+  static bool initialized = initialize();
+  (void)initialized;
+  return activeTable;
+}
+
+CpuPath activeCpuPath() {
+  kernels();
+  return activePath;
+}
+
+bool selectCpuPath(CpuPath path) {
+  kernels();
+  if (!cpuSupports(path)) return false;
+
+  fillTable(path, &activeTable);
+  activePath = path;
+  return true;
+}
@@ -0,0 +1,26 @@
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#include "kernels.h"
+
+// instruction sets the kernels are built for, each one includes the previous
+enum CpuPath { CPU_SCALAR, CPU_SSE2, CPU_AVX2, CPU_AVX512, CPU_PATH_COUNT };
+
+const char* cpuPathName(CpuPath path);
+
+// the cpu runs it and this binary has the kernels for it
+bool cpuSupports(CpuPath path);
+
+CpuPath bestCpuPath();
+
+// kernels of the active path. The first call picks the best supported one,
+// TINYRENDERER_ISA=scalar|sse2|avx2|avx512 caps it
+const KernelTable& kernels();
+
+CpuPath activeCpuPath();
+
+// switches every later kernels() call, false and no change when unsupported.
+// Not thread safe, meant for tests and benchmarks
+bool selectCpuPath(CpuPath path);
+
+#endif  //__CPU_H__
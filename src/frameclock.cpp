@@ -0,0 +1,53 @@
+#include "frameclock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+FrameClock::FrameClock() : frameStart(Clock::now()) {}
+
+double FrameClock::tick() {
+  Clock::time_point now = Clock::now();
+  double milliseconds =
+      std::chrono::duration<double, std::milli>(now - frameStart).count();
+  frameStart = now;
+
+  double& slot = history[frames % FRAME_HISTORY];
+  historySum += milliseconds - slot;
+  slot = milliseconds;
+  frames++;
+
+  return milliseconds;
+}
+
+double FrameClock::elapsed() const {
+  return std::chrono::duration<double, std::milli>(Clock::now() - frameStart)
+      .count();
+}
+
+void FrameClock::pace(double targetMilliseconds) const {
+  if (targetMilliseconds <= 0.) return;
+
+  // coarse sleep first, the last millisecond is spun to hit the target
+  double remaining = targetMilliseconds - elapsed();
+  if (remaining > 1.5) {
+    std::this_thread::sleep_for(
+        std::chrono::duration<double, std::milli>(remaining - 1.));
+  }
+  while (elapsed() < targetMilliseconds) std::this_thread::yield();
+}
+
+double FrameClock::lastFrame() const {
+  if (frames == 0) return 0.;
+  return history[(frames - 1) % FRAME_HISTORY];
+}
+
+double FrameClock::averageFrame() const {
+  if (frames == 0) return 0.;
+  return historySum / std::min(frames, FRAME_HISTORY);
+}
+
+double FrameClock::fps() const {
+  double average = averageFrame();
+  return average > 0. ? 1000. / average : 0.;
+}
@@ -0,0 +1,32 @@
+#ifndef __FRAMECLOCK_H__
+#define __FRAMECLOCK_H__
+
+#include <chrono>
+
+const int FRAME_HISTORY = 60;
+
+// measures frame times and keeps a rolling average over the last frames
+class FrameClock {
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point frameStart;
+  double history[FRAME_HISTORY] = {};
+  int frames = 0;
+  double historySum = 0.;
+
+ public:
+  FrameClock();
+
+  double tick();  // closes the current frame, returns its time in ms
+  double elapsed() const;  // ms since the current frame started
+
+  // sleeps whatever is left of the target frame time
+  void pace(double targetMilliseconds) const;
+
+  double lastFrame() const;
+  double averageFrame() const;
+  double fps() const;
+};
+
+#endif  //__FRAMECLOCK_H__
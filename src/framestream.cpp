@@ -0,0 +1,219 @@
+#include "framestream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+
+#include "trace.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t STAGING_BYTES = 1 << 16;
+
+static double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+bool parseStreamFormat(const std::string& name, StreamFormat& format) {
+  const char* NAMES[] = {"rgb", "rgba", "bgra", "y4m"};
+  for (int i = 0; i < 4; i++) {
+    if (name == NAMES[i]) {
+      format = (StreamFormat)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+FrameStream::FrameStream(const std::string& path, StreamFormat format,
+                         int width, int height, double fps, int spares)
+    : format_(format),
+      width_(width),
+      height_(height),
+      fps_(fps > 0. ? fps : 30.),
+      spares_(std::max(1, spares)),
+      staging_(STAGING_BYTES) {
+  if (path == "-") {
+    out_ = stdout;
+  } else {
+    out_ = std::fopen(path.c_str(), "wb");
+    ownsFile_ = true;
+  }
+  if (!out_) return;
+
+#ifdef SIGPIPE
+  // an encoder that exits early fails the next write instead of killing us
+  std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+  for (int i = 0; i < spares_; i++) {
+    free_.emplace_back(new TGAImage(width, height, TGAImage::RGBA));
+  }
+
+  if (format_ == STREAM_Y4M) {
+    std::fprintf(out_, "YUV4MPEG2 W%d H%d F%ld:1000 Ip A1:1 C420jpeg\n",
+                 width_, height_, std::lround(fps_ * 1000.));
+  }
+
+  writer_ = std::thread(&FrameStream::run, this);
+}
+
+FrameStream::~FrameStream() { finish(); }
+
+void FrameStream::submit(int index, TGAImage& frame) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  // the frame next_ always finds a buffer: at most spares - 1 later ones
+  // can be queued ahead of it
+  Clock::time_point start = Clock::now();
+  bufferFreed_.wait(lock, [&] {
+    return index < next_ + spares_ && !free_.empty();
+  });
+  stats_.stallMilliseconds += millisecondsSince(start);
+
+  std::unique_ptr<TGAImage> queued = std::move(free_.back());
+  free_.pop_back();
+  queued->swap(frame);
+  pending_[index] = std::move(queued);
+  frameReady_.notify_one();
+}
+
+bool FrameStream::finish() {
+  if (writer_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finishing_ = true;
+    }
+    frameReady_.notify_one();
+    writer_.join();
+  }
+
+  if (out_) {
+    if (std::fflush(out_) != 0) stats_.failed = true;
+    if (ownsFile_) std::fclose(out_);
+    out_ = nullptr;
+  }
+  return !stats_.failed;
+}
+
+FrameStreamStats FrameStream::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void FrameStream::run() {
+  TRACE_THREAD("stream writer");
+
+  while (true) {
+    std::unique_ptr<TGAImage> frame;
+    bool failed;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      frameReady_.wait(lock,
+                       [&] { return pending_.count(next_) || finishing_; });
+      auto found = pending_.find(next_);
+      if (found == pending_.end()) return;  // finishing and nothing left
+      frame = std::move(found->second);
+      pending_.erase(found);
+      failed = stats_.failed;
+    }
+
+    // once the reader is gone the frames are only handed back
+    Clock::time_point start = Clock::now();
+    frameBytes_ = 0;
+    bool written = !failed && writeFrame(*frame);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (written) {
+      stats_.frames++;
+      stats_.bytes += frameBytes_;
+    } else {
+      stats_.failed = true;
+    }
+    stats_.writeMilliseconds += millisecondsSince(start);
+    free_.push_back(std::move(frame));
+    next_++;
+    bufferFreed_.notify_all();
+  }
+}
+
+bool FrameStream::put(const unsigned char* bytes, size_t count) {
+  frameBytes_ += count;
+  return std::fwrite(bytes, 1, count, out_) == count;
+}
+
+bool FrameStream::writeFrame(TGAImage& frame) {
+  TRACE_SCOPE("FrameStream::writeFrame");
+
+  // raster coords flipped both ways is the display orientation, which is
+  // the pixels in reverse order
+  uint32_t* pixels = (uint32_t*)frame.buffer();
+  long count = (long)width_ * height_;
+
+  if (format_ == STREAM_BGRA) {
+    std::reverse(pixels, pixels + count);
+    return put(frame.buffer(), count * 4);
+  }
+
+  unsigned char* out = staging_.data();
+  size_t used = 0;
+  bool ok = true;
+  auto emit = [&](int value) {
+    if (used == staging_.size()) {
+      ok = ok && put(out, used);
+      used = 0;
+    }
+    out[used++] = (unsigned char)value;
+  };
+
+  if (format_ != STREAM_Y4M) {
+    bool alpha = format_ == STREAM_RGBA;
+    for (long i = count - 1; i >= 0; i--) {
+      const unsigned char* bgra = (const unsigned char*)&pixels[i];
+      emit(bgra[2]);
+      emit(bgra[1]);
+      emit(bgra[0]);
+      if (alpha) emit(bgra[3]);
+    }
+    return put(out, used) && ok;
+  }
+
+  static const unsigned char FRAME[] = "FRAME\n";
+  ok = put(FRAME, sizeof(FRAME) - 1);
+
+  // display pixel x, y, edges repeated for the odd chroma row and column
+  auto display = [&](int x, int y) {
+    x = std::min(x, width_ - 1);
+    y = std::min(y, height_ - 1);
+    return (const unsigned char*)&pixels[count - 1 - ((long)y * width_ + x)];
+  };
+
+  for (int y = 0; y < height_; y++) {
+    for (int x = 0; x < width_; x++) {
+      const unsigned char* p = display(x, y);
+      emit(((66 * p[2] + 129 * p[1] + 25 * p[0] + 128) >> 8) + 16);
+    }
+  }
+
+  // u then v, each from the mean of a 2 x 2 square
+  for (int plane = 0; plane < 2; plane++) {
+    for (int y = 0; y < height_; y += 2) {
+      for (int x = 0; x < width_; x += 2) {
+        int r = 0, g = 0, b = 0;
+        for (int corner = 0; corner < 4; corner++) {
+          const unsigned char* p = display(x + (corner & 1), y + corner / 2);
+          r += p[2];
+          g += p[1];
+          b += p[0];
+        }
+        r = (r + 2) / 4, g = (g + 2) / 4, b = (b + 2) / 4;
+        emit(plane == 0 ? ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128
+                        : ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+      }
+    }
+  }
+  return put(out, used) && ok;
+}
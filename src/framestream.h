@@ -0,0 +1,91 @@
+#ifndef __FRAMESTREAM_H__
+#define __FRAMESTREAM_H__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tgaimage.h"
+
+enum StreamFormat {
+  STREAM_RGB,   // 3 bytes a pixel, rows top down, no header
+  STREAM_RGBA,  // the same with alpha
+  STREAM_BGRA,  // the framebuffer bytes as they are
+  STREAM_Y4M,   // yuv4mpeg2 4:2:0, bt.601 limited range, a header per frame
+};
+
+// rgb, rgba, bgra or y4m
+bool parseStreamFormat(const std::string& name, StreamFormat& format);
+
+struct FrameStreamStats {
+  long frames = 0;
+  size_t bytes = 0;
+  double writeMilliseconds = 0.;  // the writer converting and writing
+  double stallMilliseconds = 0.;  // renderers waiting for a free buffer
+  bool failed = false;            // a write failed, the rest was dropped
+};
+
+// display oriented frames written in order to stdout, a file or a named
+// pipe by a thread of its own, so the next frames render while one goes
+// out. Frames come in as framebuffers and are swapped for free buffers of
+// the same size, the pixels are never copied: the writer converts them a
+// few rows at a time on their way out and hands the buffer back
+class FrameStream {
+ private:
+  std::FILE* out_ = nullptr;
+  bool ownsFile_ = false;
+  StreamFormat format_;
+  int width_;
+  int height_;
+  double fps_;  // y4m only
+  int spares_;
+
+  std::map<int, std::unique_ptr<TGAImage> > pending_;  // by frame index
+  std::vector<std::unique_ptr<TGAImage> > free_;
+  int next_ = 0;  // index written next
+  bool finishing_ = false;
+  FrameStreamStats stats_;
+  std::vector<unsigned char> staging_;  // converted rows on their way out
+  size_t frameBytes_ = 0;               // of the frame being written
+
+  std::mutex mutex_;
+  std::condition_variable frameReady_;
+  std::condition_variable bufferFreed_;
+  std::thread writer_;
+
+  void run();
+  bool writeFrame(TGAImage& frame);
+  bool put(const unsigned char* bytes, size_t count);
+
+ public:
+  // path "-" is stdout. spares is the number of buffers beyond the ones the
+  // renderers hold, one per renderer lets each one render while its last
+  // frame is written
+  FrameStream(const std::string& path, StreamFormat format, int width,
+              int height, double fps, int spares);
+  ~FrameStream();
+
+  bool isOpen() const { return out_ != nullptr; }
+
+  // queues frame, left in raster coords by the renderer, as frame index;
+  // frames go out in index order starting at 0. frame comes back as a
+  // buffer of the same size to render the next one into. Waits while index
+  // is spares or more ahead of the frame written next or no buffer is free,
+  // so every index below a waiting one has to be submitted from another
+  // thread: each thread submits its indices in ascending order, as the
+  // batch workers taking views from a shared counter do
+  void submit(int index, TGAImage& frame);
+
+  // waits until every queued frame is out, false when a write failed
+  bool finish();
+
+  FrameStreamStats stats();
+};
+
+#endif  //__FRAMESTREAM_H__
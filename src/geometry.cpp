@@ -1,15 +1,14 @@
 #include "geometry.h"
 
+#include <algorithm>
 #include <cassert>
 
-template <>
+#include "cpu.h"
+
 Vec4<float>::Vec4(Matrix a) {
   assert(a.getRows() == 4 && a.getColumns() == 1);
 
-  x = a(0, 0);
-  y = a(1, 0);
-  z = a(2, 0);
-  w = a(3, 0);
+  lanes = f4set(a(0, 0), a(1, 0), a(2, 0), a(3, 0));
 }
 template <>
 Vec4<int>::Vec4(Matrix a) {
@@ -21,13 +20,10 @@ Vec4<int>::Vec4(Matrix a) {
   w = (int)a(3, 0);
 }
 
-template <>
 Vec3<float>::Vec3(Matrix a) {
   assert(a.getRows() == 3 && a.getColumns() == 1);
 
-  x = a(0, 0);
-  y = a(1, 0);
-  z = a(2, 0);
+  lanes = f4set(a(0, 0), a(1, 0), a(2, 0), 0.f);
 }
 template <>
 Vec3<int>::Vec3(Matrix a) {
@@ -37,3 +33,68 @@ Vec3<int>::Vec3(Matrix a) {
   y = (int)a(1, 0);
   z = (int)a(2, 0);
 }
+
+// below this a thread costs more than it saves
+const int BATCH_GRAIN = 1 << 14;
+
+void transformRange(const Matrix& m, const Vec3SoA& in, float w, Vec4SoA& out,
+                    int begin, int end) {
+  assert(m.getRows() == 4 && m.getColumns() == 4);
+
+  float matrix[16];
+  for (int i = 0; i < 16; i++) matrix[i] = m(i / 4, i % 4);
+
+  kernels().transform(matrix, &in.x[begin], &in.y[begin], &in.z[begin], w,
+                      end - begin, &out.x[begin], &out.y[begin],
+                      &out.z[begin], &out.w[begin]);
+}
+
+void transformBatch(const Matrix& m, const Vec3SoA& in, float w, Vec4SoA& out,
+                    int threads) {
+  out.resize(in.size());
+
+  parallelFor(in.size(), BATCH_GRAIN, threads, [&](int begin, int end) {
+    transformRange(m, in, w, out, begin, end);
+  });
+}
+
+void projectRange(const Vec4SoA& clip, const Matrix& viewport, Vec3SoA& screen,
+                  Vec3SoA* ndc, int begin, int end) {
+  assert(viewport.getRows() == 4 && viewport.getColumns() == 4);
+
+  float v[16];
+  for (int i = 0; i < 16; i++) v[i] = viewport(i / 4, i % 4);
+
+  // branch free over separate arrays, the compiler vectorizes it
+  for (int i = begin; i < end; i++) {
+    float x = clip.x[i], y = clip.y[i], z = clip.z[i], w = clip.w[i];
+
+    float sx = v[0] * x + v[1] * y + v[2] * z + v[3] * w;
+    float sy = v[4] * x + v[5] * y + v[6] * z + v[7] * w;
+    float sz = v[8] * x + v[9] * y + v[10] * z + v[11] * w;
+    float sw = 1. / (v[12] * x + v[13] * y + v[14] * z + v[15] * w);
+
+    screen.x[i] = sx * sw;
+    screen.y[i] = sy * sw;
+    screen.z[i] = sz * sw;
+  }
+
+  if (!ndc) return;
+
+  for (int i = begin; i < end; i++) {
+    float wI = 1. / clip.w[i];  // like hogenize
+    ndc->x[i] = clip.x[i] * wI;
+    ndc->y[i] = clip.y[i] * wI;
+    ndc->z[i] = clip.z[i] * wI;
+  }
+}
+
+void projectBatch(const Vec4SoA& clip, const Matrix& viewport, Vec3SoA& screen,
+                  Vec3SoA* ndc, int threads) {
+  screen.resize(clip.size());
+  if (ndc) ndc->resize(clip.size());
+
+  parallelFor(clip.size(), BATCH_GRAIN, threads, [&](int begin, int end) {
+    projectRange(clip, viewport, screen, ndc, begin, end);
+  });
+}
@@ -3,13 +3,18 @@
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
 #include <ostream>
+#include <thread>
 #include <vector>
 
+#include "simd.h"
+
 using std::vector;
 
 const int MAX_ALLOC = 4;
@@ -107,7 +112,7 @@ struct Vec4 {
     return Vec4<t>(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x, w);
   }
   inline Vec4<t> operator+(const Vec4<t>& v) const {
-    return Vec4<t>(x + v.x, y + v.y, z + v.z, w - v.w);
+    return Vec4<t>(x + v.x, y + v.y, z + v.z, w + v.w);
   }
   inline Vec4<t> operator-(const Vec4<t>& v) const {
     return Vec4<t>(x - v.x, y - v.y, z - v.z, w - v.w);
@@ -141,6 +146,155 @@ struct Vec4 {
   friend std::ostream& operator<<(std::ostream& s, Vec4<t>& v);
 };
 
+// float vectors live in one 16 byte aligned register, Vec3f is padded with a
+// w lane kept at 0. Same fields and the same results as the generic ones
+template <>
+struct Vec3<float> {
+  union {
+    struct {
+      float x, y, z;
+    };
+    struct {
+      float ivert, iuv, inorm;
+    };
+    float raw[3];
+    float4 lanes;
+  };
+  Vec3() : lanes(f4splat(0.f)) {}
+  Vec3(float _x, float _y, float _z) : lanes(f4set(_x, _y, _z, 0.f)) {}
+  explicit Vec3(float4 v) : lanes(v) {}
+  Vec3(Matrix m);
+
+  inline Vec3<float> operator^(const Vec3<float>& v) const {
+    return Vec3<float>(f4cross3(lanes, v.lanes));
+  }
+  inline Vec3<float> operator+(const Vec3<float>& v) const {
+    return Vec3<float>(f4add(lanes, v.lanes));
+  }
+  inline Vec3<float> operator-(const Vec3<float>& v) const {
+    return Vec3<float>(f4sub(lanes, v.lanes));
+  }
+  inline Vec3<float> operator*(float f) const {
+    return Vec3<float>(f4mul(lanes, f4splat(f)));
+  }
+  inline float operator*(const Vec3<float>& v) const {
+    return f4sum3(f4mul(lanes, v.lanes));
+  }
+
+  inline float& operator[](const int i) { return raw[i]; }
+  const inline float& operator[](const int i) const { return raw[i]; }
+
+  float norm() const { return std::sqrt((*this) * (*this)); }
+  Vec3<float>& normalize(float l = 1) {
+    *this = (*this) * (l / norm());
+    return *this;
+  }
+  // rsqrt estimate instead of sqrt and divide, not bit exact
+  Vec3<float>& normalizeFast(float l = 1) {
+    *this = (*this) * (l * rsqrtFast((*this) * (*this)));
+    return *this;
+  }
+};
+
+template <>
+struct Vec4<float> {
+  union {
+    struct {
+      float x, y, z, w;
+    };
+    float raw[4];
+    float4 lanes;
+  };
+  Vec4(Vec2<float> v, const float _w) : lanes(f4set(v.x, v.y, 0.f, _w)) {}
+  Vec4(Vec3<float> v, const float _w) : lanes(f4set(v.x, v.y, v.z, _w)) {}
+  Vec4() : lanes(f4splat(0.f)) {}
+  Vec4(float _x, float _y, float _z, float _w)
+      : lanes(f4set(_x, _y, _z, _w)) {}
+  explicit Vec4(float4 v) : lanes(v) {}
+  Vec4(Matrix m);
+
+  inline Vec4<float> operator^(const Vec4<float>& v) const {
+    Vec4<float> result(f4cross3(lanes, v.lanes));
+    result.w = w;
+    return result;
+  }
+  inline Vec4<float> operator+(const Vec4<float>& v) const {
+    return Vec4<float>(f4add(lanes, v.lanes));
+  }
+  inline Vec4<float> operator-(const Vec4<float>& v) const {
+    return Vec4<float>(f4sub(lanes, v.lanes));
+  }
+  inline Vec4<float> operator*(float f) const {
+    return Vec4<float>(f4mul(lanes, f4splat(f)));
+  }
+  inline float operator*(const Vec4<float>& v) const {
+    return f4sum4(f4mul(lanes, v.lanes));
+  }
+
+  inline float& operator[](const int i) { return raw[i]; }
+  const inline float& operator[](const int i) const { return raw[i]; }
+
+  Vec4<float> hogenize() {
+    float wI = 1. / w;
+
+    return (*this) * wI;
+  };
+
+  Vec3<float> xyz() { return Vec3<float>(x, y, z); }
+
+  Vec2<float> xy() { return Vec2<float>(x, y); }
+
+  float norm() const { return std::sqrt((*this) * (*this)); }
+  Vec4<float>& normalize(float l = 1) {
+    *this = (*this) * (l / norm());
+    return *this;
+  }
+  Vec4<float>& normalizeFast(float l = 1) {
+    *this = (*this) * (l * rsqrtFast((*this) * (*this)));
+    return *this;
+  }
+};
+
+template <class t>
+inline t dot(const Vec3<t>& a, const Vec3<t>& b) {
+  return a * b;
+}
+template <class t>
+inline Vec3<t> cross(const Vec3<t>& a, const Vec3<t>& b) {
+  return a ^ b;
+}
+
+// a at f = 0, b at f = 1
+template <class t>
+inline Vec3<t> lerp(const Vec3<t>& a, const Vec3<t>& b, float f) {
+  return a + (b - a) * f;
+}
+template <class t>
+inline Vec4<t> lerp(const Vec4<t>& a, const Vec4<t>& b, float f) {
+  return a + (b - a) * f;
+}
+
+template <class t>
+inline Vec3<t> componentMin(const Vec3<t>& a, const Vec3<t>& b) {
+  return Vec3<t>(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+}
+template <class t>
+inline Vec3<t> componentMax(const Vec3<t>& a, const Vec3<t>& b) {
+  return Vec3<t>(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+}
+inline Vec3<float> componentMin(const Vec3<float>& a, const Vec3<float>& b) {
+  return Vec3<float>(f4min(a.lanes, b.lanes));
+}
+inline Vec3<float> componentMax(const Vec3<float>& a, const Vec3<float>& b) {
+  return Vec3<float>(f4max(a.lanes, b.lanes));
+}
+inline Vec4<float> componentMin(const Vec4<float>& a, const Vec4<float>& b) {
+  return Vec4<float>(f4min(a.lanes, b.lanes));
+}
+inline Vec4<float> componentMax(const Vec4<float>& a, const Vec4<float>& b) {
+  return Vec4<float>(f4max(a.lanes, b.lanes));
+}
+
 typedef Vec2<float> Vec2f;
 typedef Vec2<int> Vec2i;
 typedef Vec3<float> Vec3f;
@@ -168,7 +322,7 @@ std::ostream& operator<<(std::ostream& s, Vec4<t>& v) {
 
 class Matrix {
  private:
-  vector<float> m;
+  float m[MAX_ALLOC * MAX_ALLOC];  // inline, a temporary never allocates
   int rows = 0;
   int columns = 0;
 
@@ -177,13 +331,13 @@ class Matrix {
   const int& getColumns() const { return columns; }
 
   Matrix(const int rows = MAX_ALLOC, const int columns = MAX_ALLOC) {
-    m = vector<float>(rows * columns, 0.f);
+    assert(rows * columns <= MAX_ALLOC * MAX_ALLOC);
+    std::fill(m, m + rows * columns, 0.f);
     this->rows = rows;
     this->columns = columns;
   }
 
   Matrix(const Vec4f& v) {
-    m = vector<float>(4, 0.);
     this->rows = 4;
     this->columns = 1;
 
@@ -193,7 +347,6 @@ class Matrix {
   }
 
   Matrix(const Vec3f& v) {
-    m = vector<float>(3, 0.);
     this->rows = 3;
     this->columns = 1;
 
@@ -366,4 +519,95 @@ class Matrix {
   }
 };
 
+// points as one array per coordinate, the layout the batch transforms take.
+// The arrays come from memory, a frame arena for per-frame data
+struct Vec3SoA {
+  std::pmr::vector<float> x, y, z;
+
+  Vec3SoA(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : x(memory), y(memory), z(memory) {}
+
+  int size() const { return (int)x.size(); }
+
+  void resize(int count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+  }
+
+  void push_back(const Vec3f& v) {
+    x.push_back(v.x);
+    y.push_back(v.y);
+    z.push_back(v.z);
+  }
+
+  Vec3f operator[](int i) const { return Vec3f(x[i], y[i], z[i]); }
+};
+
+struct Vec4SoA {
+  std::pmr::vector<float> x, y, z, w;
+
+  Vec4SoA(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : x(memory), y(memory), z(memory), w(memory) {}
+
+  int size() const { return (int)x.size(); }
+
+  void resize(int count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    w.resize(count);
+  }
+
+  Vec4f operator[](int i) const { return Vec4f(x[i], y[i], z[i], w[i]); }
+};
+
+// runs body(begin, end) over contiguous ranges of [0, count) on up to threads
+// threads (0 = one per core), ranges are never shorter than grain. A template
+// so the serial case costs nothing, not even a std::function
+template <class Body>
+void parallelFor(int count, int grain, int threads, const Body& body) {
+  if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  grain = std::max(1, grain);
+  threads = std::max(1, std::min(threads, count / grain));
+
+  if (threads == 1) {
+    if (count > 0) body(0, count);
+    return;
+  }
+
+  int chunk = (count + threads - 1) / threads;
+  vector<std::thread> workers;
+
+  for (int t = 1; t < threads; t++) {
+    int begin = t * chunk;
+    int end = std::min(count, begin + chunk);
+    if (begin < end) {
+      workers.emplace_back([&body, begin, end] { body(begin, end); });
+    }
+  }
+
+  body(0, std::min(count, chunk));
+
+  for (std::thread& worker : workers) worker.join();
+}
+
+// out = m * (in, w) for every point, m is 4x4. Vectorized across points with
+// the kernels of cpu.h, same results as Matrix * Matrix(Vec4f(in[i], w)).
+// threads != 1 splits very large arrays with parallelFor
+void transformBatch(const Matrix& m, const Vec3SoA& in, float w, Vec4SoA& out,
+                    int threads = 1);
+
+// perspective divide and viewport mapping of clip coords, the batch version
+// of (viewport * clip).hogenize(). ndc gets clip.hogenize() when not null
+void projectBatch(const Vec4SoA& clip, const Matrix& viewport, Vec3SoA& screen,
+                  Vec3SoA* ndc = nullptr, int threads = 1);
+
+// the two above on [begin, end) of outputs already sized, for callers that
+// split the work themselves
+void transformRange(const Matrix& m, const Vec3SoA& in, float w, Vec4SoA& out,
+                    int begin, int end);
+void projectRange(const Vec4SoA& clip, const Matrix& viewport, Vec3SoA& screen,
+                  Vec3SoA* ndc, int begin, int end);
+
 #endif  //__GEOMETRY_H__
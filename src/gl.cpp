@@ -1,14 +1,69 @@
 #include "gl.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "bvh.h"
+#include "cpu.h"
 #include "geometry.h"
+#include "kernels.h"
+#include "meshlet.h"
+#include "model.h"
 #include "tgaimage.h"
+#include "trace.h"
 
-Matrix ModelView;
-Matrix ViewPort;
-Matrix Projection;
+const float FAR_DEPTH = std::numeric_limits<int>::min();
 
 IShader::~IShader() {}
 
+void IShader::setInstance(const Matrix&) {}
+
+void IShader::shadeMeshlets(const Meshlets&, const int*, int, int) {}
+
+RenderContext::RenderContext(int width, int height)
+    : width(width),
+      height(height),
+      framebuffer(width, height, TGAImage::RGBA),
+      zbuffer(width * height),
+      rowXs(width),
+      rowBars(width * 3),
+      shadingBlocks(width) {
+  clear();
+}
+
+void RenderContext::clear() {
+  uint32_t* pixels = (uint32_t*)framebuffer.buffer();
+  std::fill(pixels, pixels + width * height, 0xff000000u);
+  std::fill(zbuffer.begin(), zbuffer.end(), FAR_DEPTH);
+  std::fill(sampleColor.begin(), sampleColor.end(), 0xff000000u);
+  std::fill(sampleDepth.begin(), sampleDepth.end(), FAR_DEPTH);
+  stats.reset();
+  arena.reset();
+}
+
+void RenderContext::setSamples(int count) {
+  count = count >= 8 ? 8 : count >= 4 ? 4 : count >= 2 ? 2 : 1;
+  if (count == samples) return;
+
+  samples = count;
+  bool multisampled = samples > 1;
+  long plane = (long)width * height;
+
+  sampleDepth.assign(multisampled ? plane * samples : 0, FAR_DEPTH);
+  sampleColor.assign(multisampled ? plane * samples : 0, 0xff000000u);
+  rowCoverage.assign(multisampled ? width : 0, 0u);
+  rowCentroid.assign(multisampled ? width * 3 : 0, 0.f);
+}
+
+long RenderContext::coveredPixels() const {
+  return std::count_if(zbuffer.begin(), zbuffer.end(),
+                       [](float depth) { return depth != FAR_DEPTH; });
+}
+
 Vec4f getBarycentric(Vec3f vertex[], Vec3i point) {
   Vec3f x_vertex = Vec3f(vertex[1].x - vertex[0].x, vertex[2].x - vertex[0].x,
                          vertex[0].x - point.x);
@@ -22,11 +77,14 @@ Vec4f getBarycentric(Vec3f vertex[], Vec3i point) {
   return Vec4f(1 - (u.x / u.z + u.y / u.z), u.x / u.z, u.y / u.z, 0.f);
 }
 
-void drawTriangle(Vec3f points[], float z_buffer[], SDL_Renderer* renderer,
-                  IShader& shader, Vec2f windowDimensions) {
-  Vec2f bboxmin(windowDimensions);
+// bounding box and barycentric steps of a screen triangle, false when it
+// cannot cover a pixel (getBarycentric would reject every one of them)
+static bool setupTriangle(const Vec3f points[], int width, int height,
+                          RasterTriangle& triangle, int& x0, int& x1, int& y0,
+                          int& y1) {
+  Vec2f bboxmin(width, height);
   Vec2f bboxmax(0, 0);
-  Vec2f clamp(windowDimensions);
+  Vec2f clamp(width, height);
 
   for (int i = 0; i < 3; i++) {
     bboxmin.x = std::max(0.f, std::min(bboxmin.x, points[i].x));
@@ -36,41 +94,506 @@ void drawTriangle(Vec3f points[], float z_buffer[], SDL_Renderer* renderer,
     bboxmax.y = std::min(clamp.y, std::max(bboxmax.y, points[i].y));
   }
 
-  Vec3i P;
-  for (P.y = bboxmin.y; P.y < bboxmax.y; P.y++) {
-    for (P.x = bboxmin.x; P.x < bboxmax.x; P.x++) {
-      Vec4f barycentric = getBarycentric(points, P);
+  float area = (points[1].x - points[0].x) * (points[2].y - points[0].y) -
+               (points[2].x - points[0].x) * (points[1].y - points[0].y);
+
+  if (bboxmin.x >= bboxmax.x || bboxmin.y >= bboxmax.y ||
+      std::abs(area) < 1) {
+    return false;
+  }
+
+  // same barycentrics as getBarycentric, stepped per pixel by the kernels
+  triangle.originX = points[0].x;
+  triangle.originY = points[0].y;
+  triangle.b1x = (points[2].y - points[0].y) / area;
+  triangle.b1y = -(points[2].x - points[0].x) / area;
+  triangle.b2x = -(points[1].y - points[0].y) / area;
+  triangle.b2y = (points[1].x - points[0].x) / area;
+  triangle.z0 = points[0].z;
+  triangle.z1 = points[1].z;
+  triangle.z2 = points[2].z;
+
+  x0 = bboxmin.x;
+  x1 = std::ceil(bboxmax.x);
+  y0 = bboxmin.y;
+  y1 = std::ceil(bboxmax.y);
+  return true;
+}
+
+// sample offsets from the pixel center, the usual rotated patterns in 1/16
+// of a pixel so no two samples share a row or a column
+static const float SAMPLES_2[] = {4, 4, -4, -4};
+static const float SAMPLES_4[] = {-2, -6, 6, -2, -6, 2, 2, 6};
+static const float SAMPLES_8[] = {1,  -3, -1, 3, 5,  1, -3, -5,
+                                  -5, 5,  -7, -1, 3, 7, 7,  -7};
+
+static const float* samplePattern(int samples) {
+  return samples == 8 ? SAMPLES_8 : samples == 4 ? SAMPLES_4 : SAMPLES_2;
+}
+
+// depth tests every sample of the pixels the triangle touches and queues one
+// fragment per pixel with any sample left, shaded at the pixel center or at a
+// covered sample when the center falls outside the triangle
+static void rasterSamples(RenderContext& ctx, const RasterTriangle& triangle,
+                          int x0, int x1, int y0, int y1) {
+  RasterRowKernel rasterRow = kernels().rasterRow;
+  const float* pattern = samplePattern(ctx.samples);
+  long plane = (long)ctx.width * ctx.height;
+  unsigned* coverage = ctx.rowCoverage.data();
+  float* centroid = ctx.rowCentroid.data();
 
-      if (barycentric.x < 0. || barycentric.y < 0. || barycentric.z < 0.)
-        continue;  // out of triangleBounds
+  // samples reach up to half a pixel past the centers the bounding box covers
+  x1 = std::min(ctx.width, x1 + 1);
+  y1 = std::min(ctx.height, y1 + 1);
 
-      P.z = 0;
+  for (int y = y0; y < y1; y++) {
+    STATS_ADD(ctx.stats, pixelsTested, x1 - x0);
+    std::fill(coverage + x0, coverage + x1, 0u);
 
-      // z coords aproximation
-      for (int i = 0; i < 3; i++) {
-        P.z = P.z + points[i].z * barycentric[i];
+    for (int s = 0; s < ctx.samples; s++) {
+      // moving the origin against the offset puts the sample on x, y
+      RasterTriangle shifted = triangle;
+      shifted.originX -= pattern[s * 2] / 16.f;
+      shifted.originY -= pattern[s * 2 + 1] / 16.f;
+
+      float* depthRow = ctx.sampleDepth.data() + s * plane + y * ctx.width;
+      int count = rasterRow(&shifted, y, x0, x1, depthRow, ctx.rowXs.data(),
+                            ctx.rowBars.data());
+
+      STATS_ADD(ctx.stats, samplesCovered, count);
+
+      for (int i = 0; i < count; i++) {
+        int x = ctx.rowXs[i];
+        if (!coverage[x]) {
+          std::memcpy(&centroid[x * 3], &ctx.rowBars[i * 3], sizeof(float) * 3);
+        }
+        coverage[x] |= 1u << s;
       }
+    }
+
+    float dy = y - triangle.originY;
+
+    for (int x = x0; x < x1; x++) {
+      if (!coverage[x]) continue;
+
+      float dx = x - triangle.originX;
+      float b1 = triangle.b1y * dy + triangle.b1x * dx;
+      float b2 = triangle.b2y * dy + triangle.b2x * dx;
+      Vec4f bar(1.f - (b1 + b2), b1, b2, 0.f);
+
+      if (bar.x < 0.f || b1 < 0.f || b2 < 0.f) {
+        const float* inside = &centroid[x * 3];
+        bar = Vec4f(inside[0], inside[1], inside[2], 0.f);
+      }
+
+      ctx.fragments.push_back(Fragment{x, y, bar, coverage[x]});
+    }
+  }
+}
 
-      if (z_buffer[P.x + P.y * (int)windowDimensions.x] < P.z) {
-        z_buffer[P.x + P.y * (int)windowDimensions.x] = P.z;
+// runs the bound shader, false when it discards the fragment
+static bool shadeFragment(RenderContext& ctx, const Fragment& fragment,
+                          uint32_t& color) {
+  TGAColor shadedColor;
+
+  STATS_ADD(ctx.stats, fragmentsShaded, 1);
+
+  if (ctx.shader->fragment(fragment.bar, shadedColor)) {
+    STATS_ADD(ctx.stats, fragmentDiscards, 1);
+    return false;
+  }
+
+  shadedColor[3] = 255;
+  std::memcpy(&color, shadedColor.bgra, sizeof(color));
+  return true;
+}
+
+// to the framebuffer, or copied to every covered msaa sample
+static void writeFragment(RenderContext& ctx, const Fragment& fragment,
+                          uint32_t color) {
+  long pixel = fragment.x + (long)fragment.y * ctx.width;
+
+  if (ctx.samples == 1) {
+    ((uint32_t*)ctx.framebuffer.buffer())[pixel] = color;
+    return;
+  }
 
-        TGAColor shadedColor;
+  uint32_t* sample = ctx.sampleColor.data() + pixel;
+  long plane = (long)ctx.width * ctx.height;
 
-        if (shader.fragment(barycentric, shadedColor)) {
-          continue;
+  for (int s = 0; s < ctx.samples; s++, sample += plane) {
+    if (fragment.coverage & (1u << s)) *sample = color;
+  }
+}
+
+// largest difference between the channels of two BGRA colors
+static int colorDistance(uint32_t a, uint32_t b) {
+  int distance = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    int difference = (int)((a >> shift) & 0xff) - (int)((b >> shift) & 0xff);
+    distance = std::max(distance, std::abs(difference));
+  }
+  return distance;
+}
+
+enum ShadingBlockState {
+  BLOCK_ANCHORED,  // one fragment shaded, waiting for the rate check
+  BLOCK_COARSE,    // the rest reuse its color
+  BLOCK_FULL       // every fragment shaded
+};
+
+void drawTriangle(RenderContext& ctx, Vec3f points[]) {
+  TRACE_SCOPE("drawTriangle");
+
+  float* z_buffer = ctx.zbuffer.data();
+
+  STATS_ADD(ctx.stats, trianglesSubmitted, 1);
+
+  RasterTriangle triangle;
+  int x0, x1, y0, y1;
+
+  {
+    STATS_TIMER(ctx.stats, STAGE_SETUP);
+
+    if (!setupTriangle(points, ctx.width, ctx.height, triangle, x0, x1, y0,
+                       y1)) {
+      STATS_ADD(ctx.stats, trianglesCulled, 1);
+      return;
+    }
+  }
+
+  STATS_ADD(ctx.stats, trianglesRasterized, 1);
+
+  // depth is resolved for the whole triangle first, then the survivors shaded
+  ctx.fragments.clear();
+
+  {
+    STATS_TIMER(ctx.stats, STAGE_RASTER);
+
+    if (ctx.samples > 1) {
+      rasterSamples(ctx, triangle, x0, x1, y0, y1);
+    } else {
+      RasterRowKernel rasterRow = kernels().rasterRow;
+
+      for (int y = y0; y < y1; y++) {
+        STATS_ADD(ctx.stats, pixelsTested, x1 - x0);
+
+        int count = rasterRow(&triangle, y, x0, x1, z_buffer + y * ctx.width,
+                              ctx.rowXs.data(), ctx.rowBars.data());
+
+        for (int i = 0; i < count; i++) {
+          const float* bar = &ctx.rowBars[i * 3];
+          ctx.fragments.push_back(
+              Fragment{ctx.rowXs[i], y, Vec4f(bar[0], bar[1], bar[2], 0.f)});
         }
+      }
+    }
+
+    STATS_ADD(ctx.stats, depthPasses, ctx.fragments.size());
+  }
 
-        SDL_SetRenderDrawColor(renderer, shadedColor[2], shadedColor[1],
-                               shadedColor[0], 100);
+  STATS_TIMER(ctx.stats, STAGE_SHADE);
 
-        SDL_RenderDrawPoint(renderer, windowDimensions.x - P.x,
-                            windowDimensions.y - P.y);
+  const int shift = ctx.shadingRate >= 4 ? 2 : ctx.shadingRate >= 2 ? 1 : 0;
+  int blockRow = -1;
+
+  for (const Fragment& fragment : ctx.fragments) {
+    uint32_t color;
+    bool visible;
+
+    if (!shift) {
+      if (shadeFragment(ctx, fragment, color)) {
+        writeFragment(ctx, fragment, color);
       }
+      continue;
     }
+
+    // fragments come row by row, a new block row means new blocks
+    if (fragment.y >> shift != blockRow) {
+      blockRow = fragment.y >> shift;
+      ctx.blockStamp++;
+    }
+
+    ShadingBlock& block = ctx.shadingBlocks[fragment.x >> shift];
+
+    if (block.stamp != ctx.blockStamp) {
+      block.stamp = ctx.blockStamp;
+      block.state = ctx.rateThreshold > 0 ? BLOCK_ANCHORED : BLOCK_COARSE;
+      block.visible = shadeFragment(ctx, fragment, block.color);
+      visible = block.visible;
+      color = block.color;
+    } else if (block.state == BLOCK_COARSE) {
+      STATS_ADD(ctx.stats, fragmentsReused, 1);
+      visible = block.visible;
+      color = block.color;
+    } else {
+      visible = shadeFragment(ctx, fragment, color);
+
+      if (block.state == BLOCK_ANCHORED) {
+        bool similar = visible == block.visible &&
+                       (!visible || colorDistance(color, block.color) <=
+                                        ctx.rateThreshold);
+        block.state = similar ? BLOCK_COARSE : BLOCK_FULL;
+      }
+    }
+
+    if (visible) writeFragment(ctx, fragment, color);
   }
 }
 
-void lookat(Vec3f center, Vec3f eye, Vec3f up) {
+void resolveSamples(RenderContext& ctx) {
+  if (ctx.samples <= 1) return;
+
+  TRACE_SCOPE("resolveSamples");
+  STATS_TIMER(ctx.stats, STAGE_RESOLVE);
+
+  const int samples = ctx.samples;
+  const int shift = samples == 8 ? 3 : samples == 4 ? 2 : 1;
+  const long plane = (long)ctx.width * ctx.height;
+  const uint32_t* colors = ctx.sampleColor.data();
+  const float* depths = ctx.sampleDepth.data();
+  uint32_t* pixels = (uint32_t*)ctx.framebuffer.buffer();
+  float* zbuffer = ctx.zbuffer.data();
+
+  // blue/red and green/alpha summed two at a time in 16 bit lanes, 8 samples
+  // of 255 still fit
+  const uint32_t rounding = (samples / 2) * 0x00010001u;
+
+  for (long i = 0; i < plane; i++) {
+    uint32_t br = rounding;
+    uint32_t ga = rounding;
+    float depth = depths[i];
+
+    for (int s = 0; s < samples; s++) {
+      uint32_t color = colors[s * plane + i];
+      br += color & 0x00ff00ffu;
+      ga += (color >> 8) & 0x00ff00ffu;
+      depth = std::max(depth, depths[s * plane + i]);
+    }
+
+    pixels[i] = ((br >> shift) & 0x00ff00ffu) |
+                (((ga >> shift) & 0x00ff00ffu) << 8);
+    zbuffer[i] = depth;
+  }
+}
+
+static void drawFace(RenderContext& ctx, int face) {
+  Vec3f screen_coords[3];
+  {
+    TRACE_SCOPE("shader.vertex");
+    STATS_TIMER(ctx.stats, STAGE_VERTEX);
+
+    for (int j = 0; j < 3; j++) {
+      screen_coords[j] = ctx.shader->vertex(face, j);
+    }
+  }
+
+  drawTriangle(ctx, screen_coords);
+}
+
+// ctx.visibleFaces gets the faces ctx.bvh can't rule out for the bound model
+// placed by transform, false when there are none
+static bool cullFaces(RenderContext& ctx, const Matrix& transform) {
+  STATS_TIMER(ctx.stats, STAGE_VERTEX);
+
+  [[maybe_unused]] int culled = ctx.bvh->cullFaces(
+      ctx.Projection * ctx.ModelView * transform, ctx.visibleFaces);
+  STATS_ADD(ctx.stats, facesCulled, culled);
+
+  // back to the model order, in bvh order the same faces pass the depth test
+  // (and get shaded) more often
+  std::sort(ctx.visibleFaces.begin(), ctx.visibleFaces.end());
+  return !ctx.visibleFaces.empty();
+}
+
+// ctx.visibleMeshlets gets the bound meshlets that may be visible for the
+// bound model placed by transform, false when there are none
+static bool cullMeshlets(RenderContext& ctx, const Matrix& transform) {
+  STATS_TIMER(ctx.stats, STAGE_VERTEX);
+
+  const Meshlets& meshlets = *ctx.meshlets;
+  [[maybe_unused]] int culled =
+      meshlets.cull(ctx.Projection * ctx.ModelView * transform,
+                    ctx.cullBackfaces, ctx.visibleMeshlets, ctx.meshletThreads);
+  STATS_ADD(ctx.stats, facesCulled, culled);
+  STATS_ADD(ctx.stats, meshletsCulled,
+            meshlets.meshlets.size() - ctx.visibleMeshlets.size());
+  return !ctx.visibleMeshlets.empty();
+}
+
+// the vertex stage of ctx.visibleMeshlets, then their faces meshlet by
+// meshlet
+static void drawMeshlets(RenderContext& ctx) {
+  const Meshlets& meshlets = *ctx.meshlets;
+  {
+    TRACE_SCOPE("shader.shadeMeshlets");
+    STATS_TIMER(ctx.stats, STAGE_VERTEX);
+    ctx.shader->shadeMeshlets(meshlets, ctx.visibleMeshlets.data(),
+                              ctx.visibleMeshlets.size(), ctx.meshletThreads);
+  }
+  STATS_ADD(ctx.stats, meshletsDrawn, ctx.visibleMeshlets.size());
+
+  for (int index : ctx.visibleMeshlets) {
+    const Meshlet& meshlet = meshlets.meshlets[index];
+    const int* faces = &meshlets.faces[meshlet.faceOffset];
+    for (int i = 0; i < meshlet.faceCount; i++) drawFace(ctx, faces[i]);
+  }
+}
+
+void drawModel(RenderContext& ctx) {
+  TRACE_SCOPE("drawModel");
+
+  if (ctx.meshlets) {
+    if (cullMeshlets(ctx, Matrix::identity(4))) drawMeshlets(ctx);
+    return;
+  }
+
+  if (!ctx.bvh) {
+    for (int i = 0; i < ctx.model->nfaces(); i++) drawFace(ctx, i);
+    return;
+  }
+
+  if (!cullFaces(ctx, Matrix::identity(4))) return;
+  for (int face : ctx.visibleFaces) drawFace(ctx, face);
+}
+
+void drawInstanced(RenderContext& ctx, const Matrix* transforms, int count) {
+  TRACE_SCOPE("drawInstanced");
+
+  for (int i = 0; i < count; i++) {
+    bool visible = ctx.meshlets ? cullMeshlets(ctx, transforms[i])
+                   : ctx.bvh    ? cullFaces(ctx, transforms[i])
+                                : true;
+    if (!visible) {
+      STATS_ADD(ctx.stats, instancesCulled, 1);
+      continue;
+    }
+
+    {
+      STATS_TIMER(ctx.stats, STAGE_VERTEX);
+      ctx.shader->setInstance(transforms[i]);
+    }
+
+    STATS_ADD(ctx.stats, instancesDrawn, 1);
+
+    if (ctx.meshlets) {
+      drawMeshlets(ctx);
+    } else if (ctx.bvh) {
+      for (int face : ctx.visibleFaces) drawFace(ctx, face);
+    } else {
+      for (int face = 0; face < ctx.model->nfaces(); face++) {
+        drawFace(ctx, face);
+      }
+    }
+  }
+}
+
+int drawTriangleDepth(float* depth, int width, int height, Vec3f points[]) {
+  RasterTriangle triangle;
+  int x0, x1, y0, y1;
+
+  if (!setupTriangle(points, width, height, triangle, x0, x1, y0, y1)) {
+    return 0;
+  }
+
+  DepthRowKernel depthRow = kernels().depthRow;
+  int written = 0;
+
+  for (int y = y0; y < y1; y++) {
+    written += depthRow(&triangle, y, x0, x1, depth + y * width);
+  }
+
+  return written;
+}
+
+void renderShadowMap(RenderContext& ctx, Vec3f light, Vec3f center) {
+  const Vec3SoA& positions = ctx.model->positions();
+
+  // the whole model has to fit in the orthographic light frustum
+  float radius = 0.f;
+  for (int i = 0; i < positions.size(); i++) {
+    radius = std::max(radius, (positions[i] - center).norm());
+  }
+
+  Matrix identity = Matrix::identity(4);
+  fitShadowMap(ctx, light, center, radius);
+  drawShadowCasters(ctx, *ctx.model, &identity, 1);
+}
+
+void fitShadowMap(RenderContext& ctx, Vec3f light, Vec3f center,
+                  float radius) {
+  STATS_TIMER(ctx.stats, STAGE_SHADOW);
+
+  ShadowMap& shadow = ctx.shadow;
+  radius = std::max(radius, 1e-3f);
+
+  light.normalize();
+  Vec3f up(0.f, 1.f, 0.f);
+  if (std::abs(light * up) > 0.99f) up = Vec3f(1.f, 0.f, 0.f);
+
+  shadow.ModelView = lookatMatrix(center + light, center, up);
+  shadow.Projection = projectionMatrix(0.f);
+  for (int i = 0; i < 3; i++) shadow.Projection(i, i) = 1.f / radius;
+  shadow.ViewPort = viewportMatrix(shadow.size, shadow.size, 0, 0);
+
+  std::fill(shadow.depth.begin(), shadow.depth.end(), FAR_DEPTH);
+}
+
+void drawShadowCasters(RenderContext& ctx, Model& model,
+                       const Matrix* transforms, int count) {
+  TRACE_SCOPE("shadow pass");
+  STATS_TIMER(ctx.stats, STAGE_SHADOW);
+
+  ShadowMap& shadow = ctx.shadow;
+  Matrix light = shadow.Projection * shadow.ModelView;
+
+  // shared by the instances, the arena only grows with the model
+  Vec4SoA clip(&ctx.arena);
+  Vec3SoA screen(&ctx.arena);
+
+  for (int instance = 0; instance < count; instance++) {
+    transformBatch(light * transforms[instance], model.positions(), 1.f,
+                   clip);
+    projectBatch(clip, shadow.ViewPort, screen);
+
+    for (int i = 0; i < model.nfaces(); i++) {
+      const std::vector<int>& face = model.face(i);
+      Vec3f points[3] = {screen[face[0]], screen[face[1]], screen[face[2]]};
+
+      [[maybe_unused]] int written = drawTriangleDepth(
+          shadow.depth.data(), shadow.size, shadow.size, points);
+
+      STATS_ADD(ctx.stats, shadowTriangles, written > 0);
+      STATS_ADD(ctx.stats, shadowDepthWrites, written);
+    }
+  }
+}
+
+void ShadowMap::resize(int size) {
+  this->size = std::max(0, size);
+  depth.assign(this->size * this->size, FAR_DEPTH);
+}
+
+float ShadowMap::lit(Vec3f point) const {
+  int cx = std::floor(point.x);
+  int cy = std::floor(point.y);
+  int taps = 0;
+  int litTaps = 0;
+
+  for (int y = cy - pcf; y <= cy + pcf; y++) {
+    for (int x = cx - pcf; x <= cx + pcf; x++) {
+      taps++;
+      if (x < 0 || y < 0 || x >= size || y >= size ||
+          depth[x + y * size] <= point.z + bias) {
+        litTaps++;
+      }
+    }
+  }
+
+  return (float)litTaps / taps;
+}
+
+Matrix lookatMatrix(Vec3f eye, Vec3f center, Vec3f up) {
   Vec3f z = (eye - center).normalize();
   Vec3f x = (z ^ up).normalize();
   Vec3f y = (x ^ z).normalize();
@@ -85,10 +608,20 @@ void lookat(Vec3f center, Vec3f eye, Vec3f up) {
     Traslation(i, 3) = -center[i];
   }
 
-  ModelView = Minv * Traslation;
+  return Minv * Traslation;
 }
 
-void viewport(int w, int h, int x, int y) {
+void frustumPlanes(const Matrix& clip, float planes[5][4]) {
+  for (int j = 0; j < 4; j++) {
+    planes[0][j] = clip(3, j) + clip(0, j);
+    planes[1][j] = clip(3, j) - clip(0, j);
+    planes[2][j] = clip(3, j) + clip(1, j);
+    planes[3][j] = clip(3, j) - clip(1, j);
+    planes[4][j] = clip(3, j);
+  }
+}
+
+Matrix viewportMatrix(int w, int h, int x, int y) {
   Matrix result = Matrix::identity(4);
 
   result(0, 3) = x + w / 2.f;
@@ -99,10 +632,23 @@ void viewport(int w, int h, int x, int y) {
   result(1, 1) = h / 2.f;
   result(2, 2) = 255.f / 2.f;
 
-  ViewPort = result;
+  return result;
 }
 
-void projection(float coeff) {
-  Projection = Matrix::identity(4);
-  Projection(3, 2) = coeff;
+Matrix projectionMatrix(float coeff) {
+  Matrix result = Matrix::identity(4);
+  result(3, 2) = coeff;
+  return result;
 }  // coeff = -1/c
+
+void lookat(RenderContext& ctx, Vec3f eye, Vec3f center, Vec3f up) {
+  ctx.ModelView = lookatMatrix(eye, center, up);
+}
+
+void viewport(RenderContext& ctx, int w, int h, int x, int y) {
+  ctx.ViewPort = viewportMatrix(w, h, x, y);
+}
+
+void projection(RenderContext& ctx, float coeff) {
+  ctx.Projection = projectionMatrix(coeff);
+}
@@ -1,23 +1,185 @@
-#include <SDL2/SDL.h>
+#ifndef __GL_H__
+#define __GL_H__
 
+#include <cstdint>
+#include <vector>
+
+#include "arena.h"
 #include "geometry.h"
+#include "stats.h"
 #include "tgaimage.h"
 
-extern Matrix Projection;
-extern Matrix ModelView;
-extern Matrix ViewPort;
+class Model;
+struct Bvh;
+struct LodChain;
+struct Meshlets;
 
 struct IShader {
   virtual ~IShader();
 
+  // object to world transform of the instance about to be drawn, called by
+  // drawInstanced before its vertices are asked for
+  virtual void setInstance(const Matrix& transform);
+
+  // vertex stage of the visible meshlets of the bound ones, called after
+  // setInstance and before their faces are asked for. Shaders that transform
+  // the whole model in setInstance have nothing to do
+  virtual void shadeMeshlets(const Meshlets& meshlets, const int* visible,
+                             int count, int threads);
+
   virtual Vec3f vertex(int face, int idVert) = 0;  // Vertex processor
 
   virtual bool fragment(Vec4f bar, TGAColor& color) = 0;  // pixel processor
 };
 
-void viewport(int w, int h, int x, int y);
-void projection(float coeff = 0.f);  // coeff = -1/c
-void lookat(Vec3f eye, Vec3f center, Vec3f up);
+// pixel of a triangle that passed the depth test and waits to be shaded
+struct Fragment {
+  int x;
+  int y;
+  Vec4f bar;
+  unsigned coverage = ~0u;  // msaa samples the shaded color goes to
+};
+
+// coarse shading state of one block of a triangle block row
+struct ShadingBlock {
+  int stamp = 0;  // block row it belongs to, RenderContext::blockStamp
+  int state = 0;
+  bool visible = false;  // the shaded fragment was not discarded
+  uint32_t color = 0;    // BGRA of the shaded fragment
+};
+
+// depth of the bound model seen from a directional light, orthographic and
+// fitted around the model
+struct ShadowMap {
+  int size = 0;   // square, 0 = no shadow pass
+  int pcf = 1;    // filter radius in texels, 0 = a single tap
+  float bias = 1.f;  // depth units (0..255) a point may be behind and still lit
+
+  Matrix ModelView = Matrix::identity(4);  // the light camera
+  Matrix Projection = Matrix::identity(4);
+  Matrix ViewPort = Matrix::identity(4);
+  std::vector<float> depth;  // size * size, light raster coords
+
+  void resize(int size);
+
+  // 1 lit to 0 shadowed, point in the light raster coords (ViewPort *
+  // Projection * ModelView, hogenized). Outside the map counts as lit
+  float lit(Vec3f point) const;
+};
+
+// everything a render needs, nothing is shared between two contexts so each
+// one can be driven from its own thread
+struct RenderContext {
+  Matrix ModelView = Matrix::identity(4);
+  Matrix Projection = Matrix::identity(4);
+  Matrix ViewPort = Matrix::identity(4);
+
+  int width;
+  int height;
+  TGAImage framebuffer;        // BGRA in raster coords, y goes up
+  std::vector<float> zbuffer;  // width * height
+
+  IShader* shader = nullptr;  // bound shader
+  Model* model = nullptr;     // bound model
+  const Bvh* bvh = nullptr;   // of the bound model, culls faces off screen
+  // levels of detail of the bound model, renderView and renderScene draw the
+  // coarsest one whose error stays under lodPixelError pixels
+  const LodChain* lods = nullptr;
+  float lodPixelError = 1.f;
+  // of the bound model, replaces the bvh: meshlets off screen, or facing
+  // away with cullBackfaces (closed models only, the rasterizer draws both
+  // sides), skip the vertex stage. The rest are vertex shaded meshlet by
+  // meshlet on meshletThreads (0 = one per core), then rasterized in order
+  const Meshlets* meshlets = nullptr;
+  bool cullBackfaces = false;
+  int meshletThreads = 1;
+
+  PipelineStats stats;               // since the last clear
+  std::vector<Fragment> fragments;  // scratch for drawTriangle
+  std::vector<int> rowXs;           // raster kernel output, width entries
+  std::vector<float> rowBars;       // 3 barycentrics per rowXs entry
+  std::vector<int> visibleFaces;    // what the bvh kept of the bound model
+  std::vector<int> visibleMeshlets;  // what the meshlet culling kept
+  FrameArena arena;                 // per-frame scratch, reset by clear
+  ShadowMap shadow;                 // resize it to get shadows
+
+  // msaa, setSamples allocates. Every sample has its own width * height plane
+  // so the raster kernels run on a sample row like on the zbuffer, and the
+  // resolve streams through the planes in order
+  int samples = 1;
+  std::vector<float> sampleDepth;     // samples planes
+  std::vector<uint32_t> sampleColor;  // BGRA, same layout as sampleDepth
+  std::vector<unsigned> rowCoverage;  // sample mask per pixel of a row
+  std::vector<float> rowCentroid;     // 3 barycentrics of a covered sample
+
+  // coarse shading, set before a draw or for the whole frame: the first
+  // fragment a triangle has in every rate x rate pixel block is shaded and
+  // its color reused by the others, coverage and depth stay per pixel
+  int shadingRate = 1;  // 1, 2 or 4
+  // shades a second fragment of every block too, the block goes back to
+  // full rate when the two differ by more than this per channel. 0 = off
+  int rateThreshold = 0;
+  std::vector<ShadingBlock> shadingBlocks;  // one per block of a row
+  int blockStamp = 0;                       // current triangle block row
+
+  RenderContext(int width, int height);
+
+  // 1, 2, 4 or 8 samples per pixel, other counts round down. Nothing is
+  // reallocated when the count stays the same
+  void setSamples(int count);
+
+  // opaque black, depth to the far plane, stats to zero and the arena empty
+  void clear();
+
+  long coveredPixels() const;  // pixels with something drawn on them
+};
+
+// barycentric coords of point in the screen triangle, x < 0 when outside
+Vec4f getBarycentric(Vec3f vertex[], Vec3i point);
+
+Matrix viewportMatrix(int w, int h, int x, int y);
+Matrix projectionMatrix(float coeff = 0.f);  // coeff = -1/c
+Matrix lookatMatrix(Vec3f eye, Vec3f center, Vec3f up);
+
+// the sides of the view of clip (projection * modelview): inside is
+// -w <= x <= w, -w <= y <= w and w > 0, as planes a x + b y + c z + d >= 0
+// in the space clip maps from
+void frustumPlanes(const Matrix& clip, float planes[5][4]);
+
+void viewport(RenderContext& ctx, int w, int h, int x, int y);
+void projection(RenderContext& ctx, float coeff = 0.f);  // coeff = -1/c
+void lookat(RenderContext& ctx, Vec3f eye, Vec3f center, Vec3f up);
+
+// rasterizes a triangle in screen coords with the bound shader
+void drawTriangle(RenderContext& ctx, Vec3f points[]);
+
+// depth test and write only, no fragments and no shader. Returns the pixels
+// written
+int drawTriangleDepth(float* depth, int width, int height, Vec3f points[]);
+
+// every face of the bound model through the bound shader, with bound
+// meshlets or a bvh the ones they prove off screen are skipped before the
+// vertex stage
+void drawModel(RenderContext& ctx);
+
+// the bound model once per transform, the shader gets each one through
+// setInstance and runs its vertex stage on the shared faces again. With
+// bound meshlets or a bvh instances entirely off screen skip setInstance too
+void drawInstanced(RenderContext& ctx, const Matrix* transforms, int count);
+
+// averages the msaa samples into the framebuffer and the nearest sample depth
+// into the zbuffer, nothing to do with one sample. Timed as STAGE_RESOLVE
+void resolveSamples(RenderContext& ctx);
+
+// fills ctx.shadow with the bound model seen from light (a direction towards
+// the light) around center. Timed as STAGE_SHADOW
+void renderShadowMap(RenderContext& ctx, Vec3f light, Vec3f center);
+
+// the two halves of renderShadowMap for a scene: aims the light camera at a
+// sphere of radius around center and clears the map, then every
+// drawShadowCasters call adds count copies of model placed by transforms
+void fitShadowMap(RenderContext& ctx, Vec3f light, Vec3f center, float radius);
+void drawShadowCasters(RenderContext& ctx, Model& model,
+                       const Matrix* transforms, int count);
 
-void drawTriangle(Vec3f points[], float z_buffer[], SDL_Renderer* renderer,
-                  IShader& shader, Vec2f windowDimensions);
+#endif  //__GL_H__
@@ -0,0 +1,43 @@
+#include "imagecompare.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include "tgaimage.h"
+
+ImageDiff compareImages(TGAImage& a, TGAImage& b, int tolerance) {
+  ImageDiff diff;
+
+  diff.sameSize = a.get_width() == b.get_width() &&
+                  a.get_height() == b.get_height() && a.buffer() &&
+                  b.buffer();
+  if (!diff.sameSize) return diff;
+
+  double squares = 0.;
+  int channels = std::min(3, std::min(a.get_bytespp(), b.get_bytespp()));
+
+  for (int y = 0; y < a.get_height(); y++) {
+    for (int x = 0; x < a.get_width(); x++) {
+      TGAColor ca = a.get(x, y);
+      TGAColor cb = b.get(x, y);
+
+      int worst = 0;
+      for (int c = 0; c < channels; c++) {
+        int difference = std::abs(ca[c] - cb[c]);
+        worst = std::max(worst, difference);
+        squares += difference * difference;
+      }
+
+      diff.pixels++;
+      diff.maxDifference = std::max(diff.maxDifference, worst);
+      if (worst > tolerance) diff.mismatched++;
+    }
+  }
+
+  diff.mse = squares / (diff.pixels * channels);
+  diff.psnr = diff.mse > 0. ? 10. * std::log10(255. * 255. / diff.mse)
+                            : std::numeric_limits<double>::infinity();
+  return diff;
+}
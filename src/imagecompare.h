@@ -0,0 +1,22 @@
+#ifndef __IMAGECOMPARE_H__
+#define __IMAGECOMPARE_H__
+
+#include "tgaimage.h"
+
+struct ImageDiff {
+  bool sameSize = false;
+  long pixels = 0;
+  long mismatched = 0;    // pixels with a channel off by more than tolerance
+  int maxDifference = 0;  // worst channel difference
+  double mse = 0.;        // mean squared error over the color channels
+  double psnr = 0.;       // dB, infinite for identical images
+
+  double mismatchedFraction() const {
+    return pixels ? (double)mismatched / pixels : 0.;
+  }
+};
+
+// compares the color channels, alpha is ignored
+ImageDiff compareImages(TGAImage& a, TGAImage& b, int tolerance);
+
+#endif  //__IMAGECOMPARE_H__
@@ -0,0 +1,56 @@
+#ifndef __KERNELS_H__
+#define __KERNELS_H__
+
+// hot loops built once per instruction set, cpu.h picks one at startup.
+// Only plain types cross this interface, every kernels_*.cpp is compiled with
+// its own -m flags and must not instantiate inline code shared with the rest
+// of the library
+
+// a screen triangle, barycentrics are affine in the pixel coords:
+// b1 = b1x * (x - originX) + b1y * (y - originY), same for b2, b0 = 1 - b1 - b2
+struct RasterTriangle {
+  float originX, originY;
+  float b1x, b1y;
+  float b2x, b2y;
+  float z0, z1, z2;
+};
+
+// tests pixels [x0, x1) of row y, the ones inside the triangle and in front of
+// depthRow (indexed by x) write their depth and are appended to xs and to
+// bars (b0 b1 b2 per fragment). Returns the fragment count
+typedef int (*RasterRowKernel)(const RasterTriangle* triangle, int y, int x0,
+                               int x1, float* depthRow, int* xs, float* bars);
+
+// depth only version of RasterRowKernel for shadow maps, returns how many
+// pixels were written
+typedef int (*DepthRowKernel)(const RasterTriangle* triangle, int y, int x0,
+                              int x1, float* depthRow);
+
+// out = matrix (row major 4x4) * (x, y, z, w) for count points stored as
+// separate arrays
+typedef void (*TransformKernel)(const float* matrix, const float* x,
+                                const float* y, const float* z, float w,
+                                int count, float* outX, float* outY,
+                                float* outZ, float* outW);
+
+// nearest texel at (u * width, v * height), 4 bytes (bgra) per sample in out,
+// zero outside the texture like TGAImage::get
+typedef void (*SampleKernel)(const unsigned char* texels, int width,
+                             int height, int bytespp, const float* u,
+                             const float* v, int count, unsigned char* out);
+
+struct KernelTable {
+  RasterRowKernel rasterRow;
+  DepthRowKernel depthRow;
+  TransformKernel transform;
+  SampleKernel sampleNearest;
+};
+
+// every variant fills what it has and leaves the rest untouched, returns
+// false when the file was built without its instruction set
+bool scalarKernels(KernelTable* table);
+bool sse2Kernels(KernelTable* table);
+bool avx2Kernels(KernelTable* table);
+bool avx512Kernels(KernelTable* table);
+
+#endif  //__KERNELS_H__
@@ -0,0 +1,258 @@
+#include "kernels.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+static int rasterRow(const RasterTriangle* t, int y, int x0, int x1,
+                     float* depthRow, int* xs, float* bars) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+  int x = x0;
+
+  const __m256 lanes = _mm256_set_ps(7.f, 6.f, 5.f, 4.f, 3.f, 2.f, 1.f, 0.f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.f);
+
+  for (; x + 8 <= x1; x += 8) {
+    __m256 dx = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)x), lanes),
+                              _mm256_set1_ps(t->originX));
+    __m256 b1 = _mm256_add_ps(_mm256_set1_ps(rowB1),
+                              _mm256_mul_ps(_mm256_set1_ps(t->b1x), dx));
+    __m256 b2 = _mm256_add_ps(_mm256_set1_ps(rowB2),
+                              _mm256_mul_ps(_mm256_set1_ps(t->b2x), dx));
+    __m256 b0 = _mm256_sub_ps(one, _mm256_add_ps(b1, b2));
+
+    __m256 inside = _mm256_and_ps(
+        _mm256_cmp_ps(b0, zero, _CMP_GE_OQ),
+        _mm256_and_ps(_mm256_cmp_ps(b1, zero, _CMP_GE_OQ),
+                      _mm256_cmp_ps(b2, zero, _CMP_GE_OQ)));
+    if (!_mm256_movemask_ps(inside)) continue;
+
+    __m256 z = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t->z0), b0),
+                      _mm256_mul_ps(_mm256_set1_ps(t->z1), b1)),
+        _mm256_mul_ps(_mm256_set1_ps(t->z2), b2));
+    __m256 depth = _mm256_loadu_ps(depthRow + x);
+    __m256 pass =
+        _mm256_and_ps(inside, _mm256_cmp_ps(depth, z, _CMP_LT_OQ));
+
+    int mask = _mm256_movemask_ps(pass);
+    if (!mask) continue;
+
+    _mm256_storeu_ps(depthRow + x, _mm256_blendv_ps(depth, z, pass));
+
+    float lb0[8], lb1[8], lb2[8];
+    _mm256_storeu_ps(lb0, b0);
+    _mm256_storeu_ps(lb1, b1);
+    _mm256_storeu_ps(lb2, b2);
+
+    while (mask) {
+      int i = __builtin_ctz(mask);
+      mask &= mask - 1;
+
+      xs[count] = x + i;
+      bars[count * 3 + 0] = lb0[i];
+      bars[count * 3 + 1] = lb1[i];
+      bars[count * 3 + 2] = lb2[i];
+      count++;
+    }
+  }
+
+  for (; x < x1; x++) {
+    float dx = x - t->originX;
+    float b1 = rowB1 + t->b1x * dx;
+    float b2 = rowB2 + t->b2x * dx;
+    float b0 = 1.f - (b1 + b2);
+
+    if (b0 < 0.f || b1 < 0.f || b2 < 0.f) continue;
+
+    float z = t->z0 * b0 + t->z1 * b1 + t->z2 * b2;
+    if (!(depthRow[x] < z)) continue;
+
+    depthRow[x] = z;
+    xs[count] = x;
+    bars[count * 3 + 0] = b0;
+    bars[count * 3 + 1] = b1;
+    bars[count * 3 + 2] = b2;
+    count++;
+  }
+
+  return count;
+}
+
+static int depthRow(const RasterTriangle* t, int y, int x0, int x1,
+                    float* depthRow) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+  int x = x0;
+
+  const __m256 lanes = _mm256_set_ps(7.f, 6.f, 5.f, 4.f, 3.f, 2.f, 1.f, 0.f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.f);
+
+  for (; x + 8 <= x1; x += 8) {
+    __m256 dx = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps((float)x), lanes),
+                              _mm256_set1_ps(t->originX));
+    __m256 b1 = _mm256_add_ps(_mm256_set1_ps(rowB1),
+                              _mm256_mul_ps(_mm256_set1_ps(t->b1x), dx));
+    __m256 b2 = _mm256_add_ps(_mm256_set1_ps(rowB2),
+                              _mm256_mul_ps(_mm256_set1_ps(t->b2x), dx));
+    __m256 b0 = _mm256_sub_ps(one, _mm256_add_ps(b1, b2));
+
+    __m256 z = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t->z0), b0),
+                      _mm256_mul_ps(_mm256_set1_ps(t->z1), b1)),
+        _mm256_mul_ps(_mm256_set1_ps(t->z2), b2));
+    __m256 depth = _mm256_loadu_ps(depthRow + x);
+    __m256 pass = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(b0, zero, _CMP_GE_OQ),
+                      _mm256_and_ps(_mm256_cmp_ps(b1, zero, _CMP_GE_OQ),
+                                    _mm256_cmp_ps(b2, zero, _CMP_GE_OQ))),
+        _mm256_cmp_ps(depth, z, _CMP_LT_OQ));
+
+    int mask = _mm256_movemask_ps(pass);
+    if (!mask) continue;
+
+    _mm256_storeu_ps(depthRow + x, _mm256_blendv_ps(depth, z, pass));
+    count += __builtin_popcount(mask);
+  }
+
+  for (; x < x1; x++) {
+    float dx = x - t->originX;
+    float b1 = rowB1 + t->b1x * dx;
+    float b2 = rowB2 + t->b2x * dx;
+    float b0 = 1.f - (b1 + b2);
+
+    if (b0 < 0.f || b1 < 0.f || b2 < 0.f) continue;
+
+    float z = t->z0 * b0 + t->z1 * b1 + t->z2 * b2;
+    if (!(depthRow[x] < z)) continue;
+
+    depthRow[x] = z;
+    count++;
+  }
+
+  return count;
+}
+
+static void transform(const float* m, const float* x, const float* y,
+                      const float* z, float w, int count, float* outX,
+                      float* outY, float* outZ, float* outW) {
+  int i = 0;
+  __m256 vw = _mm256_set1_ps(w);
+  float* outs[4] = {outX, outY, outZ, outW};
+
+  for (; i + 8 <= count; i += 8) {
+    __m256 px = _mm256_loadu_ps(x + i);
+    __m256 py = _mm256_loadu_ps(y + i);
+    __m256 pz = _mm256_loadu_ps(z + i);
+
+    for (int row = 0; row < 4; row++) {
+      const float* r = m + row * 4;
+      __m256 sum = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(r[0]), px),
+                                 _mm256_mul_ps(_mm256_set1_ps(r[1]), py));
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(r[2]), pz));
+      sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(r[3]), vw));
+      _mm256_storeu_ps(outs[row] + i, sum);
+    }
+  }
+
+  for (; i < count; i++) {
+    float px = x[i], py = y[i], pz = z[i];
+    outX[i] = m[0] * px + m[1] * py + m[2] * pz + m[3] * w;
+    outY[i] = m[4] * px + m[5] * py + m[6] * pz + m[7] * w;
+    outZ[i] = m[8] * px + m[9] * py + m[10] * pz + m[11] * w;
+    outW[i] = m[12] * px + m[13] * py + m[14] * pz + m[15] * w;
+  }
+}
+
+static void sampleTexel(const unsigned char* texels, int width, int height,
+                        int bytespp, float u, float v, unsigned char* texel) {
+  int x = (int)(u * width);
+  int y = (int)(v * height);
+  texel[0] = texel[1] = texel[2] = texel[3] = 0;
+
+  if (!texels || x < 0 || y < 0 || x >= width || y >= height) return;
+
+  const unsigned char* source = texels + (x + y * width) * bytespp;
+  for (int c = 0; c < bytespp; c++) texel[c] = source[c];
+}
+
+// 32 bit gathers, a 3 byte texel reads one byte past itself so the very last
+// texel of the image stays on the scalar path
+static void sampleNearest(const unsigned char* texels, int width, int height,
+                          int bytespp, const float* u, const float* v,
+                          int count, unsigned char* out) {
+  int i = 0;
+
+  if (texels && bytespp >= 3) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vwidthi = _mm256_set1_epi32(width);
+    const __m256i vheighti = _mm256_set1_epi32(height);
+    const __m256 vwidth = _mm256_set1_ps((float)width);
+    const __m256 vheight = _mm256_set1_ps((float)height);
+    const __m256i vbytespp = _mm256_set1_epi32(bytespp);
+    const __m256i last = _mm256_set1_epi32(width * height - 1);
+    const __m256i keep = _mm256_set1_epi32(bytespp == 4 ? -1 : 0x00ffffff);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+
+    for (; i + 8 <= count; i += 8) {
+      __m256i x = _mm256_cvttps_epi32(
+          _mm256_mul_ps(_mm256_loadu_ps(u + i), vwidth));
+      __m256i y = _mm256_cvttps_epi32(
+          _mm256_mul_ps(_mm256_loadu_ps(v + i), vheight));
+
+      // x >= 0 && y >= 0 && x < width && y < height
+      __m256i valid = _mm256_andnot_si256(
+          _mm256_or_si256(_mm256_cmpgt_epi32(zero, x),
+                          _mm256_cmpgt_epi32(zero, y)),
+          _mm256_and_si256(_mm256_cmpgt_epi32(vwidthi, x),
+                           _mm256_cmpgt_epi32(vheighti, y)));
+
+      __m256i index = _mm256_add_epi32(x, _mm256_mullo_epi32(y, vwidthi));
+      __m256i gather = valid;
+      if (bytespp == 3) {
+        gather = _mm256_andnot_si256(_mm256_cmpeq_epi32(index, last), valid);
+      }
+      index = _mm256_and_si256(index, valid);
+
+      __m256i texel = _mm256_mask_i32gather_epi32(
+          zero, (const int*)texels, _mm256_mullo_epi32(index, vbytespp),
+          gather, 1);
+      texel = _mm256_and_si256(texel, keep);
+      _mm256_storeu_si256((__m256i*)(out + i * 4), texel);
+
+      int tail = _mm256_movemask_ps(_mm256_castsi256_ps(
+          _mm256_xor_si256(_mm256_cmpeq_epi32(gather, valid), minusOne)));
+      while (tail) {
+        int l = __builtin_ctz(tail);
+        tail &= tail - 1;
+        sampleTexel(texels, width, height, bytespp, u[i + l], v[i + l],
+                    out + (i + l) * 4);
+      }
+    }
+  }
+
+  for (; i < count; i++) {
+    sampleTexel(texels, width, height, bytespp, u[i], v[i], out + i * 4);
+  }
+}
+
+bool avx2Kernels(KernelTable* table) {
+  table->rasterRow = rasterRow;
+  table->depthRow = depthRow;
+  table->transform = transform;
+  table->sampleNearest = sampleNearest;
+  return true;
+}
+
+#else
+
+bool avx2Kernels(KernelTable*) { return false; }
+
+#endif
@@ -0,0 +1,152 @@
+#include "kernels.h"
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+// 16 pixels per step, the row tail is a masked step instead of a scalar loop
+static int rasterRow(const RasterTriangle* t, int y, int x0, int x1,
+                     float* depthRow, int* xs, float* bars) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+
+  const __m512 lanes =
+      _mm512_set_ps(15.f, 14.f, 13.f, 12.f, 11.f, 10.f, 9.f, 8.f, 7.f, 6.f,
+                    5.f, 4.f, 3.f, 2.f, 1.f, 0.f);
+  const __m512i laneIndex = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7,
+                                             6, 5, 4, 3, 2, 1, 0);
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.f);
+
+  for (int x = x0; x < x1; x += 16) {
+    __mmask16 active =
+        x1 - x >= 16 ? (__mmask16)0xffff : (__mmask16)((1u << (x1 - x)) - 1);
+
+    __m512 dx = _mm512_sub_ps(_mm512_add_ps(_mm512_set1_ps((float)x), lanes),
+                              _mm512_set1_ps(t->originX));
+    __m512 b1 = _mm512_add_ps(_mm512_set1_ps(rowB1),
+                              _mm512_mul_ps(_mm512_set1_ps(t->b1x), dx));
+    __m512 b2 = _mm512_add_ps(_mm512_set1_ps(rowB2),
+                              _mm512_mul_ps(_mm512_set1_ps(t->b2x), dx));
+    __m512 b0 = _mm512_sub_ps(one, _mm512_add_ps(b1, b2));
+
+    __mmask16 inside = _mm512_mask_cmp_ps_mask(active, b0, zero, _CMP_GE_OQ);
+    inside = _mm512_mask_cmp_ps_mask(inside, b1, zero, _CMP_GE_OQ);
+    inside = _mm512_mask_cmp_ps_mask(inside, b2, zero, _CMP_GE_OQ);
+    if (!inside) continue;
+
+    __m512 z = _mm512_add_ps(
+        _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(t->z0), b0),
+                      _mm512_mul_ps(_mm512_set1_ps(t->z1), b1)),
+        _mm512_mul_ps(_mm512_set1_ps(t->z2), b2));
+    __m512 depth = _mm512_maskz_loadu_ps(inside, depthRow + x);
+    __mmask16 pass = _mm512_mask_cmp_ps_mask(inside, depth, z, _CMP_LT_OQ);
+    if (!pass) continue;
+
+    _mm512_mask_storeu_ps(depthRow + x, pass, z);
+
+    int n = __builtin_popcount(pass);
+    __m512i px = _mm512_add_epi32(_mm512_set1_epi32(x), laneIndex);
+    _mm512_mask_compressstoreu_epi32(xs + count, pass, px);
+
+    float lb0[16], lb1[16], lb2[16];
+    _mm512_mask_compressstoreu_ps(lb0, pass, b0);
+    _mm512_mask_compressstoreu_ps(lb1, pass, b1);
+    _mm512_mask_compressstoreu_ps(lb2, pass, b2);
+
+    for (int i = 0; i < n; i++) {
+      bars[(count + i) * 3 + 0] = lb0[i];
+      bars[(count + i) * 3 + 1] = lb1[i];
+      bars[(count + i) * 3 + 2] = lb2[i];
+    }
+    count += n;
+  }
+
+  return count;
+}
+
+static int depthRow(const RasterTriangle* t, int y, int x0, int x1,
+                    float* depthRow) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+
+  const __m512 lanes =
+      _mm512_set_ps(15.f, 14.f, 13.f, 12.f, 11.f, 10.f, 9.f, 8.f, 7.f, 6.f,
+                    5.f, 4.f, 3.f, 2.f, 1.f, 0.f);
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.f);
+
+  for (int x = x0; x < x1; x += 16) {
+    __mmask16 active =
+        x1 - x >= 16 ? (__mmask16)0xffff : (__mmask16)((1u << (x1 - x)) - 1);
+
+    __m512 dx = _mm512_sub_ps(_mm512_add_ps(_mm512_set1_ps((float)x), lanes),
+                              _mm512_set1_ps(t->originX));
+    __m512 b1 = _mm512_add_ps(_mm512_set1_ps(rowB1),
+                              _mm512_mul_ps(_mm512_set1_ps(t->b1x), dx));
+    __m512 b2 = _mm512_add_ps(_mm512_set1_ps(rowB2),
+                              _mm512_mul_ps(_mm512_set1_ps(t->b2x), dx));
+    __m512 b0 = _mm512_sub_ps(one, _mm512_add_ps(b1, b2));
+
+    __mmask16 inside = _mm512_mask_cmp_ps_mask(active, b0, zero, _CMP_GE_OQ);
+    inside = _mm512_mask_cmp_ps_mask(inside, b1, zero, _CMP_GE_OQ);
+    inside = _mm512_mask_cmp_ps_mask(inside, b2, zero, _CMP_GE_OQ);
+    if (!inside) continue;
+
+    __m512 z = _mm512_add_ps(
+        _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(t->z0), b0),
+                      _mm512_mul_ps(_mm512_set1_ps(t->z1), b1)),
+        _mm512_mul_ps(_mm512_set1_ps(t->z2), b2));
+    __m512 depth = _mm512_maskz_loadu_ps(inside, depthRow + x);
+    __mmask16 pass = _mm512_mask_cmp_ps_mask(inside, depth, z, _CMP_LT_OQ);
+
+    _mm512_mask_storeu_ps(depthRow + x, pass, z);
+    count += __builtin_popcount(pass);
+  }
+
+  return count;
+}
+
+static void transform(const float* m, const float* x, const float* y,
+                      const float* z, float w, int count, float* outX,
+                      float* outY, float* outZ, float* outW) {
+  __m512 vw = _mm512_set1_ps(w);
+  float* outs[4] = {outX, outY, outZ, outW};
+
+  for (int i = 0; i < count; i += 16) {
+    __mmask16 active = count - i >= 16
+                           ? (__mmask16)0xffff
+                           : (__mmask16)((1u << (count - i)) - 1);
+
+    __m512 px = _mm512_maskz_loadu_ps(active, x + i);
+    __m512 py = _mm512_maskz_loadu_ps(active, y + i);
+    __m512 pz = _mm512_maskz_loadu_ps(active, z + i);
+
+    for (int row = 0; row < 4; row++) {
+      const float* r = m + row * 4;
+      __m512 sum = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(r[0]), px),
+                                 _mm512_mul_ps(_mm512_set1_ps(r[1]), py));
+      sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(r[2]), pz));
+      sum = _mm512_add_ps(sum, _mm512_mul_ps(_mm512_set1_ps(r[3]), vw));
+      _mm512_mask_storeu_ps(outs[row] + i, active, sum);
+    }
+  }
+}
+
+bool avx512Kernels(KernelTable* table) {
+  // texture sampling stays on the avx2 gather
+  table->rasterRow = rasterRow;
+  table->depthRow = depthRow;
+  table->transform = transform;
+  return true;
+}
+
+#else
+
+bool avx512Kernels(KernelTable*) { return false; }
+
+#endif
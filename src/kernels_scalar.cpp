@@ -0,0 +1,91 @@
+#include "kernels.h"
+
+static int rasterRow(const RasterTriangle* t, int y, int x0, int x1,
+                     float* depthRow, int* xs, float* bars) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+
+  for (int x = x0; x < x1; x++) {
+    float dx = x - t->originX;
+    float b1 = rowB1 + t->b1x * dx;
+    float b2 = rowB2 + t->b2x * dx;
+    float b0 = 1.f - (b1 + b2);
+
+    if (b0 < 0.f || b1 < 0.f || b2 < 0.f) continue;
+
+    float z = t->z0 * b0 + t->z1 * b1 + t->z2 * b2;
+    if (!(depthRow[x] < z)) continue;
+
+    depthRow[x] = z;
+    xs[count] = x;
+    bars[count * 3 + 0] = b0;
+    bars[count * 3 + 1] = b1;
+    bars[count * 3 + 2] = b2;
+    count++;
+  }
+
+  return count;
+}
+
+static int depthRow(const RasterTriangle* t, int y, int x0, int x1,
+                    float* depthRow) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+
+  for (int x = x0; x < x1; x++) {
+    float dx = x - t->originX;
+    float b1 = rowB1 + t->b1x * dx;
+    float b2 = rowB2 + t->b2x * dx;
+    float b0 = 1.f - (b1 + b2);
+
+    if (b0 < 0.f || b1 < 0.f || b2 < 0.f) continue;
+
+    float z = t->z0 * b0 + t->z1 * b1 + t->z2 * b2;
+    if (!(depthRow[x] < z)) continue;
+
+    depthRow[x] = z;
+    count++;
+  }
+
+  return count;
+}
+
+static void transform(const float* m, const float* x, const float* y,
+                      const float* z, float w, int count, float* outX,
+                      float* outY, float* outZ, float* outW) {
+  for (int i = 0; i < count; i++) {
+    float px = x[i], py = y[i], pz = z[i];
+    outX[i] = m[0] * px + m[1] * py + m[2] * pz + m[3] * w;
+    outY[i] = m[4] * px + m[5] * py + m[6] * pz + m[7] * w;
+    outZ[i] = m[8] * px + m[9] * py + m[10] * pz + m[11] * w;
+    outW[i] = m[12] * px + m[13] * py + m[14] * pz + m[15] * w;
+  }
+}
+
+static void sampleNearest(const unsigned char* texels, int width, int height,
+                          int bytespp, const float* u, const float* v,
+                          int count, unsigned char* out) {
+  for (int i = 0; i < count; i++) {
+    int x = (int)(u[i] * width);
+    int y = (int)(v[i] * height);
+    unsigned char* texel = out + i * 4;
+    texel[0] = texel[1] = texel[2] = texel[3] = 0;
+
+    if (!texels || x < 0 || y < 0 || x >= width || y >= height) continue;
+
+    const unsigned char* source = texels + (x + y * width) * bytespp;
+    for (int c = 0; c < bytespp; c++) texel[c] = source[c];
+  }
+}
+
+bool scalarKernels(KernelTable* table) {
+  table->rasterRow = rasterRow;
+  table->depthRow = depthRow;
+  table->transform = transform;
+  table->sampleNearest = sampleNearest;
+  return true;
+}
@@ -0,0 +1,222 @@
+#include "kernels.h"
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+static inline void emit(int x, float b0, float b1, float b2, int* xs,
+                        float* bars, int& count) {
+  xs[count] = x;
+  bars[count * 3 + 0] = b0;
+  bars[count * 3 + 1] = b1;
+  bars[count * 3 + 2] = b2;
+  count++;
+}
+
+static int rasterRow(const RasterTriangle* t, int y, int x0, int x1,
+                     float* depthRow, int* xs, float* bars) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+  int x = x0;
+
+  const __m128 lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+
+  for (; x + 4 <= x1; x += 4) {
+    __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps((float)x), lanes),
+                           _mm_set1_ps(t->originX));
+    __m128 b1 = _mm_add_ps(_mm_set1_ps(rowB1),
+                           _mm_mul_ps(_mm_set1_ps(t->b1x), dx));
+    __m128 b2 = _mm_add_ps(_mm_set1_ps(rowB2),
+                           _mm_mul_ps(_mm_set1_ps(t->b2x), dx));
+    __m128 b0 = _mm_sub_ps(one, _mm_add_ps(b1, b2));
+
+    __m128 inside = _mm_and_ps(_mm_cmpge_ps(b0, zero),
+                               _mm_and_ps(_mm_cmpge_ps(b1, zero),
+                                          _mm_cmpge_ps(b2, zero)));
+    if (!_mm_movemask_ps(inside)) continue;
+
+    __m128 z = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t->z0), b0),
+                   _mm_mul_ps(_mm_set1_ps(t->z1), b1)),
+        _mm_mul_ps(_mm_set1_ps(t->z2), b2));
+    __m128 depth = _mm_loadu_ps(depthRow + x);
+    __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(depth, z));
+
+    int mask = _mm_movemask_ps(pass);
+    if (!mask) continue;
+
+    _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z),
+                                          _mm_andnot_ps(pass, depth)));
+
+    float lb0[4], lb1[4], lb2[4];
+    _mm_storeu_ps(lb0, b0);
+    _mm_storeu_ps(lb1, b1);
+    _mm_storeu_ps(lb2, b2);
+
+    for (int i = 0; i < 4; i++) {
+      if (mask & (1 << i)) emit(x + i, lb0[i], lb1[i], lb2[i], xs, bars, count);
+    }
+  }
+
+  for (; x < x1; x++) {
+    float dx = x - t->originX;
+    float b1 = rowB1 + t->b1x * dx;
+    float b2 = rowB2 + t->b2x * dx;
+    float b0 = 1.f - (b1 + b2);
+
+    if (b0 < 0.f || b1 < 0.f || b2 < 0.f) continue;
+
+    float z = t->z0 * b0 + t->z1 * b1 + t->z2 * b2;
+    if (!(depthRow[x] < z)) continue;
+
+    depthRow[x] = z;
+    emit(x, b0, b1, b2, xs, bars, count);
+  }
+
+  return count;
+}
+
+static int depthRow(const RasterTriangle* t, int y, int x0, int x1,
+                    float* depthRow) {
+  float dy = y - t->originY;
+  float rowB1 = t->b1y * dy;
+  float rowB2 = t->b2y * dy;
+  int count = 0;
+  int x = x0;
+
+  const __m128 lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.f);
+
+  for (; x + 4 <= x1; x += 4) {
+    __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps((float)x), lanes),
+                           _mm_set1_ps(t->originX));
+    __m128 b1 = _mm_add_ps(_mm_set1_ps(rowB1),
+                           _mm_mul_ps(_mm_set1_ps(t->b1x), dx));
+    __m128 b2 = _mm_add_ps(_mm_set1_ps(rowB2),
+                           _mm_mul_ps(_mm_set1_ps(t->b2x), dx));
+    __m128 b0 = _mm_sub_ps(one, _mm_add_ps(b1, b2));
+
+    __m128 z = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t->z0), b0),
+                   _mm_mul_ps(_mm_set1_ps(t->z1), b1)),
+        _mm_mul_ps(_mm_set1_ps(t->z2), b2));
+    __m128 depth = _mm_loadu_ps(depthRow + x);
+    __m128 pass = _mm_and_ps(
+        _mm_and_ps(_mm_cmpge_ps(b0, zero),
+                   _mm_and_ps(_mm_cmpge_ps(b1, zero), _mm_cmpge_ps(b2, zero))),
+        _mm_cmplt_ps(depth, z));
+
+    int mask = _mm_movemask_ps(pass);
+    if (!mask) continue;
+
+    _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z),
+                                          _mm_andnot_ps(pass, depth)));
+    count += (mask & 1) + (mask >> 1 & 1) + (mask >> 2 & 1) + (mask >> 3);
+  }
+
+  for (; x < x1; x++) {
+    float dx = x - t->originX;
+    float b1 = rowB1 + t->b1x * dx;
+    float b2 = rowB2 + t->b2x * dx;
+    float b0 = 1.f - (b1 + b2);
+
+    if (b0 < 0.f || b1 < 0.f || b2 < 0.f) continue;
+
+    float z = t->z0 * b0 + t->z1 * b1 + t->z2 * b2;
+    if (!(depthRow[x] < z)) continue;
+
+    depthRow[x] = z;
+    count++;
+  }
+
+  return count;
+}
+
+static void transform(const float* m, const float* x, const float* y,
+                      const float* z, float w, int count, float* outX,
+                      float* outY, float* outZ, float* outW) {
+  int i = 0;
+  __m128 vw = _mm_set1_ps(w);
+
+  for (; i + 4 <= count; i += 4) {
+    __m128 px = _mm_loadu_ps(x + i);
+    __m128 py = _mm_loadu_ps(y + i);
+    __m128 pz = _mm_loadu_ps(z + i);
+    float* outs[4] = {outX, outY, outZ, outW};
+
+    for (int row = 0; row < 4; row++) {
+      const float* r = m + row * 4;
+      __m128 sum = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[0]), px),
+                              _mm_mul_ps(_mm_set1_ps(r[1]), py));
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(r[2]), pz));
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(r[3]), vw));
+      _mm_storeu_ps(outs[row] + i, sum);
+    }
+  }
+
+  for (; i < count; i++) {
+    float px = x[i], py = y[i], pz = z[i];
+    outX[i] = m[0] * px + m[1] * py + m[2] * pz + m[3] * w;
+    outY[i] = m[4] * px + m[5] * py + m[6] * pz + m[7] * w;
+    outZ[i] = m[8] * px + m[9] * py + m[10] * pz + m[11] * w;
+    outW[i] = m[12] * px + m[13] * py + m[14] * pz + m[15] * w;
+  }
+}
+
+static void sampleNearest(const unsigned char* texels, int width, int height,
+                          int bytespp, const float* u, const float* v,
+                          int count, unsigned char* out) {
+  int i = 0;
+  int coords[8];
+  __m128 vwidth = _mm_set1_ps((float)width);
+  __m128 vheight = _mm_set1_ps((float)height);
+
+  for (; i < count; i += 4) {
+    int lanes = count - i < 4 ? count - i : 4;
+
+    if (lanes == 4) {  // truncation like the (int) cast
+      _mm_storeu_si128((__m128i*)coords,
+                       _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(u + i),
+                                                   vwidth)));
+      _mm_storeu_si128((__m128i*)(coords + 4),
+                       _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(v + i),
+                                                   vheight)));
+    } else {
+      for (int l = 0; l < lanes; l++) {
+        coords[l] = (int)(u[i + l] * width);
+        coords[l + 4] = (int)(v[i + l] * height);
+      }
+    }
+
+    for (int l = 0; l < lanes; l++) {
+      int x = coords[l];
+      int y = coords[l + 4];
+      unsigned char* texel = out + (i + l) * 4;
+      texel[0] = texel[1] = texel[2] = texel[3] = 0;
+
+      if (!texels || x < 0 || y < 0 || x >= width || y >= height) continue;
+
+      const unsigned char* source = texels + (x + y * width) * bytespp;
+      for (int c = 0; c < bytespp; c++) texel[c] = source[c];
+    }
+  }
+}
+
+bool sse2Kernels(KernelTable* table) {
+  table->rasterRow = rasterRow;
+  table->depthRow = depthRow;
+  table->transform = transform;
+  table->sampleNearest = sampleNearest;
+  return true;
+}
+
+#else
+
+bool sse2Kernels(KernelTable*) { return false; }
+
+#endif
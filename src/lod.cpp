@@ -0,0 +1,561 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <vector>
+
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "trace.h"
+
+// a collapse is refused when it turns a face normal further than this cosine
+const float FLIP_LIMIT = 0.2f;
+const char CACHE_MAGIC[8] = "TRLOD02";
+
+// symmetric 4x4 error quadric, its upper triangle row by row
+struct Quadric {
+  double q[10] = {};
+  double planes = 0.;  // how many were added
+
+  // plane a x + b y + c z + d = 0 with a unit normal
+  void addPlane(double a, double b, double c, double d) {
+    const double p[4] = {a, b, c, d};
+    int k = 0;
+    for (int i = 0; i < 4; i++) {
+      for (int j = i; j < 4; j++) q[k++] += p[i] * p[j];
+    }
+    planes += 1.;
+  }
+
+  Quadric operator+(const Quadric& other) const {
+    Quadric sum;
+    for (int i = 0; i < 10; i++) sum.q[i] = q[i] + other.q[i];
+    sum.planes = planes + other.planes;
+    return sum;
+  }
+
+  // mean of the squared distances of point to the planes
+  double error(Vec3f point) const {
+    if (planes <= 0.) return 0.;
+    const double p[4] = {point.x, point.y, point.z, 1.};
+    double sum = 0.;
+    int k = 0;
+    for (int i = 0; i < 4; i++) {
+      for (int j = i; j < 4; j++) {
+        sum += q[k++] * p[i] * p[j] * (i == j ? 1. : 2.);
+      }
+    }
+    return sum / planes;
+  }
+};
+
+struct LodFace {
+  int vertex[3];
+  int texture[3];
+  int normal[3];
+  bool removed = false;
+};
+
+struct Collapse {
+  double cost;
+  int from;
+  int to;
+  int fromStamp;  // LodMesh::stamps when queued, stale once they move
+  int toStamp;
+
+  bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+struct LodMesh {
+  std::vector<Vec3f> positions;
+  std::vector<LodFace> faces;
+  std::vector<std::vector<int> > vertexFaces;  // may hold removed faces
+  std::vector<Quadric> quadrics;
+  std::vector<bool> locked;   // seam or border, never moves
+  std::vector<bool> removed;  // merged into another vertex
+  std::vector<int> stamps;    // bumped whenever a vertex changes
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> >
+      queue;
+  int liveFaces = 0;
+  float error = 0.f;  // largest collapse so far, object units
+  float maxError = 0.f;  // no collapse goes past it
+};
+
+static Vec3f faceNormal(Vec3f a, Vec3f b, Vec3f c) {
+  return cross(b - a, c - a);
+}
+
+static int cornerOf(const LodFace& face, int vertex) {
+  for (int i = 0; i < 3; i++) {
+    if (face.vertex[i] == vertex) return i;
+  }
+  return -1;
+}
+
+static void queueCollapse(LodMesh& mesh, int from, int to) {
+  if (mesh.locked[from]) return;
+
+  Quadric sum = mesh.quadrics[from] + mesh.quadrics[to];
+  double cost = std::max(0., sum.error(mesh.positions[to]));
+  mesh.queue.push({cost, from, to, mesh.stamps[from], mesh.stamps[to]});
+}
+
+// vertices sharing a live face with vertex, sorted
+static void neighbours(const LodMesh& mesh, int vertex,
+                       std::vector<int>& out) {
+  out.clear();
+  for (int f : mesh.vertexFaces[vertex]) {
+    const LodFace& face = mesh.faces[f];
+    if (face.removed) continue;
+    for (int v : face.vertex) {
+      if (v != vertex) out.push_back(v);
+    }
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+static bool initMesh(Model& model, LodMesh& mesh) {
+  int vertices = model.nverts();
+  for (int i = 0; i < vertices; i++) mesh.positions.push_back(model.vert(i));
+
+  mesh.vertexFaces.resize(vertices);
+  mesh.quadrics.resize(vertices);
+  mesh.locked.assign(vertices, false);
+  mesh.removed.assign(vertices, false);
+  mesh.stamps.assign(vertices, 0);
+
+  std::vector<int> texture(vertices, -1);
+  std::vector<int> normal(vertices, -1);
+  std::vector<uint64_t> edges;
+
+  for (int f = 0; f < model.nfaces(); f++) {
+    const std::vector<int>& ids = model.face(f);
+    if (ids.size() != 3) return false;  // triangles only
+
+    LodFace face;
+    for (int i = 0; i < 3; i++) {
+      face.vertex[i] = ids[i];
+      face.texture[i] = model.texture(f)[i];
+      face.normal[i] = model.vertexNomalsIds(f)[i];
+
+      // a vertex seen with two uvs or two normals is on a seam
+      int v = ids[i];
+      if (texture[v] < 0) texture[v] = face.texture[i];
+      if (normal[v] < 0) normal[v] = face.normal[i];
+      if (texture[v] != face.texture[i] || normal[v] != face.normal[i]) {
+        mesh.locked[v] = true;
+      }
+
+      int a = std::min(ids[i], ids[(i + 1) % 3]);
+      int b = std::max(ids[i], ids[(i + 1) % 3]);
+      edges.push_back((uint64_t)a << 32 | (uint32_t)b);
+
+      mesh.vertexFaces[v].push_back(f);
+    }
+
+    Vec3f n = faceNormal(mesh.positions[ids[0]], mesh.positions[ids[1]],
+                         mesh.positions[ids[2]]);
+    float length = n.norm();
+    if (length > 0.f) {
+      n = n * (1.f / length);
+      double d = -(n * mesh.positions[ids[0]]);
+      for (int v : face.vertex) mesh.quadrics[v].addPlane(n.x, n.y, n.z, d);
+    }
+
+    mesh.faces.push_back(face);
+  }
+
+  // an edge with one face is an open border, with three or more non
+  // manifold, its vertices stay
+  std::sort(edges.begin(), edges.end());
+  for (size_t i = 0; i < edges.size();) {
+    size_t j = i;
+    while (j < edges.size() && edges[j] == edges[i]) j++;
+    if (j - i != 2) {
+      mesh.locked[edges[i] >> 32] = true;
+      mesh.locked[edges[i] & 0xffffffffu] = true;
+    }
+    i = j;
+  }
+
+  mesh.liveFaces = mesh.faces.size();
+
+  for (const LodFace& face : mesh.faces) {
+    for (int i = 0; i < 3; i++) {
+      queueCollapse(mesh, face.vertex[i], face.vertex[(i + 1) % 3]);
+      queueCollapse(mesh, face.vertex[(i + 1) % 3], face.vertex[i]);
+    }
+  }
+
+  return true;
+}
+
+// merges from into to when it keeps the mesh manifold, flips no face and
+// from's faces can take to's uv and normal. False when refused
+static bool collapse(LodMesh& mesh, const Collapse& candidate,
+                     std::vector<int>& scratchA, std::vector<int>& scratchB) {
+  int from = candidate.from;
+  int to = candidate.to;
+  Vec3f target = mesh.positions[to];
+
+  int texture = -1;
+  int normal = -1;
+  std::vector<int>& opposite = scratchA;  // third vertices of shared faces
+  opposite.clear();
+
+  for (int f : mesh.vertexFaces[from]) {
+    const LodFace& face = mesh.faces[f];
+    if (face.removed) continue;
+
+    int corner = cornerOf(face, to);
+    int own = cornerOf(face, from);
+
+    if (corner >= 0) {
+      // the faces along the edge have to agree on to's attributes
+      if (texture >= 0 && (face.texture[corner] != texture ||
+                           face.normal[corner] != normal)) {
+        return false;
+      }
+      texture = face.texture[corner];
+      normal = face.normal[corner];
+      opposite.push_back(face.vertex[3 - corner - own]);
+      continue;
+    }
+
+    Vec3f before[3], after[3];
+    for (int i = 0; i < 3; i++) {
+      before[i] = mesh.positions[face.vertex[i]];
+      after[i] = i == own ? target : before[i];
+    }
+    Vec3f n0 = faceNormal(before[0], before[1], before[2]);
+    Vec3f n1 = faceNormal(after[0], after[1], after[2]);
+    float l0 = n0.norm();
+    float l1 = n1.norm();
+    if (l1 <= 0.f || (l0 > 0.f && (n0 * n1) < FLIP_LIMIT * l0 * l1)) {
+      return false;
+    }
+  }
+
+  if (opposite.empty()) return false;  // no longer an edge
+
+  // link condition: the only neighbours the two share are across the faces
+  // being removed
+  std::vector<int>& common = scratchB;
+  std::vector<int> fromNeighbours, toNeighbours;
+  neighbours(mesh, from, fromNeighbours);
+  neighbours(mesh, to, toNeighbours);
+  common.clear();
+  std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(),
+                        toNeighbours.begin(), toNeighbours.end(),
+                        std::back_inserter(common));
+  std::sort(opposite.begin(), opposite.end());
+  if (common != opposite) return false;
+
+  for (int f : mesh.vertexFaces[from]) {
+    LodFace& face = mesh.faces[f];
+    if (face.removed) continue;
+
+    if (cornerOf(face, to) >= 0) {
+      face.removed = true;
+      mesh.liveFaces--;
+      continue;
+    }
+
+    int own = cornerOf(face, from);
+    face.vertex[own] = to;
+    face.texture[own] = texture;
+    face.normal[own] = normal;
+    mesh.vertexFaces[to].push_back(f);
+  }
+
+  std::vector<int>& faces = mesh.vertexFaces[to];
+  faces.erase(std::remove_if(faces.begin(), faces.end(),
+                             [&](int f) { return mesh.faces[f].removed; }),
+              faces.end());
+  mesh.vertexFaces[from].clear();
+
+  mesh.quadrics[to] = mesh.quadrics[to] + mesh.quadrics[from];
+  mesh.removed[from] = true;
+  mesh.stamps[to]++;
+  mesh.error = std::max(mesh.error, (float)std::sqrt(candidate.cost));
+
+  // to now has from's neighbours too, and a new quadric
+  neighbours(mesh, to, toNeighbours);
+  for (int v : toNeighbours) {
+    queueCollapse(mesh, to, v);
+    queueCollapse(mesh, v, to);
+  }
+
+  return true;
+}
+
+static void bounds(Model& model, LodChain& chain) {
+  Vec3f low(0, 0, 0), high(0, 0, 0);
+  for (int i = 0; i < model.nverts(); i++) {
+    Vec3f v = model.vert(i);
+    low = i ? componentMin(low, v) : v;
+    high = i ? componentMax(high, v) : v;
+  }
+
+  chain.center = (low + high) * 0.5f;
+  chain.radius = 0.f;
+  for (int i = 0; i < model.nverts(); i++) {
+    chain.radius =
+        std::max(chain.radius, (model.vert(i) - chain.center).norm());
+  }
+}
+
+// a simplified level from its corner ids
+static void addLevel(LodChain& chain, const std::vector<int>& corners,
+                     float error) {
+  std::vector<std::vector<int> > faces, textures, normals;
+  for (size_t i = 0; i < corners.size(); i += 9) {
+    faces.push_back({corners[i], corners[i + 3], corners[i + 6]});
+    textures.push_back({corners[i + 1], corners[i + 4], corners[i + 7]});
+    normals.push_back({corners[i + 2], corners[i + 5], corners[i + 8]});
+  }
+
+  chain.simplified.emplace_back(
+      new Model(*chain.source, faces, textures, normals));
+  chain.errors.push_back(error);
+  chain.corners.push_back(corners);
+}
+
+static void resetChain(Model& model, LodChain& chain) {
+  chain.source = &model;
+  chain.simplified.clear();
+  chain.errors.assign(1, 0.f);
+  chain.corners.clear();
+  bounds(model, chain);
+}
+
+void buildLods(Model& model, LodChain& chain, const LodOptions& options) {
+  TRACE_SCOPE("buildLods");
+
+  resetChain(model, chain);
+
+  LodMesh mesh;
+  if (!initMesh(model, mesh)) return;
+  mesh.maxError = options.maxError * chain.radius;
+
+  int levels = std::min(options.levels, LOD_LEVELS);
+  int previous = mesh.liveFaces;
+  std::vector<int> scratchA, scratchB;
+
+  for (int level = 1; level < levels; level++) {
+    int target = std::max(options.minFaces, (int)(previous * options.ratio));
+    if (target >= previous) break;
+
+    while (mesh.liveFaces > target && !mesh.queue.empty()) {
+      Collapse candidate = mesh.queue.top();
+      if (std::sqrt(candidate.cost) > mesh.maxError) break;  // cheapest left
+      mesh.queue.pop();
+
+      if (mesh.removed[candidate.from] || mesh.removed[candidate.to] ||
+          candidate.fromStamp != mesh.stamps[candidate.from] ||
+          candidate.toStamp != mesh.stamps[candidate.to]) {
+        continue;
+      }
+      collapse(mesh, candidate, scratchA, scratchB);
+    }
+
+    // stuck on locked vertices, a level barely smaller is not worth it
+    if (mesh.liveFaces > previous * 0.9f) break;
+
+    std::vector<int> corners;
+    for (const LodFace& face : mesh.faces) {
+      if (face.removed) continue;
+      for (int i = 0; i < 3; i++) {
+        corners.push_back(face.vertex[i]);
+        corners.push_back(face.texture[i]);
+        corners.push_back(face.normal[i]);
+      }
+    }
+    addLevel(chain, corners, mesh.error);
+    previous = mesh.liveFaces;
+  }
+}
+
+// m * v for a 4x4 m
+static Vec4f transformPoint(const Matrix& m, Vec4f v) {
+  Vec4f out;
+  for (int i = 0; i < 4; i++) {
+    out[i] = m(i, 0) * v.x + m(i, 1) * v.y + m(i, 2) * v.z + m(i, 3) * v.w;
+  }
+  return out;
+}
+
+int LodChain::select(const RenderContext& ctx, const Matrix& transform,
+                     float maxPixelError) const {
+  if (simplified.empty() || radius <= 0.f) return 0;
+
+  float scale = 0.f;
+  for (int j = 0; j < 3; j++) {
+    Vec3f axis(transform(0, j), transform(1, j), transform(2, j));
+    scale = std::max(scale, axis.norm());
+  }
+
+  // the bounding sphere in eye space and a point on its rim across the view
+  Vec4f eye = transformPoint(ctx.ModelView * transform, Vec4f(center, 1.f));
+  Vec4f rim = eye + Vec4f(radius * scale, 0.f, 0.f, 0.f);
+  Matrix screen = ctx.ViewPort * ctx.Projection;
+  Vec4f a = transformPoint(screen, eye);
+  Vec4f b = transformPoint(screen, rim);
+
+  // around or behind the eye nothing is small
+  if (a.w <= 0.f || b.w <= 0.f) return 0;
+
+  // errors are in object units, scale of them make the rim offset
+  float pixelsPerUnit = std::abs(b.x / b.w - a.x / a.w) / radius;
+
+  for (int i = levelCount() - 1; i > 0; i--) {
+    if (errors[i] * pixelsPerUnit <= maxPixelError) return i;
+  }
+  return 0;
+}
+
+// what a cache has to match, besides the magic
+struct LodCacheHeader {
+  int32_t vertices;
+  int32_t faces;
+  uint32_t contents[2];  // hash of what the faces use, see modelHash
+  int32_t levels;
+  float ratio;
+  int32_t minFaces;
+  float maxError;
+  int32_t stored;  // simplified levels that follow
+};
+
+// fnv-1a over the ids and values of every face corner, so a model edited
+// without changing its counts gets its levels built again
+static uint64_t modelHash(Model& model) {
+  uint64_t hash = 14695981039346656037ull;
+  auto add = [&](const void* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      hash ^= ((const unsigned char*)data)[i];
+      hash *= 1099511628211ull;
+    }
+  };
+
+  for (int f = 0; f < model.nfaces(); f++) {
+    const std::vector<int>& verts = model.face(f);
+    const std::vector<int>& uvs = model.texture(f);
+    const std::vector<int>& normals = model.vertexNomalsIds(f);
+    for (size_t c = 0; c < verts.size(); c++) {
+      int32_t ids[3] = {verts[c], uvs[c], normals[c]};
+      Vec3f position = model.vert(verts[c]);
+      Vec2f uv = model.textCoord(uvs[c]);
+      Vec3f normal = model.vertexNomal(normals[c]);
+      add(ids, sizeof(ids));
+      add(position.raw, sizeof(position.raw));
+      add(uv.raw, sizeof(uv.raw));
+      add(normal.raw, sizeof(normal.raw));
+    }
+  }
+  return hash;
+}
+
+static LodCacheHeader cacheHeader(Model& model, const LodOptions& options,
+                                  int stored) {
+  uint64_t hash = modelHash(model);
+  return LodCacheHeader{model.nverts(),
+                        model.nfaces(),
+                        {(uint32_t)hash, (uint32_t)(hash >> 32)},
+                        options.levels,
+                        options.ratio,
+                        options.minFaces,
+                        options.maxError,
+                        stored};
+}
+
+bool saveLodCache(const LodChain& chain, const LodOptions& options,
+                  const std::string& path) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out) return false;
+
+  LodCacheHeader header =
+      cacheHeader(*chain.source, options, chain.corners.size());
+  out.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  out.write((const char*)&header, sizeof(header));
+
+  for (size_t level = 0; level < chain.corners.size(); level++) {
+    float error = chain.errors[level + 1];
+    int32_t count = chain.corners[level].size();
+    out.write((const char*)&error, sizeof(error));
+    out.write((const char*)&count, sizeof(count));
+    out.write((const char*)chain.corners[level].data(),
+              count * sizeof(int32_t));
+  }
+
+  return (bool)out;
+}
+
+bool loadLodCache(Model& model, LodChain& chain, const LodOptions& options,
+                  const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+
+  char magic[sizeof(CACHE_MAGIC)];
+  LodCacheHeader header;
+  in.read(magic, sizeof(magic));
+  in.read((char*)&header, sizeof(header));
+
+  LodCacheHeader expected = cacheHeader(model, options, header.stored);
+  if (!in || std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) ||
+      std::memcmp(&header, &expected, sizeof(header)) ||
+      header.stored >= LOD_LEVELS) {
+    return false;
+  }
+
+  // read everything and check the ids before building any level
+  std::vector<float> errors(header.stored);
+  std::vector<std::vector<int> > corners(header.stored);
+  int limits[3] = {model.nverts(), 0, 0};
+  for (int f = 0; f < model.nfaces(); f++) {
+    for (int i = 0; i < 3; i++) {
+      limits[1] = std::max(limits[1], model.texture(f)[i] + 1);
+      limits[2] = std::max(limits[2], model.vertexNomalsIds(f)[i] + 1);
+    }
+  }
+
+  for (int level = 0; level < header.stored; level++) {
+    int32_t count = 0;
+    in.read((char*)&errors[level], sizeof(float));
+    in.read((char*)&count, sizeof(count));
+    if (!in || count < 0 || count % 9 || count / 9 > model.nfaces()) {
+      return false;
+    }
+
+    corners[level].resize(count);
+    in.read((char*)corners[level].data(), count * sizeof(int32_t));
+    if (!in) return false;
+
+    for (int i = 0; i < count; i++) {
+      int id = corners[level][i];
+      if (id < 0 || id >= limits[i % 3]) return false;
+    }
+  }
+
+  resetChain(model, chain);
+  for (int level = 0; level < header.stored; level++) {
+    addLevel(chain, corners[level], errors[level]);
+  }
+  return true;
+}
+
+bool loadOrBuildLods(Model& model, LodChain& chain, const LodOptions& options,
+                     const std::string& path) {
+  if (loadLodCache(model, chain, options, path)) return true;
+
+  buildLods(model, chain, options);
+  saveLodCache(chain, options, path);
+  return false;
+}
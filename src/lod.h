@@ -0,0 +1,66 @@
+#ifndef __LOD_H__
+#define __LOD_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "stats.h"
+
+struct LodOptions {
+  int levels = LOD_LEVELS;  // the source included, at most LOD_LEVELS
+  float ratio = 0.5f;       // faces of a level over the previous one
+  int minFaces = 64;        // no level goes below it
+  float maxError = 0.05f;   // no collapse moves the surface further, as a
+                            // fraction of the bounding radius
+};
+
+// a model and simplified copies of it, coarser with every level. The copies
+// share the source textures and only use its vertex, uv and normal values,
+// so texture and normal seams stay where they were
+struct LodChain {
+  Model* source = nullptr;                    // level 0, not owned
+  std::vector<std::unique_ptr<Model> > simplified;  // levels 1 and up
+  std::vector<float> errors;  // per level, object units, 0 for the source
+  // per simplified level, 9 source ids per face: vertex, uv and normal of
+  // every corner. What the cache stores
+  std::vector<std::vector<int> > corners;
+  Vec3f center;               // bounding sphere of the source
+  float radius = 0.f;
+
+  int levelCount() const { return 1 + simplified.size(); }
+  Model* level(int i) const {
+    return i == 0 ? source : simplified[i - 1].get();
+  }
+
+  // coarsest level whose error stays within maxPixelError pixels for the
+  // model placed by transform in the camera of ctx
+  int select(const RenderContext& ctx, const Matrix& transform,
+             float maxPixelError) const;
+};
+
+// quadric error metric simplification by half edge collapses: a vertex is
+// merged into a neighbour, keeping the neighbour's position, uv and normal.
+// Vertices on a seam (more than one uv or normal) or on an open border never
+// move. Levels are snapshots of one run, each ratio times the last, and the
+// run stops early once every collapse left costs more than maxError
+void buildLods(Model& model, LodChain& chain,
+               const LodOptions& options = LodOptions());
+
+// the faces of every level in a small binary file, false when it is missing
+// or was made from another model or options. Models are told apart by their
+// counts and a hash of the positions, uvs, normals and ids of their faces
+bool saveLodCache(const LodChain& chain, const LodOptions& options,
+                  const std::string& path);
+bool loadLodCache(Model& model, LodChain& chain, const LodOptions& options,
+                  const std::string& path);
+
+// loads the chain from the cache at path, or builds it and writes the cache.
+// Returns true when it came from the cache
+bool loadOrBuildLods(Model& model, LodChain& chain, const LodOptions& options,
+                     const std::string& path);
+
+#endif  //__LOD_H__
@@ -4,12 +4,30 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 
 #include "SDL2/SDL.h"
+#include "batch.h"
+#include "bvh.h"
+#include "camera.h"
+#include "countingallocator.h"
+#include "frameclock.h"
+#include "framestream.h"
 #include "geometry.h"
 #include "gl.h"
+#include "lod.h"
+#include "meshlet.h"
 #include "model.h"
+#include "paged.h"
+#include "pipeline.h"
+#include "raycast.h"
+#include "scene.h"
+#include "shader.h"
+#include "texturecache.h"
 #include "tgaimage.h"
+#include "trace.h"
 
 int samples = 0;
 
@@ -17,7 +35,6 @@ const int HEIGHT = 700;
 const int WIDTH = 700;
 const int DEPTH = 255;
 Model* model = NULL;
-float* z_buffer = NULL;
 Vec3f lightDirection = Vec3f(1., 1., 1);  // light
 Vec3f eye(1, 1, 3);
 Vec3f center(0, 0, 0);
@@ -26,76 +43,9 @@ SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
 SDL_Texture* canvas = nullptr;
 
-struct TexturingShader : public IShader {
-  Matrix varying_uv = Matrix(4, 4);   // uv coords
-  Matrix varying_tri = Matrix(4, 4);  // triangle ModelView
-  Matrix varying_nrm = Matrix(4, 4);  // normal per vertex
-  Matrix ndc_tri = Matrix(4, 4);      // triangle in device coordenates
-
-  Matrix uniform_MV = Matrix(4, 4);    // Model view matrix
-  Matrix uniform_MVIT = Matrix(4, 4);  // ModelView inverse traspose
-
-  virtual Vec3f vertex(int face, int idVert) override {
-    varying_uv.setColumn(
-        idVert, Vec4f(model->textCoord(model->texture(face)[idVert]), 0.));
-
-    Matrix nrm =
-        Vec4f(model->vertexNomal(model->vertexNomalsIds(face)[idVert]), 0.);
-    nrm = uniform_MVIT * nrm;
-    varying_nrm.setColumn(idVert, nrm);
-
-    Vec4f glVertex = Projection * ModelView *
-                     Matrix(Vec4f(model->vert(model->face(face)[idVert]), 1));
-
-    varying_tri.setColumn(idVert, glVertex);
-
-    ndc_tri.setColumn(idVert, glVertex.hogenize());
-
-    glVertex = ViewPort * glVertex;
-
-    return glVertex.hogenize().xyz();
-  }
-
-  virtual bool fragment(Vec4f bar, TGAColor& color) override {
-    Vec4f normalBar = (varying_nrm * Matrix(bar));
-    Vec4f uvBar = varying_uv * Matrix(bar);
-
-    Matrix A = Matrix::identity(3);
-
-    A.setColumn(0, ndc_tri.getColumn(1) - ndc_tri.getColumn(0));
-    A.setColumn(1, ndc_tri.getColumn(2) - ndc_tri.getColumn(0));
-    A.setColumn(2, normalBar.normalize());
-    A = A.transpose();
-
-    Matrix AI(3, 3);
-    A.inverse(AI);
-
-    AI = AI.incrementDimenesion();
-
-    Vec4f i = AI * Matrix(Vec4f(varying_uv(0, 1) - varying_uv(0, 0),
-                                varying_uv(0, 2) - varying_uv(0, 0), 0., 0.));
-
-    Vec4f j = AI * Matrix(Vec4f(varying_uv(1, 1) - varying_uv(1, 0),
-                                varying_uv(1, 2) - varying_uv(1, 0), 0., 0.));
-
-    Matrix BTN = Matrix(4, 4);
-
-    BTN.setColumn(0, i.normalize());
-    BTN.setColumn(1, j.normalize());
-    BTN.setColumn(2, normalBar);
-
-    Vec3f normalMapped =
-        (BTN * (Vec4f(model->getNormal(uvBar.xy()), 0)).normalize())
-            .getColumn(0)
-            .xyz();
-
-    float lightIntensity = std::max((normalMapped * lightDirection), 0.f);
-
-    color = model->getDiffuse(uvBar.xy()) * lightIntensity;
-
-    return false;
-  }
-};
+const float ORBIT_SPEED = 0.01f;  // radians per pixel dragged
+const float KEY_ORBIT = 0.05f;    // radians per key press
+const float ZOOM_STEP = 0.9f;
 
 /*
 struct TexturingShader : public IShader {
@@ -121,82 +71,444 @@ struct TexturingShader : public IShader {
 };
 */
 
-TexturingShader shader;
+// prints the face of the model (and the instance of a scene) under window
+// pixel x, y
+static void pick(const Bvh& bvh, const Scene* scene, const CameraPose& pose,
+                 int x, int y) {
+  Matrix screen = viewportMatrix(WIDTH, HEIGHT, 0, 0) *
+                  projectionMatrix(-1.f / (pose.eye - pose.center).norm()) *
+                  lookatMatrix(pose.eye, pose.center, pose.up);
+  Matrix world(4, 4);
+  screen.inverse(world);
+
+  // the window shows the framebuffer flipped both ways, depth 127.5 is the
+  // plane through the center
+  Vec4f target = Vec4f(world * Vec4f(WIDTH - 1 - x, HEIGHT - 1 - y, 127.5f,
+                                     1.f)).hogenize();
+  Vec3f direction = target.xyz() - pose.eye;
+
+  RayHit best;
+  int bestInstance = -1;
+
+  if (!scene) {
+    bvh.intersect(pose.eye, direction, best);
+  } else {
+    const std::vector<Matrix>& transforms = scene->meshes[0].transforms;
+
+    // into each instance's object space, t stays comparable
+    for (int i = 0; i < (int)transforms.size(); i++) {
+      Matrix object(4, 4);
+      Matrix(transforms[i]).inverse(object);
+
+      RayHit hit;
+      Vec4f origin = object * Vec4f(pose.eye, 1.f);
+      Vec4f along = object * Vec4f(direction, 0.f);
+      if (bvh.intersect(origin.xyz(), along.xyz(), hit, best.t)) {
+        best = hit;
+        bestInstance = i;
+      }
+    }
+  }
+
+  if (best.face < 0) {
+    std::cout << "picked nothing\n";
+    return;
+  }
+
+  Vec3f point = pose.eye + direction * best.t;
+  std::cout << "picked face " << best.face;
+  if (bestInstance >= 0) std::cout << " of instance " << bestInstance;
+  std::cout << " at " << point.x << " " << point.y << " " << point.z << "\n";
+}
 
+// TinyRenderer [model.obj] [--batch N] [--threads T] [--size WxH] [--out name]
+//              [--novsync] [--fps N] [--pipeline 1|2] [--stats]
+//              [--trace file.json] [--shadows size] [--pcf radius]
+//              [--msaa 1|2|4|8] [--shading-rate 1|2|4] [--rate-threshold T]
+//              [--instances N] [--cull] [--raycast] [--ray-shadows]
+//              [--ao rays] [--lod pixels] [--meshlets] [--cull-backfaces]
+//              [--paged MB] [--texture-budget MB] [--compress-textures]
+//              [--stream rgb|rgba|bgra|y4m] [--stream-out path]
 int main(int argc, char** argv) {
-  if (2 == argc) {
-    model = new Model(argv[1]);
+  const char* modelFile = "obj/african_head.obj";
+  int batchViews = 0;
+  BatchOptions batchOptions;
+  bool vsync = true;
+  double targetFps = 60.;  // only used without vsync, 0 = uncapped
+  int queueDepth = 0;      // frames rendered ahead on a render thread, 0 = off
+  bool printStats = false;
+  int instances = 0;  // > 0 draws a crowd of the model instead of one
+  RaycastOptions raycast;
+  bool useRaycast = false;  // rays instead of the rasterizer
+  float lodPixelError = 0.f;  // > 0 draws levels of detail within it
+  bool useMeshlets = false;   // cull and vertex shade per meshlet
+  long pagedBudget = 0;       // > 0 pages chunks in from disk within it
+  bool compressTextures = false;  // bc1 diffuse and bc5 normals in memory
+  const char* streamFormat = nullptr;  // batch frames to a pipe, not files
+  std::string streamPath = "-";
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+
+    if (!strcmp(argv[i], "--batch") && hasValue) {
+      batchViews = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--threads") && hasValue) {
+      batchOptions.threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--size") && hasValue) {
+      sscanf(argv[++i], "%dx%d", &batchOptions.width, &batchOptions.height);
+    } else if (!strcmp(argv[i], "--out") && hasValue) {
+      batchOptions.outputPrefix = argv[++i];
+    } else if (!strcmp(argv[i], "--novsync")) {
+      vsync = false;
+    } else if (!strcmp(argv[i], "--fps") && hasValue) {
+      targetFps = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--pipeline") && hasValue) {
+      queueDepth = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--stats")) {
+      printStats = true;
+    } else if (!strcmp(argv[i], "--shadows") && hasValue) {
+      batchOptions.shadowMapSize = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--pcf") && hasValue) {
+      batchOptions.shadowPcf = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--msaa") && hasValue) {
+      batchOptions.samples = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--shading-rate") && hasValue) {
+      batchOptions.shadingRate = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--rate-threshold") && hasValue) {
+      batchOptions.rateThreshold = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--instances") && hasValue) {
+      instances = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--cull")) {
+      batchOptions.cull = true;
+    } else if (!strcmp(argv[i], "--raycast")) {
+      useRaycast = true;
+    } else if (!strcmp(argv[i], "--ray-shadows")) {
+      useRaycast = true;
+      raycast.shadows = true;
+    } else if (!strcmp(argv[i], "--ao") && hasValue) {
+      useRaycast = true;
+      raycast.occlusionRays = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--meshlets")) {
+      useMeshlets = true;
+    } else if (!strcmp(argv[i], "--cull-backfaces")) {
+      useMeshlets = true;
+      batchOptions.cullBackfaces = true;
+    } else if (!strcmp(argv[i], "--lod") && hasValue) {
+      lodPixelError = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--texture-budget") && hasValue) {
+      TextureCache::global().setBudget((size_t)atol(argv[++i]) << 20);
+    } else if (!strcmp(argv[i], "--stream") && hasValue) {
+      streamFormat = argv[++i];
+    } else if (!strcmp(argv[i], "--stream-out") && hasValue) {
+      streamPath = argv[++i];
+    } else if (!strcmp(argv[i], "--compress-textures")) {
+      compressTextures = true;
+    } else if (!strcmp(argv[i], "--paged") && hasValue) {
+      pagedBudget = atol(argv[++i]) << 20;
+    } else if (!strcmp(argv[i], "--trace") && hasValue) {
+      Tracer::start(argv[++i]);
+    } else {
+      modelFile = argv[i];
+    }
+  }
+
+  if (streamFormat && batchViews <= 0) {
+    std::cerr << "--stream needs --batch N\n";
+    return 1;
+  }
+
+  Tracer::startFromEnvironment();
+  TRACE_THREAD("main");
+
+  // converted once, then only the chunks in view are read back. The model
+  // keeps the textures and no faces
+  PagedModel paged;
+  if (pagedBudget > 0) {
+    PagingOptions paging;
+    paging.memoryBudget = pagedBudget;
+    std::string path = siblingPath(modelFile, ".pages");
+    PagesStatus status = openOrConvertPages(paged, modelFile, path, paging);
+    if (status == PAGES_FAILED) {
+      std::cerr << "can't page " << modelFile << " through " << path << "\n";
+      return 1;
+    }
+    if (compressTextures) paged.textures().compressTextures();
+    std::cerr << "paged " << paged.faceCount() << " tris in "
+              << paged.chunkCount() << " chunks "
+              << (status == PAGES_OPENED ? "from " : "written to ") << path
+              << "\n";
+
+    model = new Model(paged.textures(), {}, {}, {}, {});
+    batchOptions.paged = &paged;
+    useMeshlets = useRaycast = false;
+    lodPixelError = 0.f;
+    instances = 0;
   } else {
-    model = new Model("obj/african_head.obj");
+    model = new Model(modelFile);
+    if (compressTextures) {
+      size_t decoded = model->textureBytes();
+      model->compressTextures();
+      std::cerr << "textures compressed from " << decoded / 1024 << " KB to "
+                << model->textureBytes() / 1024 << " KB\n";
+    }
   }
+  if (compressTextures) TextureCache::global().clear();
+
+  if (printStats) TextureCache::global().stats().print(std::cerr);
+
+  // culling, ray casting and right click picking
+  Bvh bvh;
+  bvh.build(*model, 0);
+  batchOptions.bvh = &bvh;
+  if (useRaycast) batchOptions.raycast = &raycast;
+
+  Meshlets meshlets;
+  if (useMeshlets) {
+    meshlets.build(*model);
+    std::cerr << "meshlets " << meshlets.meshlets.size() << ", "
+              << meshlets.positions.size() << " vertex copies of "
+              << model->nverts() << "\n";
+    batchOptions.meshlets = &meshlets;
+  }
+
+  // simplified once, then read back from next to the model
+  LodChain lods;
+  if (lodPixelError > 0.f) {
+    std::string path = siblingPath(modelFile, ".lod");
+    bool cached = loadOrBuildLods(*model, lods, LodOptions(), path);
+    std::cerr << "lod " << lods.levelCount() << " levels "
+              << (cached ? "from " : "written to ") << path << "\n";
+    for (int i = 0; i < lods.levelCount(); i++) {
+      std::cerr << "  level " << i << " " << lods.level(i)->nfaces()
+                << " tris, error " << lods.errors[i] << "\n";
+    }
 
-  z_buffer = new float[WIDTH * HEIGHT];
-  for (int i = 0; i < WIDTH * HEIGHT; i++) {
-    z_buffer[i] = std::numeric_limits<int>::min();
+    batchOptions.lods = &lods;
+    batchOptions.lodPixelError = lodPixelError;
   }
 
-  {  // window set up
-    SDL_Init(SDL_INIT_VIDEO);
-    SDL_CreateWindowAndRenderer(WIDTH, HEIGHT, 0, &window, &renderer);
-    canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
-                               SDL_TEXTUREACCESS_TARGET, WIDTH, HEIGHT);
-    SDL_SetRenderTarget(renderer, canvas);
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
+  Scene crowd;
+  if (instances > 0) {
+    crowd = crowdScene(model, instances);
+    crowd.meshes[0].bvh = batchOptions.cull ? &bvh : nullptr;
+    crowd.meshes[0].lods = batchOptions.lods;
+    crowd.meshes[0].meshlets = batchOptions.meshlets;
+    batchOptions.scene = &crowd;
   }
 
-  {  // draw model Logic
-    lookat(center, eye, Vec3f(0., 1., 0.));
-    viewport(WIDTH, HEIGHT, 0, 0);
-    projection(-1.f / (eye - center).norm());
-
-    shader.uniform_MV = Projection * ModelView;
-    shader.uniform_MVIT(4, 4);
-    shader.uniform_MV.inverse(shader.uniform_MVIT);
-    shader.uniform_MVIT = shader.uniform_MVIT.transpose();
-    lightDirection =
-        Vec4f(Projection * ModelView * Vec4f(lightDirection, 0.)).xyz();
-
-    for (int i = 0; i < model->nfaces(); i++) {
-      Vec3f screen_coords[3];
-      for (int j = 0; j < 3; j++) {
-        screen_coords[j] = shader.vertex(i, j);
+  if (batchViews > 0) {  // headless, no window at all
+    batchOptions.lightDirection = lightDirection;
+
+    // raw frames for an encoder, the report moves out of their way
+    std::unique_ptr<FrameStream> stream;
+    if (streamFormat) {
+      StreamFormat format;
+      if (!parseStreamFormat(streamFormat, format)) {
+        std::cerr << "unknown stream format " << streamFormat << "\n";
+        return 1;
       }
+      int threads = batchOptions.threads > 0
+                        ? batchOptions.threads
+                        : std::max(1u, std::thread::hardware_concurrency());
+      stream.reset(new FrameStream(streamPath, format, batchOptions.width,
+                                   batchOptions.height, targetFps,
+                                   std::min(threads, batchViews)));
+      if (!stream->isOpen()) {
+        std::cerr << "can't stream to " << streamPath << "\n";
+        return 1;
+      }
+      batchOptions.stream = stream.get();
+    }
+
+    BatchReport report =
+        renderBatch(*model, turntable(batchViews, eye, center), batchOptions);
+    printReport(stream && streamPath == "-" ? std::cerr : std::cout, report);
+
+    delete model;
+    return report.stream.failed ? 1 : 0;
+  }
 
-      drawTriangle(screen_coords, z_buffer, renderer, shader,
-                   Vec2f(WIDTH, HEIGHT));
+  RenderContext context(WIDTH, HEIGHT);
+  context.model = model;
+  applyOptions(context, batchOptions);
+
+  auto render = [&](RenderContext& ctx, const CameraPose& pose) {
+    if (batchOptions.paged) {
+      renderPaged(ctx, paged, pose, lightDirection);
+    } else if (batchOptions.scene) {
+      renderScene(ctx, *batchOptions.scene, pose, lightDirection);
+    } else if (batchOptions.raycast) {
+      raycastView(ctx, bvh, pose, lightDirection, raycast);
+    } else {
+      renderView(ctx, pose, lightDirection);
     }
+  };
+
+  OrbitCamera camera(eye, center);
+  FrameClock clock;
+
+  std::unique_ptr<FramePipeline> pipeline;
+  if (queueDepth > 0) {
+    pipeline.reset(new FramePipeline(
+        *model, WIDTH, HEIGHT, queueDepth,
+        [&](RenderContext& ctx, const CameraPose& pose) {
+          applyOptions(ctx, batchOptions);
+          render(ctx, pose);
+        }));
   }
 
-  SDL_SetRenderTarget(renderer, NULL);
+  {  // window set up
+    SDL_Init(SDL_INIT_VIDEO);
+    window = SDL_CreateWindow("TinyRenderer", SDL_WINDOWPOS_UNDEFINED,
+                              SDL_WINDOWPOS_UNDEFINED, WIDTH, HEIGHT, 0);
+    renderer = SDL_CreateRenderer(window, -1,
+                                  vsync ? SDL_RENDERER_PRESENTVSYNC : 0);
+    canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888,
+                               SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+  }
 
   bool running = true;
   SDL_Event event;
+  double renderMilliseconds = 0.;
+  PipelineStats frameStats;
+  long coveredPixels = 0;
+  double lastTitle = 0.;
+  double uptime = 0.;
+
+  // queueDepth poses stay in flight: the render thread works on them while
+  // the frame before them is uploaded and presented
+  if (pipeline) {
+    CameraPose pose;
+    pose.eye = camera.eye();
+    pose.center = camera.center;
+    for (int i = 0; i < pipeline->getQueueDepth(); i++) {
+      pipeline->submit(pose, true);
+    }
+  }
 
   while (running) {
+    TRACE_SCOPE("frame");
+
     while (SDL_PollEvent(&event)) {
       if (event.type == SDL_QUIT) {
         running = false;
       }
 
+      if (event.type == SDL_MOUSEMOTION &&
+          (event.motion.state & SDL_BUTTON_LMASK)) {
+        camera.orbit(-event.motion.xrel * ORBIT_SPEED,
+                     event.motion.yrel * ORBIT_SPEED);
+      }
+
+      if (event.type == SDL_MOUSEBUTTONDOWN &&
+          event.button.button == SDL_BUTTON_RIGHT) {
+        CameraPose pose;
+        pose.eye = camera.eye();
+        pose.center = camera.center;
+        pick(bvh, batchOptions.scene, pose, event.button.x, event.button.y);
+      }
+
+      if (event.type == SDL_MOUSEWHEEL && event.wheel.y != 0) {
+        camera.zoom(event.wheel.y > 0 ? ZOOM_STEP : 1.f / ZOOM_STEP);
+      }
+
       if (event.type != SDL_KEYDOWN) continue;
-      if (event.key.keysym.sym != SDLK_ESCAPE) continue;
 
-      running = false;
+      switch (event.key.keysym.sym) {
+        case SDLK_ESCAPE:
+          running = false;
+          break;
+        case SDLK_LEFT:
+          camera.orbit(KEY_ORBIT, 0.f);
+          break;
+        case SDLK_RIGHT:
+          camera.orbit(-KEY_ORBIT, 0.f);
+          break;
+        case SDLK_UP:
+          camera.orbit(0.f, KEY_ORBIT);
+          break;
+        case SDLK_DOWN:
+          camera.orbit(0.f, -KEY_ORBIT);
+          break;
+        case SDLK_PLUS:
+        case SDLK_EQUALS:
+          camera.zoom(ZOOM_STEP);
+          break;
+        case SDLK_MINUS:
+          camera.zoom(1.f / ZOOM_STEP);
+          break;
+      }
     }
 
-    SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, canvas, NULL, NULL);
-    SDL_RenderPresent(renderer);
-    SDL_Delay(16);
+    CameraPose pose;
+    pose.eye = camera.eye();
+    pose.center = camera.center;
+
+    double presentStart;
+
+    if (pipeline) {
+      // the oldest pose in flight, replaced by this one before presenting
+      Frame* frame = pipeline->acquire(true);
+      pipeline->submit(pose, true);
+      renderMilliseconds = frame->renderMilliseconds;
+      frameStats = frame->context.stats;
+      if (printStats) coveredPixels = frame->context.coveredPixels();
+
+      presentStart = clock.elapsed();
+      TRACE_SCOPE("upload");
+      SDL_UpdateTexture(canvas, NULL, frame->context.framebuffer.buffer(),
+                        WIDTH * 4);
+      pipeline->release(frame);
+    } else {  // draw model Logic
+      double start = clock.elapsed();
+      render(context, pose);
+      renderMilliseconds = clock.elapsed() - start;
+      frameStats = context.stats;
+      if (printStats) coveredPixels = context.coveredPixels();
+
+      presentStart = clock.elapsed();
+      TRACE_SCOPE("upload");
+      SDL_UpdateTexture(canvas, NULL, context.framebuffer.buffer(), WIDTH * 4);
+    }
+
+    {
+      TRACE_SCOPE("present");
+
+      SDL_RenderClear(renderer);
+      // the framebuffer is in raster coords, same flip drawTriangle used to do
+      SDL_RenderCopyEx(
+          renderer, canvas, NULL, NULL, 0., NULL,
+          (SDL_RendererFlip)(SDL_FLIP_HORIZONTAL | SDL_FLIP_VERTICAL));
+      SDL_RenderPresent(renderer);
+    }
+
+    frameStats.stageMilliseconds[STAGE_PRESENT] =
+        clock.elapsed() - presentStart;
+    if (printStats) frameStats.print(std::cerr, coveredPixels);
+
+    // vsync already blocked in present, otherwise wait on the measured time
+    if (!vsync && targetFps > 0.) clock.pace(1000. / targetFps);
+    uptime += clock.tick();
+
+    if (uptime - lastTitle > 250.) {
+      lastTitle = uptime;
+
+      char title[128];
+      snprintf(title, sizeof(title),
+               "TinyRenderer - frame %.1f ms (render %.1f ms) - %.1f fps",
+               clock.lastFrame(), renderMilliseconds, clock.fps());
+      SDL_SetWindowTitle(window, title);
+    }
   }
 
+  pipeline.reset();
+
   SDL_DestroyTexture(canvas);
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
 
   delete model;
-  delete[] z_buffer;
   return 0;
 }
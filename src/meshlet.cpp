@@ -0,0 +1,289 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "trace.h"
+
+// growing a meshlet, the faces next to it that can still join
+struct MeshletBuilder {
+  Model& model;
+  const MeshletOptions& options;
+  std::vector<std::vector<int> > vertexFaces;
+  std::vector<Vec3f> centroids;
+  std::vector<bool> assigned;
+  std::vector<int> vertexMark;  // meshlet index + 1 while it holds the vertex
+  std::vector<int> frontier;    // may hold assigned faces
+
+  MeshletBuilder(Model& model, const MeshletOptions& options)
+      : model(model), options(options) {
+    vertexFaces.resize(model.nverts());
+    vertexMark.assign(model.nverts(), 0);
+    assigned.assign(model.nfaces(), false);
+
+    for (int f = 0; f < model.nfaces(); f++) {
+      const std::vector<int>& face = model.face(f);
+      Vec3f sum(0, 0, 0);
+      for (int v : face) {
+        vertexFaces[v].push_back(f);
+        sum = sum + model.vert(v);
+      }
+      centroids.push_back(sum * (1.f / face.size()));
+    }
+  }
+
+  int newVertices(int face, int mark) const {
+    int count = 0;
+    for (int v : model.face(face)) count += vertexMark[v] != mark;
+    return count;
+  }
+
+  // the frontier face adding the fewest vertices, the one nearest center of
+  // those. -1 when none fits. Drops the assigned faces from the frontier
+  int best(int mark, int vertices, Vec3f center) {
+    int found = -1;
+    int fewest = 4;
+    float nearest = std::numeric_limits<float>::max();
+
+    frontier.erase(std::remove_if(frontier.begin(), frontier.end(),
+                                  [&](int face) { return assigned[face]; }),
+                   frontier.end());
+
+    for (int face : frontier) {
+      int added = newVertices(face, mark);
+      if (vertices + added > options.maxVertices) continue;
+
+      float distance = (centroids[face] - center).norm();
+      if (added < fewest || (added == fewest && distance < nearest)) {
+        found = face;
+        fewest = added;
+        nearest = distance;
+      }
+    }
+    return found;
+  }
+
+  // faces of one meshlet starting at seed, in the order they joined
+  void grow(int seed, int mark, std::vector<int>& faces) {
+    faces.clear();
+    frontier.clear();
+    int vertices = 0;
+    Vec3f sum(0, 0, 0);
+
+    for (int face = seed; face >= 0;) {
+      assigned[face] = true;
+      faces.push_back(face);
+      sum = sum + centroids[face];
+
+      for (int v : model.face(face)) {
+        if (vertexMark[v] == mark) continue;
+        vertexMark[v] = mark;
+        vertices++;
+        for (int next : vertexFaces[v]) {
+          if (!assigned[next]) frontier.push_back(next);
+        }
+      }
+
+      if ((int)faces.size() >= options.maxFaces) break;
+      face = best(mark, vertices, sum * (1.f / faces.size()));
+    }
+  }
+};
+
+// sphere, cone and vertex copies of the meshlet with faces
+static void addMeshlet(Meshlets& result, Model& model,
+                       const std::vector<int>& faces,
+                       std::vector<int>& vertexCopy,
+                       std::vector<int>& normalCopy) {
+  Meshlet meshlet;
+  meshlet.faceOffset = result.faces.size();
+  meshlet.faceCount = faces.size();
+  meshlet.vertexOffset = result.vertexIds.size();
+  meshlet.normalOffset = result.normalIds.size();
+
+  Vec3f low(0, 0, 0), high(0, 0, 0);
+  Vec3f normalSum(0, 0, 0);
+  std::vector<Vec3f> normals;
+
+  for (int f : faces) {
+    result.faces.push_back(f);
+
+    const std::vector<int>& face = model.face(f);
+    const std::vector<int>& normalIds = model.vertexNomalsIds(f);
+    for (int j = 0; j < 3; j++) {
+      int v = face[j];
+      if (vertexCopy[v] < 0) {
+        vertexCopy[v] = result.vertexIds.size();
+        result.vertexIds.push_back(v);
+        result.positions.push_back(model.vert(v));
+
+        bool first = vertexCopy[v] == meshlet.vertexOffset;
+        low = first ? model.vert(v) : componentMin(low, model.vert(v));
+        high = first ? model.vert(v) : componentMax(high, model.vert(v));
+      }
+
+      int n = normalIds[j];
+      if (normalCopy[n] < 0) {
+        normalCopy[n] = result.normalIds.size();
+        result.normalIds.push_back(n);
+        result.normals.push_back(model.vertexNomal(n));
+      }
+
+      result.corners[f * 6 + j] = vertexCopy[v];
+      result.corners[f * 6 + 3 + j] = normalCopy[n];
+    }
+
+    Vec3f a = model.vert(face[0]);
+    Vec3f n = cross(model.vert(face[1]) - a, model.vert(face[2]) - a);
+    float length = n.norm();
+    if (length > 0.f) {
+      normals.push_back(n * (1.f / length));
+      normalSum = normalSum + normals.back();
+    }
+  }
+
+  meshlet.vertexCount = result.vertexIds.size() - meshlet.vertexOffset;
+  meshlet.normalCount = result.normalIds.size() - meshlet.normalOffset;
+
+  meshlet.center = (low + high) * 0.5f;
+  meshlet.radius = 0.f;
+  for (int i = meshlet.vertexOffset; i < (int)result.vertexIds.size(); i++) {
+    meshlet.radius =
+        std::max(meshlet.radius, (result.positions[i] - meshlet.center).norm());
+  }
+
+  // the widest angle between the mean normal and a face one
+  meshlet.coneAxis = Vec3f(0, 0, 0);
+  meshlet.coneCutoff = 1.f;
+  float length = normalSum.norm();
+  if (length > 0.f) {
+    meshlet.coneAxis = normalSum * (1.f / length);
+    float lowest = 1.f;
+    for (Vec3f n : normals) lowest = std::min(lowest, n * meshlet.coneAxis);
+    if (lowest > 0.f) meshlet.coneCutoff = std::sqrt(1.f - lowest * lowest);
+  }
+
+  // the next meshlet makes its own copies
+  for (int i = meshlet.vertexOffset; i < (int)result.vertexIds.size(); i++) {
+    vertexCopy[result.vertexIds[i]] = -1;
+  }
+  for (int i = meshlet.normalOffset; i < (int)result.normalIds.size(); i++) {
+    normalCopy[result.normalIds[i]] = -1;
+  }
+
+  result.meshlets.push_back(meshlet);
+}
+
+void Meshlets::build(Model& model, const MeshletOptions& options) {
+  TRACE_SCOPE("Meshlets::build");
+
+  *this = Meshlets();
+  for (int f = 0; f < model.nfaces(); f++) {
+    if (model.face(f).size() != 3) return;  // triangles only
+  }
+
+  corners.assign(model.nfaces() * 6, -1);
+  MeshletBuilder builder(model, options);
+  std::vector<int> vertexCopy(model.nverts(), -1);
+  std::vector<int> normalCopy(model.normals().size(), -1);
+  std::vector<int> grown;
+
+  // the next seed is a face the last meshlet left on its frontier, so
+  // meshlets follow each other across the surface
+  int scan = 0;
+  while (true) {
+    int seed = -1;
+    for (int face : builder.frontier) {
+      if (!builder.assigned[face]) {
+        seed = face;
+        break;
+      }
+    }
+    while (seed < 0 && scan < model.nfaces()) {
+      if (!builder.assigned[scan]) seed = scan;
+      scan++;
+    }
+    if (seed < 0) break;
+
+    builder.grow(seed, meshlets.size() + 1, grown);
+    addMeshlet(*this, model, grown, vertexCopy, normalCopy);
+  }
+}
+
+// below this many meshlets a thread costs more than it saves
+const int CULL_GRAIN = 256;
+
+// the view planes and the eye of a clip matrix in object space
+struct MeshletCuller {
+  float planes[5][4];
+  float lengths[5];
+  Vec3f eye;
+  bool backfaces;
+
+  MeshletCuller(const Matrix& clip, bool backfaces) : backfaces(backfaces) {
+    frustumPlanes(clip, planes);
+    for (int p = 0; p < 5; p++) {
+      lengths[p] = Vec3f(planes[p][0], planes[p][1], planes[p][2]).norm();
+    }
+
+    // the eye is the point clip sends to x = y = w = 0, without one (no
+    // perspective) nothing is culled as facing away
+    Matrix toObject(4, 4);
+    Matrix(clip).inverse(toObject);
+    float w = toObject(3, 2);
+    eye = Vec3f(toObject(0, 2), toObject(1, 2), toObject(2, 2));
+    this->backfaces = backfaces && std::abs(w) > 1e-12f;
+    if (this->backfaces) eye = eye * (1.f / w);
+  }
+
+  bool visible(const Meshlet& meshlet) const {
+    for (int p = 0; p < 5; p++) {
+      float distance = planes[p][0] * meshlet.center.x +
+                       planes[p][1] * meshlet.center.y +
+                       planes[p][2] * meshlet.center.z + planes[p][3];
+      if (distance < -meshlet.radius * lengths[p]) return false;
+    }
+
+    if (!backfaces || meshlet.coneCutoff >= 1.f) return true;
+
+    // every face turned away from anywhere in the sphere
+    Vec3f toCenter = meshlet.center - eye;
+    return toCenter * meshlet.coneAxis <
+           meshlet.coneCutoff * toCenter.norm() + meshlet.radius;
+  }
+};
+
+int Meshlets::cull(const Matrix& clip, bool backfaces,
+                   std::vector<int>& visible, int threads) const {
+  MeshletCuller culler(clip, backfaces);
+  int count = meshlets.size();
+
+  // the index of a visible meshlet or -1 in its own slot, then compacted
+  visible.resize(count);
+  parallelFor(count, CULL_GRAIN, threads, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      visible[i] = culler.visible(meshlets[i]) ? i : -1;
+    }
+  });
+
+  int culled = 0;
+  for (int i = 0; i < count; i++) {
+    if (visible[i] < 0) culled += meshlets[i].faceCount;
+  }
+  visible.erase(std::remove(visible.begin(), visible.end(), -1),
+                visible.end());
+
+  // nearest first, so fewer fragments behind others get shaded
+  auto depth = [&](int i) {
+    Vec3f c = meshlets[i].center;
+    return clip(3, 0) * c.x + clip(3, 1) * c.y + clip(3, 2) * c.z + clip(3, 3);
+  };
+  std::sort(visible.begin(), visible.end(),
+            [&](int a, int b) { return depth(a) < depth(b); });
+  return culled;
+}
@@ -0,0 +1,60 @@
+#ifndef __MESHLET_H__
+#define __MESHLET_H__
+
+#include <vector>
+
+#include "geometry.h"
+
+class Model;
+
+struct MeshletOptions {
+  int maxFaces = 124;    // per meshlet
+  int maxVertices = 64;  // distinct positions per meshlet
+};
+
+// a cluster of neighbouring faces with its own copy of the vertices they use,
+// so it can be culled and vertex shaded on its own
+struct Meshlet {
+  int faceOffset;    // into Meshlets::faces
+  int faceCount;
+  int vertexOffset;  // into Meshlets::vertexIds and positions
+  int vertexCount;
+  int normalOffset;  // into Meshlets::normalIds and normals
+  int normalCount;
+
+  Vec3f center;  // bounding sphere, object space
+  float radius;
+  // every face normal is within the cone around axis. cutoff is the sine of
+  // its half angle, 1 when the faces point too many ways to ever cull
+  Vec3f coneAxis;
+  float coneCutoff;
+};
+
+// a model cut into meshlets. A face's corners point into the copies of its
+// meshlet, a vertex on the edge of two meshlets is copied and shaded in both
+struct Meshlets {
+  std::vector<Meshlet> meshlets;
+  std::vector<int> faces;      // model faces, meshlet by meshlet
+  std::vector<int> vertexIds;  // model vertex of every copy
+  std::vector<int> normalIds;  // model normal of every copy
+  Vec3SoA positions;           // of the vertex copies, meshlet by meshlet
+  Vec3SoA normals;             // of the normal copies
+  // per model face, 3 vertex copies and then 3 normal copies
+  std::vector<int> corners;
+
+  // greedy: a meshlet grows from a seed face by the neighbouring face that
+  // adds the fewest new vertices, until either limit is reached
+  void build(Model& model, const MeshletOptions& options = MeshletOptions());
+
+  bool empty() const { return meshlets.empty(); }
+
+  // visible gets the meshlets that may be visible through clip (projection
+  // * modelview * object transform): their sphere is not outside the view
+  // and, with backfaces, not all their faces turn away from the eye (faces
+  // are front facing counter clockwise). Sorted nearest first, threads != 1
+  // splits many meshlets with parallelFor. Returns the faces culled
+  int cull(const Matrix& clip, bool backfaces, std::vector<int>& visible,
+           int threads = 1) const;
+};
+
+#endif  //__MESHLET_H__
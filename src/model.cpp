@@ -1,97 +1,322 @@
 #include "model.h"
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <sstream>
+#include <iterator>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "cpu.h"
 #include "geometry.h"
+#include "objparse.h"
+#include "texturecache.h"
 #include "tgaimage.h"
+#include "trace.h"
 
-Model::Model(const char *filename)
+// bytes of obj a parse thread gets at least, small files take fewer threads
+static const size_t PARSE_GRAIN = 1 << 16;
+
+// what one thread parsed of its lines, in buffers of its own
+struct ObjChunk {
+  std::vector<Vec3f> verts;
+  std::vector<Vec2f> uvs;
+  std::vector<Vec3f> normals;
+  std::vector<std::vector<int> > ids[3];  // vertex, uv and normal per face
+  // face and corner of the ids that count back, from the chunk start until
+  // the chunks before are known
+  std::vector<std::pair<int, int> > relative[3];
+};
+
+// [begin, end) ends after a newline, the newlines become terminators
+static void parseObjChunk(char *begin, char *end, ObjChunk &chunk) {
+  TRACE_SCOPE("parse obj chunk");
+
+  std::vector<long> corners;
+  for (char *line = begin; line < end;) {
+    char *newline = (char *)std::memchr(line, '\n', end - line);
+    *newline = '\0';
+    if (newline > line && newline[-1] == '\r') newline[-1] = '\0';
+
+    float values[3] = {0.f, 0.f, 0.f};
+    switch (parseObjLine(line, values, corners)) {
+      case OBJ_VERTEX:
+        chunk.verts.push_back(Vec3f(values[0], values[1], values[2]));
+        break;
+      case OBJ_UV:
+        chunk.uvs.push_back(Vec2f(values[0], values[1]));
+        break;
+      case OBJ_NORMAL:
+        chunk.normals.push_back(Vec3f(values[0], values[1], values[2]));
+        break;
+      case OBJ_FACE: {
+        long counts[3] = {(long)chunk.verts.size(), (long)chunk.uvs.size(),
+                          (long)chunk.normals.size()};
+        int face = chunk.ids[0].size();
+        for (int a = 0; a < 3; a++) chunk.ids[a].emplace_back();
+        for (size_t i = 0; i < corners.size(); i++) {
+          int a = i % 3;
+          chunk.ids[a][face].push_back(resolveObjId(corners[i], counts[a]));
+          if (corners[i] < 0) chunk.relative[a].push_back({face, i / 3});
+        }
+        break;
+      }
+      default:
+        break;
+    }
+
+    line = newline + 1;
+  }
+}
+
+// the chunks in file order. Positive ids are absolute already, the ones that
+// count back move by what the chunks before read
+void Model::mergeObjChunks(std::vector<ObjChunk> &chunks) {
+  TRACE_SCOPE("merge obj chunks");
+
+  size_t totals[4] = {0, 0, 0, 0};
+  for (const ObjChunk &chunk : chunks) {
+    totals[0] += chunk.verts.size();
+    totals[1] += chunk.uvs.size();
+    totals[2] += chunk.normals.size();
+    totals[3] += chunk.ids[0].size();
+  }
+  verts_.reserve(totals[0]);
+  tex_coords_.reserve(totals[1]);
+  vertexNomals.reserve(totals[2]);
+  std::vector<std::vector<int> > *faces[3] = {&faces_, &textures_,
+                                              &vertexNomalsIds_};
+  for (int a = 0; a < 3; a++) faces[a]->reserve(totals[3]);
+
+  int base[3] = {0, 0, 0};
+  for (ObjChunk &chunk : chunks) {
+    for (int a = 0; a < 3; a++) {
+      for (const std::pair<int, int> &id : chunk.relative[a]) {
+        chunk.ids[a][id.first][id.second] += base[a];
+      }
+      faces[a]->insert(faces[a]->end(),
+                       std::make_move_iterator(chunk.ids[a].begin()),
+                       std::make_move_iterator(chunk.ids[a].end()));
+    }
+
+    verts_.insert(verts_.end(), chunk.verts.begin(), chunk.verts.end());
+    tex_coords_.insert(tex_coords_.end(), chunk.uvs.begin(), chunk.uvs.end());
+    vertexNomals.insert(vertexNomals.end(), chunk.normals.begin(),
+                        chunk.normals.end());
+    base[0] += chunk.verts.size();
+    base[1] += chunk.uvs.size();
+    base[2] += chunk.normals.size();
+  }
+}
+
+Model::Model(const char *filename, bool geometry, int threads)
     : verts_(),
       tex_coords_(),
       vertexNomals(),
       faces_(),
       textures_(),
       vertexNomalsIds_() {
-  std::ifstream in;
-  in.open(filename, std::ifstream::in);
-  if (in.fail()) return;
-  std::string line;
-  while (!in.eof()) {
-    std::getline(in, line);
-    std::istringstream iss(line.c_str());
-    char trash;
-    if (!line.compare(0, 2, "v ")) {
-      iss >> trash;
-      Vec3f v;
-      for (int i = 0; i < 3; i++) iss >> v.raw[i];
-      verts_.push_back(v);
-
-    } else if (!line.compare(0, 3, "vt ")) {
-      iss >> trash >> trash;
-      Vec2f tuv;
-      for (int i = 0; i < 2; i++) iss >> tuv.raw[i];
-      tex_coords_.push_back(tuv);
-    }
+  TRACE_SCOPE("Model::Model");
 
-    else if (!line.compare(0, 3, "vn ")) {
-      iss >> trash >> trash;
-      Vec3f vn;
-      for (int i = 0; i < 3; i++) iss >> vn.raw[i];
-      vertexNomals.push_back(vn);
-    }
+  diffusemap_ = std::make_shared<TGAImage>();
+  normalmap_ = std::make_shared<TGAImage>();
+
+  if (!geometry) {
+    load_texture(filename, "_diffuse.tga", diffusemap_);
+    load_texture(filename, "_nm_tangent.tga", normalmap_);
+    return;
+  }
+
+  std::string text;
+  {
+    TRACE_SCOPE("read obj");
+
+    std::ifstream in(filename, std::ios::binary);
+    if (in.fail()) return;
+    in.seekg(0, std::ios::end);
+    text.resize(in.tellg());
+    in.seekg(0);
+    in.read(&text[0], text.size());
+  }
+  if (text.empty() || text.back() != '\n') text.push_back('\n');
+
+  {
+    TRACE_SCOPE("parse obj");
 
-    else if (!line.compare(0, 2, "f ")) {
-      std::vector<int> f;
-      std::vector<int> ft;
-      std::vector<int> fvn;
-
-      int idx, tidx, vnidx;
-      iss >> trash;
-      while (iss >> idx >> trash >> tidx >> trash >> vnidx) {
-        idx--;  // in wavefront obj all indices start at 1, not zero
-        tidx--;
-        vnidx--;
-        f.push_back(idx);
-        ft.push_back(tidx);
-        fvn.push_back(vnidx);
+    // chunks end after a newline, at least PARSE_GRAIN bytes each
+    if (threads <= 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    int count = std::clamp<size_t>(text.size() / PARSE_GRAIN, 1, threads);
+    char *end = &text[0] + text.size();
+    std::vector<char *> starts(count + 1, end);
+    starts[0] = &text[0];
+    for (int i = 1; i < count; i++) {
+      char *start = &text[0] + text.size() * i / count;
+      start = std::max(start, starts[i - 1]);
+      if (start < end) {
+        starts[i] = (char *)std::memchr(start, '\n', end - start) + 1;
       }
-      faces_.push_back(f);
-      textures_.push_back(ft);
-      vertexNomalsIds_.push_back(fvn);
     }
+
+    std::vector<ObjChunk> chunks(count);
+    parallelFor(count, 1, count, [&](int begin, int end) {
+      for (int i = begin; i < end; i++) {
+        parseObjChunk(starts[i], starts[i + 1], chunks[i]);
+      }
+    });
+    mergeObjChunks(chunks);
   }
+  for (const Vec3f &v : verts_) positions_.push_back(v);
+  for (const Vec3f &vn : vertexNomals) normals_.push_back(vn);
+
   std::cerr << "# v# " << verts_.size() << " f# " << faces_.size() << std::endl;
-  // load_texture(filename, "_diffuse.tga", diffusemap_);
   load_texture(filename, "_diffuse.tga", diffusemap_);
   // load_texture(filename, "_grid.tga", diffusemap_);
   load_texture(filename, "_nm_tangent.tga", normalmap_);
 }
 
+// ids of the attributes a face list uses, renumbered in first use order
+static void compactIds(const std::vector<std::vector<int> > &faces,
+                       int count, std::vector<std::vector<int> > &out,
+                       std::vector<int> &used) {
+  std::vector<int> remap(count, -1);
+  out = faces;
+
+  for (std::vector<int> &face : out) {
+    for (int &id : face) {
+      if (remap[id] < 0) {
+        remap[id] = used.size();
+        used.push_back(id);
+      }
+      id = remap[id];
+    }
+  }
+}
+
+Model::Model(const Model &source, const std::vector<std::vector<int> > &faces,
+             const std::vector<std::vector<int> > &textures,
+             const std::vector<std::vector<int> > &normals)
+    : diffusemap_(source.diffusemap_),
+      normalmap_(source.normalmap_),
+      diffuseBlocks_(source.diffuseBlocks_),
+      normalBlocks_(source.normalBlocks_) {
+  TRACE_SCOPE("Model::Model subset");
+
+  std::vector<int> used;
+  compactIds(faces, source.verts_.size(), faces_, used);
+  for (int id : used) verts_.push_back(source.verts_[id]);
+
+  used.clear();
+  compactIds(textures, source.tex_coords_.size(), textures_, used);
+  for (int id : used) tex_coords_.push_back(source.tex_coords_[id]);
+
+  used.clear();
+  compactIds(normals, source.vertexNomals.size(), vertexNomalsIds_, used);
+  for (int id : used) vertexNomals.push_back(source.vertexNomals[id]);
+
+  for (const Vec3f &v : verts_) positions_.push_back(v);
+  for (const Vec3f &vn : vertexNomals) normals_.push_back(vn);
+}
+
+Model::Model(const Model &source, std::vector<Vec3f> verts,
+             std::vector<Vec2f> uvs, std::vector<Vec3f> normals,
+             const std::vector<int> &corners)
+    : diffusemap_(source.diffusemap_),
+      normalmap_(source.normalmap_),
+      diffuseBlocks_(source.diffuseBlocks_),
+      normalBlocks_(source.normalBlocks_),
+      verts_(std::move(verts)),
+      tex_coords_(std::move(uvs)),
+      vertexNomals(std::move(normals)) {
+  int faces = corners.size() / 9;
+  faces_.resize(faces);
+  textures_.resize(faces);
+  vertexNomalsIds_.resize(faces);
+
+  for (int f = 0; f < faces; f++) {
+    const int *face = &corners[f * 9];
+    faces_[f] = {face[0], face[3], face[6]};
+    textures_[f] = {face[1], face[4], face[7]};
+    vertexNomalsIds_[f] = {face[2], face[5], face[8]};
+  }
+
+  for (const Vec3f &v : verts_) positions_.push_back(v);
+  for (const Vec3f &vn : vertexNomals) normals_.push_back(vn);
+}
+
 void Model::load_texture(std::string filename, const char *suffix,
-                         TGAImage &img) {
+                         std::shared_ptr<TGAImage> &img) {
+  TRACE_SCOPE("Model::load_texture");
+
   std::string texfile(filename);
   size_t dot = texfile.find_last_of(".");
   if (dot != std::string::npos) {
     texfile = texfile.substr(0, dot) + std::string(suffix);
+
+    // decoded once for every model that uses the file
+    bool decoded = false;
+    std::shared_ptr<TGAImage> cached =
+        TextureCache::global().load(texfile, &decoded);
     std::cerr << "texture file " << texfile << " loading "
-              << (img.read_tga_file(texfile.c_str()) ? "ok" : "failed")
+              << (!cached ? "failed" : decoded ? "ok" : "ok, cached")
               << std::endl;
-    img.flip_vertically();
+    if (cached) img = cached;
+  }
+}
+
+void Model::compressTextures() {
+  TRACE_SCOPE("Model::compressTextures");
+
+  // the decoded maps are dropped, the cache frees them once no model holds
+  // them any more
+  if (!diffuseBlocks_ && diffusemap_->get_width() > 0) {
+    diffuseBlocks_ = std::make_shared<BlockTexture>(*diffusemap_, BLOCK_BC1);
+    diffusemap_ = std::make_shared<TGAImage>();
+  }
+  if (!normalBlocks_ && normalmap_->get_width() > 0) {
+    normalBlocks_ = std::make_shared<BlockTexture>(*normalmap_, BLOCK_BC5);
+    normalmap_ = std::make_shared<TGAImage>();
   }
 }
 
+size_t Model::textureBytes() const {
+  size_t bytes = 0;
+  for (TGAImage *map : {diffusemap_.get(), normalmap_.get()}) {
+    bytes += (size_t)map->get_width() * map->get_height() * map->get_bytespp();
+  }
+  if (diffuseBlocks_) bytes += diffuseBlocks_->bytes();
+  if (normalBlocks_) bytes += normalBlocks_->bytes();
+  return bytes;
+}
+
+// the nearest texel through the sampling kernel of the active cpu path,
+// zero outside like TGAImage::get
+static TGAColor sampleNearest(TGAImage &map, Vec2f uvf) {
+  unsigned char texel[4];
+  kernels().sampleNearest(map.buffer(), map.get_width(), map.get_height(),
+                          map.get_bytespp(), &uvf.x, &uvf.y, 1, texel);
+  return TGAColor(texel, map.get_bytespp());
+}
+
 TGAColor Model::getDiffuse(Vec2f uvf) {
-  Vec2i uv(uvf.x * diffusemap_.get_width(), uvf.y * diffusemap_.get_height());
-  return diffusemap_.get(uv.x, uv.y);
+  if (diffuseBlocks_) {
+    return diffuseBlocks_->get(int(uvf.x * diffuseBlocks_->width()),
+                               int(uvf.y * diffuseBlocks_->height()));
+  }
+  return sampleNearest(*diffusemap_, uvf);
 }
 
 Vec3f Model::getNormal(Vec2f uvf) {
-  Vec2i uv(uvf.x * normalmap_.get_width(), uvf.y * normalmap_.get_height());
-  TGAColor normalmap_Color = normalmap_.get(uv.x, uv.y);
+  TGAColor normalmap_Color;
+  if (normalBlocks_) {
+    normalmap_Color = normalBlocks_->get(int(uvf.x * normalBlocks_->width()),
+                                         int(uvf.y * normalBlocks_->height()));
+  } else {
+    normalmap_Color = sampleNearest(*normalmap_, uvf);
+  }
   return Vec3f(normalmap_Color[2] / 255.f, normalmap_Color[1] / 255.f,
                normalmap_Color[0] / 255.f) *
              2.f -
@@ -100,15 +325,24 @@ Vec3f Model::getNormal(Vec2f uvf) {
 
 Model::~Model() {}
 
+std::string siblingPath(const std::string &modelFile, const char *extension) {
+  size_t dot = modelFile.find_last_of('.');
+  size_t slash = modelFile.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+    return modelFile + extension;
+  }
+  return modelFile.substr(0, dot) + extension;
+}
+
 int Model::nverts() { return (int)verts_.size(); }
 
 int Model::nfaces() { return (int)faces_.size(); }
 
-std::vector<int> Model::face(int idx) { return faces_[idx]; }
+const std::vector<int> &Model::face(int idx) { return faces_[idx]; }
 
-std::vector<int> Model::texture(int tidx) { return textures_[tidx]; }
+const std::vector<int> &Model::texture(int tidx) { return textures_[tidx]; }
 
-std::vector<int> Model::vertexNomalsIds(int vnidx) {
+const std::vector<int> &Model::vertexNomalsIds(int vnidx) {
   return vertexNomalsIds_[vnidx];
 }
 
@@ -117,3 +351,16 @@ Vec3f Model::vert(int i) { return verts_[i]; }
 Vec2f Model::textCoord(int i) { return tex_coords_[i]; }
 
 Vec3f Model::vertexNomal(int i) { return vertexNomals[i]; }
+
+const Vec3SoA &Model::positions() const { return positions_; }
+
+const Vec3SoA &Model::normals() const { return normals_; }
+
+size_t Model::geometryBytes() const {
+  // a face is three id vectors of three ints, the soa copies double the
+  // positions and normals
+  size_t face = 3 * (sizeof(std::vector<int>) + 3 * sizeof(int));
+  return faces_.size() * face + verts_.size() * 2 * sizeof(Vec3f) +
+         tex_coords_.size() * sizeof(Vec2f) +
+         vertexNomals.size() * 2 * sizeof(Vec3f);
+}
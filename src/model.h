@@ -1,36 +1,78 @@
 #ifndef __MODEL_H__
 #define __MODEL_H__
 
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "blocktexture.h"
 #include "geometry.h"
 #include "tgaimage.h"
 
+struct ObjChunk;
+
 class Model {
  private:
-  TGAImage diffusemap_;
-  TGAImage normalmap_;
+  // shared with the models made from this one
+  std::shared_ptr<TGAImage> diffusemap_;
+  std::shared_ptr<TGAImage> normalmap_;
+  // set by compressTextures, sampled in place of the maps above
+  std::shared_ptr<const BlockTexture> diffuseBlocks_;
+  std::shared_ptr<const BlockTexture> normalBlocks_;
   std::vector<Vec3f> verts_;
   std::vector<Vec2f> tex_coords_;
   std::vector<Vec3f> vertexNomals;
   std::vector<std::vector<int> > faces_;     // id to all verts
   std::vector<std::vector<int> > textures_;  // id to all tex_coords_
   std::vector<std::vector<int> > vertexNomalsIds_;
+  Vec3SoA positions_;  // verts_ for the batch transforms
+  Vec3SoA normals_;    // vertexNomals for the batch transforms
+
+  void mergeObjChunks(std::vector<ObjChunk> &chunks);
 
  public:
-  Model(const char *filename);
+  // with geometry false only the textures next to filename get loaded, for
+  // models whose faces come from elsewhere. Large files are parsed in
+  // chunks split at newlines over threads (0 = one per core), the result is
+  // the same as on one thread
+  Model(const char *filename, bool geometry = true, int threads = 0);
+  // the given faces of source (vertex, texture and normal ids of source per
+  // corner) with only the attributes they use, sharing its textures
+  Model(const Model &source, const std::vector<std::vector<int> > &faces,
+        const std::vector<std::vector<int> > &textures,
+        const std::vector<std::vector<int> > &normals);
+  // a model from its arrays, 9 ids per face in corners (vertex, uv and normal
+  // of every corner), sharing the textures of source
+  Model(const Model &source, std::vector<Vec3f> verts,
+        std::vector<Vec2f> uvs, std::vector<Vec3f> normals,
+        const std::vector<int> &corners);
   ~Model();
   int nverts();
   int nfaces();
   Vec3f vert(int i);
   Vec2f textCoord(int i);
   Vec3f vertexNomal(int i);
-  std::vector<int> face(int idx);
-  std::vector<int> texture(int tidx);
-  std::vector<int> vertexNomalsIds(int nidx);
-  void load_texture(std::string filename, const char *suffix, TGAImage &img);
+  const Vec3SoA &positions() const;
+  const Vec3SoA &normals() const;
+  size_t geometryBytes() const;  // estimate of the heap the arrays take
+  const std::vector<int> &face(int idx);
+  const std::vector<int> &texture(int tidx);
+  const std::vector<int> &vertexNomalsIds(int nidx);
+  // the texture next to filename from the process wide TextureCache, img is
+  // left as it was when there is none
+  void load_texture(std::string filename, const char *suffix,
+                    std::shared_ptr<TGAImage> &img);
+  // keeps the diffuse map bc1 and the normal map bc5 compressed from now on,
+  // sampled a decoded block at a time. Models made from this one later share
+  // the compressed maps
+  void compressTextures();
+  size_t textureBytes() const;  // texels of the maps as held now
   TGAColor getDiffuse(Vec2f uvf);
   Vec3f getNormal(Vec2f uvf);
 };
 
+// modelFile with its extension replaced, or added when it has none. Where
+// the caches made from a model go, such as <model>.lod and <model>.pages
+std::string siblingPath(const std::string& modelFile, const char* extension);
+
 #endif  //__MODEL_H__
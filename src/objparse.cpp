@@ -0,0 +1,62 @@
+#include "objparse.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static void readFloats(const char* p, float* values, int count) {
+  for (int i = 0; i < count; i++) {
+    char* end;
+    values[i] = std::strtof(p, &end);
+    p = end;
+  }
+}
+
+// v, v/vt, v//vn or v/vt/vn corners
+static void readCorners(const char* p, std::vector<long>& corners) {
+  while (true) {
+    while (*p == ' ' || *p == '\t') p++;
+    char* end;
+    long v = std::strtol(p, &end, 10);
+    if (end == p) return;
+    p = end;
+
+    long t = 0, n = 0;
+    if (*p == '/') {
+      p++;
+      if (*p != '/') {
+        t = std::strtol(p, &end, 10);
+        p = end;
+      }
+      if (*p == '/') {
+        n = std::strtol(p + 1, &end, 10);
+        p = end;
+      }
+    }
+
+    corners.push_back(v);
+    corners.push_back(t);
+    corners.push_back(n);
+  }
+}
+
+ObjLineType parseObjLine(const char* line, float values[3],
+                         std::vector<long>& corners) {
+  if (!std::strncmp(line, "v ", 2)) {
+    readFloats(line + 2, values, 3);
+    return OBJ_VERTEX;
+  }
+  if (!std::strncmp(line, "vt ", 3)) {
+    readFloats(line + 3, values, 2);
+    return OBJ_UV;
+  }
+  if (!std::strncmp(line, "vn ", 3)) {
+    readFloats(line + 3, values, 3);
+    return OBJ_NORMAL;
+  }
+  if (!std::strncmp(line, "f ", 2)) {
+    corners.clear();
+    readCorners(line + 2, corners);
+    return OBJ_FACE;
+  }
+  return OBJ_OTHER;
+}
@@ -0,0 +1,24 @@
+#ifndef __OBJPARSE_H__
+#define __OBJPARSE_H__
+
+#include <vector>
+
+// the wavefront obj tokenizer of Model and the pages converter
+
+enum ObjLineType { OBJ_OTHER, OBJ_VERTEX, OBJ_UV, OBJ_NORMAL, OBJ_FACE };
+
+// one null terminated line without its newline. v, vt and vn leave their
+// numbers in values, f leaves the vertex, uv and normal id of every corner in
+// corners as written: from 1, negative counting back, 0 for a missing one
+ObjLineType parseObjLine(const char* line, float values[3],
+                         std::vector<long>& corners);
+
+// an id of corners from 0, count is how many of its attribute came before.
+// -1 for a missing one
+inline int resolveObjId(long id, long count) {
+  if (id > 0) return id - 1;
+  if (id < 0) return count + id;
+  return -1;
+}
+
+#endif  //__OBJPARSE_H__
@@ -0,0 +1,826 @@
+#include "paged.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+#include "objparse.h"
+#include "shader.h"
+#include "trace.h"
+
+static const char PAGES_MAGIC[8] = {'T', 'R', 'P', 'A', 'G', 'E', 'S', '1'};
+
+struct PagesHeader {
+  int64_t sourceBytes;  // size and write time of the obj it was made from
+  int64_t sourceTime;
+  int64_t tableOffset;  // the chunk table follows the chunks
+  int64_t faces;
+  int32_t chunks;
+  int32_t chunkFaces;
+  float min[3];
+  float max[3];
+};
+
+// a chunk starts with its counts: vertices, uvs, normals and faces, then
+// holds their values and 9 ids per face like LodChain::corners
+struct ChunkCounts {
+  int32_t vertices;
+  int32_t uvs;
+  int32_t normals;
+  int32_t faces;
+
+  int64_t bytes() const {
+    return sizeof(ChunkCounts) +
+           (int64_t)(vertices * 3 + uvs * 2 + normals * 3) * sizeof(float) +
+           (int64_t)faces * 9 * sizeof(int32_t);
+  }
+};
+
+// a triangle as read from the obj, vertex, uv and normal ids of every corner
+// from 0, -1 for a missing uv or normal
+struct FaceRecord {
+  int32_t ids[9];
+};
+
+static bool sourceStamp(const std::string& objFile, int64_t& bytes,
+                        int64_t& time) {
+  std::error_code error;
+  bytes = std::filesystem::file_size(objFile, error);
+  if (error) return false;
+  time = std::filesystem::last_write_time(objFile, error)
+             .time_since_epoch()
+             .count();
+  return !error;
+}
+
+// appends fixed size records to a file through a buffer
+struct SpillWriter {
+  std::ofstream out;
+  std::vector<char> buffer;
+  size_t capacity;
+  int recordBytes;
+  long count = 0;
+
+  SpillWriter(const std::string& path, int recordBytes, size_t capacity)
+      : out(path, std::ios::binary),
+        capacity(std::max<size_t>(capacity, recordBytes)),
+        recordBytes(recordBytes) {
+    buffer.reserve(this->capacity);
+  }
+
+  void write(const void* record) {
+    if (buffer.size() + recordBytes > capacity) flush();
+    buffer.insert(buffer.end(), (const char*)record,
+                  (const char*)record + recordBytes);
+    count++;
+  }
+
+  bool flush() {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+    return (bool)out;
+  }
+};
+
+// random reads of the records of a spill file, a page of them at a time into
+// the slot its number picks. Holds at most the bytes it was given, and one
+// page when that is less
+class RecordCache {
+ private:
+  std::ifstream in;
+  int recordBytes;
+  long count;
+  long pageRecords;
+  std::vector<char> data;
+  std::vector<long> pages;  // held by each slot, -1 for none
+  bool failed = false;
+
+ public:
+  RecordCache(const std::string& path, int recordBytes, long count,
+              long bytes)
+      : in(path, std::ios::binary), recordBytes(recordBytes), count(count) {
+    // at least four pages when the budget allows, at most 64 KB each
+    long pageBytes = std::clamp<long>(bytes / 4, recordBytes, 1L << 16);
+    pageRecords = pageBytes / recordBytes;
+    long pageCount = std::max(1L, (count + pageRecords - 1) / pageRecords);
+    long slots = std::clamp<long>(bytes / (pageRecords * recordBytes), 1,
+                                  pageCount);
+    data.resize(slots * pageRecords * recordBytes);
+    pages.assign(slots, -1);
+    failed = !in;
+  }
+
+  const char* get(long i) {
+    long page = i / pageRecords;
+    size_t slot = page % pages.size();
+    char* base = &data[slot * pageRecords * recordBytes];
+
+    if (pages[slot] != page) {
+      long first = page * pageRecords;
+      long records = std::min(pageRecords, count - first);
+      in.clear();
+      in.seekg(first * recordBytes);
+      in.read(base, records * recordBytes);
+      failed = failed || !in;
+      pages[slot] = page;
+    }
+    return base + (i - page * pageRecords) * recordBytes;
+  }
+
+  bool ok() const { return !failed; }
+};
+
+// pass one, the obj lines into spill files
+struct ObjSpill {
+  SpillWriter positions;
+  SpillWriter uvs;
+  SpillWriter normals;
+  SpillWriter faces;
+  Vec3f min = Vec3f(1e30f, 1e30f, 1e30f);
+  Vec3f max = Vec3f(-1e30f, -1e30f, -1e30f);
+  std::vector<long> corners;  // of the face being read, 3 ids each
+
+  ObjSpill(const std::string& prefix, size_t buffer)
+      : positions(prefix + ".v.tmp", 3 * sizeof(float), buffer),
+        uvs(prefix + ".vt.tmp", 2 * sizeof(float), buffer),
+        normals(prefix + ".vn.tmp", 3 * sizeof(float), buffer),
+        faces(prefix + ".f.tmp", sizeof(FaceRecord), buffer) {}
+
+  // one line without its newline, null terminated. Polygons are split into
+  // a fan
+  void parse(const char* line) {
+    float values[3] = {0.f, 0.f, 0.f};
+
+    switch (parseObjLine(line, values, corners)) {
+      case OBJ_VERTEX:
+        for (int i = 0; i < 3; i++) {
+          min.raw[i] = std::min(min.raw[i], values[i]);
+          max.raw[i] = std::max(max.raw[i], values[i]);
+        }
+        positions.write(values);
+        break;
+      case OBJ_UV:
+        uvs.write(values);
+        break;
+      case OBJ_NORMAL:
+        normals.write(values);
+        break;
+      case OBJ_FACE:
+        writeFaces();
+        break;
+      default:
+        break;
+    }
+  }
+
+  void writeFaces() {
+    long counts[3] = {positions.count, uvs.count, normals.count};
+    for (size_t i = 0; i < corners.size(); i++) {
+      corners[i] = resolveObjId(corners[i], counts[i % 3]);
+    }
+
+    int count = corners.size() / 3;
+    for (int k = 1; k + 1 < count; k++) {
+      FaceRecord face;
+      for (int i = 0; i < 3; i++) {
+        face.ids[i] = corners[i];
+        face.ids[3 + i] = corners[k * 3 + i];
+        face.ids[6 + i] = corners[k * 3 + 3 + i];
+      }
+      faces.write(&face);
+    }
+  }
+
+  bool flush() {
+    return positions.flush() & uvs.flush() & normals.flush() & faces.flush();
+  }
+};
+
+static bool spillObj(const std::string& objFile, ObjSpill& spill,
+                     int readBlock) {
+  TRACE_SCOPE("spill obj");
+
+  std::ifstream in(objFile, std::ios::binary);
+  if (!in) return false;
+
+  // a block plus the unfinished line of the one before, which only grows
+  // past a block for a longer line
+  std::vector<char> buffer(std::max(readBlock, 64) + 1);
+  size_t kept = 0;
+
+  while (true) {
+    if (buffer.size() - kept < (size_t)readBlock + 1) {
+      buffer.resize(kept + readBlock + 1);
+    }
+    in.read(&buffer[kept], readBlock);
+    size_t size = kept + in.gcount();
+    bool last = size == kept;
+    if (last) buffer[size++] = '\n';  // the final line may have none
+
+    size_t start = 0;
+    for (size_t i = 0; i < size; i++) {
+      if (buffer[i] != '\n') continue;
+      buffer[i] = '\0';
+      if (i > start && buffer[i - 1] == '\r') buffer[i - 1] = '\0';
+      spill.parse(&buffer[start]);
+      start = i + 1;
+    }
+
+    kept = size - start;
+    std::memmove(buffer.data(), &buffer[start], kept);
+    if (last) break;
+  }
+
+  return spill.flush();
+}
+
+// uniform cells over the bounds, about one per chunkFaces faces. Flat axes
+// get a single cell
+struct ChunkGrid {
+  Vec3f min;
+  float size = 1.f;
+  int dims[3] = {1, 1, 1};
+
+  ChunkGrid(Vec3f min, Vec3f max, long faces, int chunkFaces) : min(min) {
+    double target = std::max(1., std::ceil((double)faces / chunkFaces));
+    double volume = 1.;
+    int axes = 0;
+    for (int i = 0; i < 3; i++) {
+      float extent = max.raw[i] - min.raw[i];
+      if (extent > 0.f) {
+        volume *= extent;
+        axes++;
+      }
+    }
+    if (axes == 0) return;
+
+    size = std::pow(volume / target, 1. / axes);
+    for (int i = 0; i < 3; i++) {
+      float extent = max.raw[i] - min.raw[i];
+      dims[i] = std::clamp((int)std::ceil(extent / size), 1, 256);
+    }
+  }
+
+  int cells() const { return dims[0] * dims[1] * dims[2]; }
+
+  int cellOf(Vec3f p) const {
+    int cell[3];
+    for (int i = 0; i < 3; i++) {
+      cell[i] = std::clamp((int)((p.raw[i] - min.raw[i]) / size), 0,
+                           dims[i] - 1);
+    }
+    return (cell[2] * dims[1] + cell[1]) * dims[0] + cell[0];
+  }
+};
+
+// faces of a cell written to the runs file by one flush
+struct CellRun {
+  int64_t offset;
+  long count;
+};
+
+// pass two, the faces into per cell runs. Half the budget caches positions
+// for the centroids, a quarter holds the buckets until they get flushed
+static bool bucketFaces(const std::string& prefix, const ChunkGrid& grid,
+                        long positions, long faces, long budget,
+                        std::vector<std::vector<CellRun> >& runs) {
+  TRACE_SCOPE("bucket faces");
+
+  RecordCache points(prefix + ".v.tmp", 3 * sizeof(float), positions,
+                     budget / 2);
+  RecordCache records(prefix + ".f.tmp", sizeof(FaceRecord), faces,
+                      std::min(budget / 4, 1L << 16));
+  std::ofstream out(prefix + ".runs.tmp", std::ios::binary);
+
+  std::vector<std::vector<FaceRecord> > buckets(grid.cells());
+  runs.assign(grid.cells(), {});
+  long bucketBytes = std::max<long>(budget / 4, sizeof(FaceRecord));
+  long buffered = 0;
+  int64_t offset = 0;
+
+  auto flush = [&]() {
+    for (size_t cell = 0; cell < buckets.size(); cell++) {
+      std::vector<FaceRecord>& bucket = buckets[cell];
+      if (bucket.empty()) continue;
+      out.write((const char*)bucket.data(), bucket.size() * sizeof(FaceRecord));
+      runs[cell].push_back({offset, (long)bucket.size()});
+      offset += bucket.size() * sizeof(FaceRecord);
+      bucket.clear();
+      bucket.shrink_to_fit();
+    }
+    buffered = 0;
+  };
+
+  for (long f = 0; f < faces; f++) {
+    FaceRecord face;
+    std::memcpy(&face, records.get(f), sizeof(face));
+
+    Vec3f centroid(0.f, 0.f, 0.f);
+    for (int k = 0; k < 3; k++) {
+      int32_t id = face.ids[k * 3];
+      if (id < 0 || id >= positions) return false;
+      const float* p = (const float*)points.get(id);
+      centroid = centroid + Vec3f(p[0], p[1], p[2]) * (1.f / 3.f);
+    }
+
+    buckets[grid.cellOf(centroid)].push_back(face);
+    buffered += sizeof(FaceRecord);
+    if (buffered >= bucketBytes) flush();
+  }
+  flush();
+
+  return points.ok() && records.ok() && (bool)out;
+}
+
+// the attributes of the faces of one chunk, renumbered from 0
+struct ChunkBuilder {
+  RecordCache positions;
+  RecordCache uvs;
+  RecordCache normals;
+  long counts[3];
+
+  std::unordered_map<int32_t, int32_t> remap[3];
+  std::vector<Vec3f> verts;
+  std::vector<Vec2f> texCoords;
+  std::vector<Vec3f> vertexNormals;
+  std::vector<int32_t> corners;
+
+  ChunkBuilder(const std::string& prefix, const long counts[3], long budget)
+      : positions(prefix + ".v.tmp", 3 * sizeof(float), counts[0],
+                  budget / 4),
+        uvs(prefix + ".vt.tmp", 2 * sizeof(float), counts[1], budget / 4),
+        normals(prefix + ".vn.tmp", 3 * sizeof(float), counts[2],
+                budget / 4),
+        counts{counts[0], counts[1], counts[2]} {}
+
+  int32_t vertex(int32_t id) {
+    auto inserted = remap[0].emplace(id, verts.size());
+    if (inserted.second) {
+      const float* p = (const float*)positions.get(id);
+      verts.push_back(Vec3f(p[0], p[1], p[2]));
+    }
+    return inserted.first->second;
+  }
+
+  int32_t uv(int32_t id) {
+    auto inserted = remap[1].emplace(id, texCoords.size());
+    if (inserted.second) {
+      Vec2f t(0.f, 0.f);
+      if (id >= 0) {
+        const float* p = (const float*)uvs.get(id);
+        t = Vec2f(p[0], p[1]);
+      }
+      texCoords.push_back(t);
+    }
+    return inserted.first->second;
+  }
+
+  int32_t normal(int32_t id) {
+    auto inserted = remap[2].emplace(id, vertexNormals.size());
+    if (inserted.second) {
+      const float* p = (const float*)normals.get(id);
+      vertexNormals.push_back(Vec3f(p[0], p[1], p[2]));
+    }
+    return inserted.first->second;
+  }
+
+  // false for an id past the attributes the obj has
+  bool add(const FaceRecord& face) {
+    for (int k = 0; k < 3; k++) {
+      for (int a = 0; a < 3; a++) {
+        int32_t id = face.ids[k * 3 + a];
+        if (id >= counts[a] || id < (a == 0 ? 0 : -1)) return false;
+      }
+    }
+
+    int32_t local[9];
+    for (int k = 0; k < 3; k++) {
+      local[k * 3] = vertex(face.ids[k * 3]);
+      local[k * 3 + 1] = uv(face.ids[k * 3 + 1]);
+    }
+
+    // a face without normals gets its own flat one
+    for (int k = 0; k < 3; k++) {
+      int32_t id = face.ids[k * 3 + 2];
+      if (id >= 0) {
+        local[k * 3 + 2] = normal(id);
+        continue;
+      }
+      Vec3f a = verts[local[0]];
+      Vec3f n = cross(verts[local[3]] - a, verts[local[6]] - a);
+      if (n.norm() > 0.f) n.normalize();
+      local[k * 3 + 2] = vertexNormals.size();
+      vertexNormals.push_back(n);
+    }
+
+    corners.insert(corners.end(), local, local + 9);
+    return true;
+  }
+
+  int faces() const { return corners.size() / 9; }
+
+  bool write(std::ofstream& out, PagedChunk& chunk) {
+    ChunkCounts header{(int32_t)verts.size(), (int32_t)texCoords.size(),
+                       (int32_t)vertexNormals.size(), faces()};
+    chunk.offset = out.tellp();
+    chunk.bytes = header.bytes();
+    chunk.faces = header.faces;
+    chunk.vertices = header.vertices;
+    chunk.min = Vec3f(1e30f, 1e30f, 1e30f);
+    chunk.max = Vec3f(-1e30f, -1e30f, -1e30f);
+    for (const Vec3f& v : verts) {
+      for (int i = 0; i < 3; i++) {
+        chunk.min.raw[i] = std::min(chunk.min.raw[i], v.raw[i]);
+        chunk.max.raw[i] = std::max(chunk.max.raw[i], v.raw[i]);
+      }
+    }
+
+    out.write((const char*)&header, sizeof(header));
+    for (const Vec3f& v : verts) out.write((const char*)v.raw, 12);
+    for (const Vec2f& t : texCoords) out.write((const char*)t.raw, 8);
+    for (const Vec3f& n : vertexNormals) out.write((const char*)n.raw, 12);
+    out.write((const char*)corners.data(), corners.size() * sizeof(int32_t));
+
+    for (auto& map : remap) map.clear();
+    verts.clear();
+    texCoords.clear();
+    vertexNormals.clear();
+    corners.clear();
+    return (bool)out;
+  }
+
+  bool ok() const { return positions.ok() && uvs.ok() && normals.ok(); }
+};
+
+// pass three, every cell as chunks of at most chunkFaces faces
+static bool writeChunks(const std::string& prefix, const long counts[3],
+                        const std::vector<std::vector<CellRun> >& runs,
+                        const PagingOptions& options, std::ofstream& out,
+                        std::vector<PagedChunk>& chunks) {
+  TRACE_SCOPE("write chunks");
+
+  std::ifstream in(prefix + ".runs.tmp", std::ios::binary);
+  ChunkBuilder builder(prefix, counts, options.memoryBudget);
+  std::vector<FaceRecord> block(
+      std::clamp<long>(options.memoryBudget / 8 / sizeof(FaceRecord), 1,
+                       options.chunkFaces));
+
+  auto emit = [&]() {
+    chunks.emplace_back();
+    return builder.write(out, chunks.back());
+  };
+
+  for (const std::vector<CellRun>& cell : runs) {
+    for (const CellRun& run : cell) {
+      in.seekg(run.offset);
+      for (long done = 0; done < run.count;) {
+        long count = std::min<long>(run.count - done, block.size());
+        in.read((char*)block.data(), count * sizeof(FaceRecord));
+        if (!in) return false;
+
+        for (long i = 0; i < count; i++) {
+          if (!builder.add(block[i])) return false;
+          if (builder.faces() == options.chunkFaces && !emit()) return false;
+        }
+        done += count;
+      }
+    }
+    if (builder.faces() > 0 && !emit()) return false;
+  }
+
+  return builder.ok();
+}
+
+bool convertToPages(const std::string& objFile, const std::string& pagesFile,
+                    const PagingOptions& options) {
+  TRACE_SCOPE("convertToPages");
+
+  PagesHeader header = {};
+  if (!sourceStamp(objFile, header.sourceBytes, header.sourceTime)) {
+    return false;
+  }
+
+  const std::string& prefix = pagesFile;
+  long budget = std::max(options.memoryBudget, 1L << 12);
+  size_t spillBuffer = std::clamp<long>(budget / 16, 512, 1L << 16);
+
+  ObjSpill spill(prefix, spillBuffer);
+  bool ok = spillObj(objFile, spill, std::max(options.readBlock, 1));
+  long counts[3] = {spill.positions.count, spill.uvs.count,
+                    spill.normals.count};
+  long faces = spill.faces.count;
+  spill.positions.out.close();
+  spill.uvs.out.close();
+  spill.normals.out.close();
+  spill.faces.out.close();
+
+  ChunkGrid grid(spill.min, spill.max, faces,
+                 std::max(options.chunkFaces, 1));
+  std::vector<std::vector<CellRun> > runs;
+  ok = ok && bucketFaces(prefix, grid, counts[0], faces, budget, runs);
+
+  std::ofstream out(pagesFile, std::ios::binary);
+  out.write(PAGES_MAGIC, sizeof(PAGES_MAGIC));
+  out.write((const char*)&header, sizeof(header));
+
+  std::vector<PagedChunk> chunks;
+  PagingOptions chunking = options;
+  chunking.memoryBudget = budget;
+  chunking.chunkFaces = std::max(options.chunkFaces, 1);
+  ok = ok && writeChunks(prefix, counts, runs, chunking, out, chunks);
+
+  header.tableOffset = out.tellp();
+  header.faces = faces;
+  header.chunks = chunks.size();
+  header.chunkFaces = chunking.chunkFaces;
+  for (int i = 0; i < 3; i++) {
+    header.min[i] = faces ? spill.min.raw[i] : 0.f;
+    header.max[i] = faces ? spill.max.raw[i] : 0.f;
+  }
+  out.write((const char*)chunks.data(), chunks.size() * sizeof(PagedChunk));
+  out.seekp(sizeof(PAGES_MAGIC));
+  out.write((const char*)&header, sizeof(header));
+  ok = ok && (bool)out;
+  out.close();
+
+  for (const char* suffix : {".v.tmp", ".vt.tmp", ".vn.tmp", ".f.tmp",
+                             ".runs.tmp"}) {
+    std::error_code error;
+    std::filesystem::remove(prefix + suffix, error);
+  }
+  if (!ok) {
+    std::error_code error;
+    std::filesystem::remove(pagesFile, error);
+  }
+  return ok;
+}
+
+bool PagedModel::open(const std::string& pagesFile,
+                      const std::string& objFile, long memoryBudget) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  chunks_.clear();
+  resident_.clear();
+  residentBytes_ = 0;
+  budget_ = memoryBudget;
+  file_.close();
+  file_.clear();
+  file_.open(pagesFile, std::ios::binary);
+
+  char magic[sizeof(PAGES_MAGIC)];
+  PagesHeader header;
+  file_.read(magic, sizeof(magic));
+  file_.read((char*)&header, sizeof(header));
+  if (!file_ || std::memcmp(magic, PAGES_MAGIC, sizeof(magic)) ||
+      header.chunks < 0) {
+    return false;
+  }
+
+  // a pages file still works without its obj, not with a changed one
+  int64_t bytes, time;
+  if (sourceStamp(objFile, bytes, time) &&
+      (bytes != header.sourceBytes || time != header.sourceTime)) {
+    return false;
+  }
+
+  std::vector<PagedChunk> chunks(header.chunks);
+  file_.seekg(header.tableOffset);
+  file_.read((char*)chunks.data(), chunks.size() * sizeof(PagedChunk));
+  if (!file_) return false;
+  for (const PagedChunk& chunk : chunks) {
+    if (chunk.offset < 0 || chunk.offset + chunk.bytes > header.tableOffset) {
+      return false;
+    }
+  }
+
+  chunks_ = std::move(chunks);
+  resident_.resize(chunks_.size());
+  faces_ = header.faces;
+  min_ = Vec3f(header.min[0], header.min[1], header.min[2]);
+  max_ = Vec3f(header.max[0], header.max[1], header.max[2]);
+  textures_ = std::make_unique<Model>(objFile.c_str(), false);
+  return true;
+}
+
+std::shared_ptr<Model> PagedModel::pageIn(
+    int i, [[maybe_unused]] PipelineStats& stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Resident& resident = resident_[i];
+  resident.lastUse = ++useClock_;
+  if (resident.model) return resident.model;
+
+  TRACE_SCOPE("page in");
+  STATS_TIMER(stats, STAGE_PAGE_IN);
+
+  const PagedChunk& chunk = chunks_[i];
+  std::vector<char> data(chunk.bytes);
+  file_.clear();
+  file_.seekg(chunk.offset);
+  file_.read(data.data(), data.size());
+
+  ChunkCounts counts;
+  if (!file_ || chunk.bytes < (int64_t)sizeof(counts)) return nullptr;
+  std::memcpy(&counts, data.data(), sizeof(counts));
+  if (counts.vertices < 0 || counts.uvs < 0 || counts.normals < 0 ||
+      counts.faces < 0 || counts.bytes() != chunk.bytes) {
+    return nullptr;
+  }
+
+  const float* values = (const float*)(data.data() + sizeof(counts));
+  std::vector<Vec3f> verts(counts.vertices);
+  std::vector<Vec2f> uvs(counts.uvs);
+  std::vector<Vec3f> normals(counts.normals);
+  for (Vec3f& v : verts) {
+    v = Vec3f(values[0], values[1], values[2]);
+    values += 3;
+  }
+  for (Vec2f& t : uvs) {
+    t = Vec2f(values[0], values[1]);
+    values += 2;
+  }
+  for (Vec3f& n : normals) {
+    n = Vec3f(values[0], values[1], values[2]);
+    values += 3;
+  }
+
+  std::vector<int> corners(counts.faces * 9);
+  std::memcpy(corners.data(), values, corners.size() * sizeof(int32_t));
+  int limits[3] = {counts.vertices, counts.uvs, counts.normals};
+  for (size_t c = 0; c < corners.size(); c++) {
+    if (corners[c] < 0 || corners[c] >= limits[c % 3]) return nullptr;
+  }
+
+  resident.model =
+      std::make_shared<Model>(*textures_, std::move(verts), std::move(uvs),
+                              std::move(normals), corners);
+  resident.bytes = resident.model->geometryBytes();
+  residentBytes_ += resident.bytes;
+
+  STATS_ADD(stats, chunksPagedIn, 1);
+  STATS_ADD(stats, pageInBytes, chunk.bytes);
+
+  evictTo(budget_, i);
+  return resident.model;
+}
+
+void PagedModel::evictTo(long bytes, int keep) {
+  while (residentBytes_ > bytes) {
+    int oldest = -1;
+    for (int i = 0; i < (int)resident_.size(); i++) {
+      if (i == keep || !resident_[i].model) continue;
+      if (oldest < 0 || resident_[i].lastUse < resident_[oldest].lastUse) {
+        oldest = i;
+      }
+    }
+    if (oldest < 0) return;
+
+    residentBytes_ -= resident_[oldest].bytes;
+    if (resident_[oldest].model.use_count() > 1) {
+      released_.push_back(
+          Released{resident_[oldest].model, resident_[oldest].bytes});
+    }
+    resident_[oldest] = Resident();
+  }
+}
+
+long PagedModel::residentBytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return residentBytes_;
+}
+
+long PagedModel::heldBytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  released_.erase(std::remove_if(released_.begin(), released_.end(),
+                                 [](const Released& released) {
+                                   return released.model.expired();
+                                 }),
+                  released_.end());
+  long bytes = residentBytes_;
+  for (const Released& released : released_) bytes += released.bytes;
+  return bytes;
+}
+
+void PagedModel::setMemoryBudget(long bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = bytes;
+  evictTo(budget_, -1);
+}
+
+void PagedModel::evictAll() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  evictTo(-1, -1);
+}
+
+PagesStatus openOrConvertPages(PagedModel& paged, const std::string& objFile,
+                               const std::string& pagesFile,
+                               const PagingOptions& options) {
+  if (paged.open(pagesFile, objFile, options.memoryBudget)) {
+    return PAGES_OPENED;
+  }
+  if (!convertToPages(objFile, pagesFile, options) ||
+      !paged.open(pagesFile, objFile, options.memoryBudget)) {
+    return PAGES_FAILED;
+  }
+  return PAGES_CONVERTED;
+}
+
+// the box against the sides of the view from frustumPlanes, like
+// Bvh::cullFaces
+static bool boxInView(const float planes[5][4], Vec3f min, Vec3f max) {
+  for (int p = 0; p < 5; p++) {
+    float far = planes[p][3];
+    for (int i = 0; i < 3; i++) {
+      far += std::max(planes[p][i] * min.raw[i], planes[p][i] * max.raw[i]);
+    }
+    if (far < 0.f) return false;
+  }
+  return true;
+}
+
+void renderPaged(RenderContext& ctx, PagedModel& paged,
+                 const CameraPose& pose, Vec3f light) {
+  TRACE_SCOPE("renderPaged");
+
+  ctx.clear();
+  STATS_ONLY(long allocations = heapAllocationCount());
+
+  applyCamera(ctx, pose);
+
+  Matrix clip = ctx.Projection * ctx.ModelView;
+  float planes[5][4];
+  frustumPlanes(clip, planes);
+
+  std::pmr::vector<int> visible(&ctx.arena);
+  for (int i = 0; i < paged.chunkCount(); i++) {
+    const PagedChunk& chunk = paged.chunk(i);
+    if (boxInView(planes, chunk.min, chunk.max)) {
+      visible.push_back(i);
+    } else {
+      STATS_ADD(ctx.stats, facesCulled, chunk.faces);
+    }
+  }
+
+  // nearest first, so fewer fragments behind others get shaded
+  auto depth = [&](int i) {
+    Vec3f c = (paged.chunk(i).min + paged.chunk(i).max) * 0.5f;
+    return clip(3, 0) * c.x + clip(3, 1) * c.y + clip(3, 2) * c.z + clip(3, 3);
+  };
+  std::sort(visible.begin(), visible.end(),
+            [&](int a, int b) { return depth(a) < depth(b); });
+
+  // chunks are drawn whole, the helpers of the bound model don't apply
+  Model* model = ctx.model;
+  const Bvh* bvh = ctx.bvh;
+  const Meshlets* meshlets = ctx.meshlets;
+  const LodChain* lods = ctx.lods;
+  ctx.bvh = nullptr;
+  ctx.meshlets = nullptr;
+  ctx.lods = nullptr;
+
+  if (ctx.shadow.size > 0) {
+    float radius = 0.f;
+    for (int i = 0; i < 8; i++) {
+      Vec3f corner(i & 1 ? paged.max().x : paged.min().x,
+                   i & 2 ? paged.max().y : paged.min().y,
+                   i & 4 ? paged.max().z : paged.min().z);
+      radius = std::max(radius, (corner - pose.center).norm());
+    }
+    fitShadowMap(ctx, light, pose.center, radius);
+
+    // farthest first, so the nearest ones the color pass starts with are
+    // the ones still resident. Chunks are only held while drawn: when the
+    // ones in view don't fit in the budget some are read again, and memory
+    // stays within it
+    Matrix identity = Matrix::identity(4);
+    for (auto i = visible.rbegin(); i != visible.rend(); ++i) {
+      std::shared_ptr<Model> chunk = paged.pageIn(*i, ctx.stats);
+      if (chunk) drawShadowCasters(ctx, *chunk, &identity, 1);
+    }
+  }
+
+  // one shader for every chunk, its arrays only grow to the largest one
+  TexturingShader shader(&ctx.arena);
+  ctx.shader = &shader;
+  for (int i : visible) {
+    std::shared_ptr<Model> chunk = paged.pageIn(i, ctx.stats);
+    if (!chunk) continue;
+    ctx.model = chunk.get();
+    shader.setup(ctx, light);
+    drawModel(ctx);
+  }
+  resolveSamples(ctx);
+
+  ctx.shader = nullptr;
+  ctx.model = model;
+  ctx.bvh = bvh;
+  ctx.meshlets = meshlets;
+  ctx.lods = lods;
+
+  STATS_ADD(ctx.stats, residentBytes, paged.residentBytes());
+  STATS_ADD(ctx.stats, heldBytes, paged.heldBytes());
+  STATS_ADD(ctx.stats, heapAllocations, heapAllocationCount() - allocations);
+  STATS_ADD(ctx.stats, arenaBytes, ctx.arena.used());
+}
@@ -0,0 +1,123 @@
+#ifndef __PAGED_H__
+#define __PAGED_H__
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "stats.h"
+
+struct PagingOptions {
+  long memoryBudget = 64L << 20;  // resident chunks, and the buffers of a
+                                  // conversion
+  int chunkFaces = 16384;         // most faces per chunk
+  int readBlock = 1 << 20;        // bytes of obj read at a time
+};
+
+// a box of the model stored as a mesh of its own in the pages file
+struct PagedChunk {
+  Vec3f min;
+  Vec3f max;
+  int64_t offset = 0;  // in the file
+  int64_t bytes = 0;
+  int32_t faces = 0;
+  int32_t vertices = 0;
+};
+
+// streams objFile into pagesFile without ever holding the model: the obj is
+// read readBlock bytes at a time and its vertices, uvs, normals and faces
+// are spilled to temporary files next to pagesFile, the faces are sorted
+// into a grid of cells by their centroid, and each cell is written as chunks
+// of at most chunkFaces faces. Every buffer on the way stays under
+// memoryBudget. Polygons are split into fans, negative ids count back from
+// the last attribute read. False when objFile can't be read or pagesFile
+// written
+bool convertToPages(const std::string& objFile, const std::string& pagesFile,
+                    const PagingOptions& options = PagingOptions());
+
+// the chunk table of a pages file in memory, the chunks paged in on demand
+// and kept while they fit the memory budget, the least recently used one is
+// dropped first. Any number of threads can page in, reads are serialized
+class PagedModel {
+ private:
+  struct Resident {
+    std::shared_ptr<Model> model;
+    long bytes = 0;
+    long lastUse = 0;
+  };
+
+  // evicted, but still alive where a caller holds the pointer
+  struct Released {
+    std::weak_ptr<Model> model;
+    long bytes = 0;
+  };
+
+  std::unique_ptr<Model> textures_;  // no geometry, shared by the chunks
+  std::vector<PagedChunk> chunks_;
+  std::vector<Resident> resident_;
+  std::vector<Released> released_;
+  Vec3f min_, max_;
+  long faces_ = 0;
+  long budget_ = 0;
+  long residentBytes_ = 0;
+  long useClock_ = 0;
+  std::ifstream file_;
+  std::mutex mutex_;
+
+ public:
+  // false when pagesFile is missing, damaged or older than a change of
+  // objFile, whose textures the chunks use
+  bool open(const std::string& pagesFile, const std::string& objFile,
+            long memoryBudget);
+
+  int chunkCount() const { return chunks_.size(); }
+  const PagedChunk& chunk(int i) const { return chunks_[i]; }
+  long faceCount() const { return faces_; }
+  Vec3f min() const { return min_; }
+  Vec3f max() const { return max_; }
+  const Model& textures() const { return *textures_; }
+  // chunks paged in from now on share what is done to it
+  Model& textures() { return *textures_; }
+
+  // the model of chunk i, read from the file unless it is resident. The
+  // pointer keeps it alive after an eviction. Page ins, their bytes and time
+  // go to stats, nullptr when the read fails
+  std::shared_ptr<Model> pageIn(int i, PipelineStats& stats);
+
+  long residentBytes();
+  // resident plus the evicted chunks callers still hold
+  long heldBytes();
+  long memoryBudget() const { return budget_; }
+  void setMemoryBudget(long bytes);  // evicts down to it
+  void evictAll();
+
+ private:
+  void evictTo(long bytes, int keep);
+};
+
+enum PagesStatus {
+  PAGES_OPENED,     // the existing file was up to date
+  PAGES_CONVERTED,  // written from objFile first
+  PAGES_FAILED,     // objFile can't be read or pagesFile written
+};
+
+// opens pagesFile, or converts objFile to it first when it is missing or
+// stale
+PagesStatus openOrConvertPages(PagedModel& paged, const std::string& objFile,
+                               const std::string& pagesFile,
+                               const PagingOptions& options);
+
+// renderView for a paged model: the chunks whose box is in view are paged in
+// nearest first and each drawn with its own vertex stage. A sized ctx.shadow
+// gets the shadows cast by the chunks in view only
+void renderPaged(RenderContext& ctx, PagedModel& paged,
+                 const CameraPose& pose, Vec3f light);
+
+#endif  //__PAGED_H__
@@ -0,0 +1,112 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "batch.h"
+#include "gl.h"
+#include "model.h"
+#include "trace.h"
+
+FramePipeline::FramePipeline(Model& model, int width, int height,
+                             int queueDepth, RenderFunction render)
+    : queueDepth(std::max(1, std::min(MAX_QUEUE_DEPTH, queueDepth))),
+      render(render) {
+  // one frame on screen plus queueDepth rendered or being rendered
+  for (int i = 0; i < this->queueDepth + 1; i++) {
+    frames.emplace_back(new Frame(width, height));
+    frames.back()->context.model = &model;
+    freeFrames.push_back(frames.back().get());
+  }
+
+  worker = std::thread(&FramePipeline::run, this);
+}
+
+FramePipeline::~FramePipeline() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  workAvailable.notify_all();
+  requestTaken.notify_all();
+  worker.join();
+}
+
+bool FramePipeline::submit(const CameraPose& pose, bool wait) {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  if ((int)requests.size() >= queueDepth) {
+    if (!wait) return false;
+    requestTaken.wait(lock, [&] {
+      return stopping || (int)requests.size() < queueDepth;
+    });
+    if (stopping) return false;
+  }
+
+  requests.push_back(pose);
+  lock.unlock();
+  workAvailable.notify_one();
+  return true;
+}
+
+Frame* FramePipeline::acquire(bool wait) {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  if (readyFrames.empty()) {
+    // nothing would ever arrive if there is no request left to render
+    if (!wait || rendered == submitted + (long)requests.size()) return nullptr;
+    frameReady.wait(lock, [&] { return !readyFrames.empty(); });
+  }
+
+  Frame* frame = readyFrames.front();
+  readyFrames.pop_front();
+  return frame;
+}
+
+void FramePipeline::release(Frame* frame) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    freeFrames.push_back(frame);
+  }
+  workAvailable.notify_one();
+}
+
+void FramePipeline::run() {
+  using Clock = std::chrono::steady_clock;
+
+  TRACE_THREAD("render");
+
+  while (true) {
+    Frame* frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      workAvailable.wait(lock, [&] {
+        return stopping || (!requests.empty() && !freeFrames.empty());
+      });
+      if (stopping) return;
+
+      frame = freeFrames.front();
+      freeFrames.pop_front();
+      frame->pose = requests.front();
+      frame->sequence = submitted++;
+      requests.pop_front();
+    }
+    requestTaken.notify_one();
+
+    Clock::time_point start = Clock::now();
+    {
+      TRACE_SCOPE("render frame");
+      render(frame->context, frame->pose);
+    }
+    frame->renderMilliseconds =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      readyFrames.push_back(frame);
+      rendered++;
+    }
+    frameReady.notify_one();
+  }
+}
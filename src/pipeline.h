@@ -0,0 +1,72 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "gl.h"
+#include "model.h"
+
+const int MAX_QUEUE_DEPTH = 2;
+
+struct Frame {
+  RenderContext context;
+  long sequence = -1;  // order of the request that produced it
+  CameraPose pose;
+  double renderMilliseconds = 0.;
+
+  Frame(int width, int height) : context(width, height) {}
+};
+
+// renders frames on its own thread while the caller presents the previous
+// ones. Frames move between the free, ready and presenting states by pointer,
+// the pixels are never copied. At most queueDepth frames are rendered ahead
+// of the one being presented.
+class FramePipeline {
+ public:
+  using RenderFunction = std::function<void(RenderContext&, const CameraPose&)>;
+
+  FramePipeline(Model& model, int width, int height, int queueDepth,
+                RenderFunction render);
+  ~FramePipeline();
+
+  // queues a pose, when queueDepth poses are already waiting it blocks if
+  // wait is set or drops the pose and returns false
+  bool submit(const CameraPose& pose, bool wait);
+
+  // oldest rendered frame, nullptr when there is none and wait is false
+  Frame* acquire(bool wait);
+
+  // hands a presented frame back to the render thread
+  void release(Frame* frame);
+
+  int getQueueDepth() const { return queueDepth; }
+
+ private:
+  int queueDepth;
+  RenderFunction render;
+
+  std::vector<std::unique_ptr<Frame> > frames;
+  std::deque<Frame*> freeFrames;
+  std::deque<Frame*> readyFrames;
+  std::deque<CameraPose> requests;
+  long submitted = 0;
+  long rendered = 0;
+  bool stopping = false;
+
+  std::mutex mutex;
+  std::condition_variable workAvailable;  // request and free frame, or stop
+  std::condition_variable frameReady;
+  std::condition_variable requestTaken;
+  std::thread worker;
+
+  void run();
+};
+
+#endif  //__PIPELINE_H__
@@ -0,0 +1,212 @@
+#include "raycast.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "shader.h"
+#include "stats.h"
+#include "tgaimage.h"
+#include "trace.h"
+
+const float SURFACE_OFFSET = 1e-3f;  // secondary rays start off the surface
+const float GOLDEN_ANGLE = 2.39996323f;
+
+// where the camera rays of a pose come from, every pixel ray goes from the
+// eye through the pixel on the depth 127.5 plane
+struct RayCamera {
+  Vec3f eye;
+  Matrix toObject = Matrix(4, 4);  // screen coords back to object space
+
+  Vec3f direction(int x, int y) const {
+    Vec4f target = Vec4f(toObject * Vec4f(x, y, 127.5f, 1.f)).hogenize();
+    return target.xyz() - eye;
+  }
+};
+
+// per pixel turn of the occlusion pattern, the same for any tiling
+static float pixelTurn(int x, int y) {
+  unsigned hash = (unsigned)x * 73856093u ^ (unsigned)y * 19349663u;
+  hash ^= hash >> 13;
+  hash *= 0x5bd1e995u;
+  hash ^= hash >> 15;
+  return (hash & 0xffff) * (2.f * (float)M_PI / 65536.f);
+}
+
+// fraction of count cosine weighted rays around normal that hit something
+// within radius, cast four at a time
+static float occlusion(const Bvh& bvh, Vec3f point, Vec3f normal, int count,
+                       float radius, float turn,
+                       [[maybe_unused]] PipelineStats& stats) {
+  Vec3f axis = std::abs(normal.x) < 0.9f ? Vec3f(1, 0, 0) : Vec3f(0, 1, 0);
+  Vec3f tangent = cross(normal, axis).normalize();
+  Vec3f bitangent = cross(normal, tangent);
+
+  int occluded = 0;
+
+  for (int first = 0; first < count; first += 4) {
+    RayPacket packet;
+    packet.active = 0;
+
+    for (int lane = 0; lane < 4; lane++) {
+      int i = std::min(first + lane, count - 1);
+      float r = std::sqrt((i + 0.5f) / count);
+      float angle = i * GOLDEN_ANGLE + turn;
+      Vec3f direction = tangent * (r * std::cos(angle)) +
+                        bitangent * (r * std::sin(angle)) +
+                        normal * std::sqrt(1.f - r * r);
+
+      packet.set(lane, point, direction);
+      if (first + lane < count) packet.active |= 1 << lane;
+    }
+
+    RayHit hits[4];
+    occluded += __builtin_popcount(bvh.intersectPacket(packet, hits, radius));
+  }
+
+  STATS_ADD(stats, secondaryRays, count);
+  return (float)occluded / count;
+}
+
+// shades the hit of the ray through pixel (x, y) into the context
+static void shadeHit(RenderContext& ctx, TexturingShader& shader,
+                     const Bvh& bvh, const RayCamera& camera, int x, int y,
+                     Vec3f direction, const RayHit& hit, Vec3f light,
+                     const RaycastOptions& options, PipelineStats& stats) {
+  Vec3f screen[3];
+  for (int j = 0; j < 3; j++) screen[j] = shader.vertex(hit.face, j);
+
+  // screen space barycentrics like the rasterizer passes, the ray ones when
+  // the projected triangle is too thin for them
+  Vec4f bar = getBarycentric(screen, Vec3i(x, y, 0));
+  if (bar.x < 0.f || bar.y < 0.f || bar.z < 0.f) {
+    bar = Vec4f(1.f - hit.u - hit.v, hit.u, hit.v, 0.f);
+  }
+
+  TGAColor color;
+  STATS_ADD(stats, fragmentsShaded, 1);
+  if (shader.fragment(bar, color)) {
+    STATS_ADD(stats, fragmentDiscards, 1);
+    return;
+  }
+
+  float visibility = 1.f;
+
+  if (options.shadows || options.occlusionRays > 0) {
+    Model& model = *ctx.model;
+    const std::vector<int>& face = model.face(hit.face);
+    Vec3f a = model.vert(face[0]);
+    Vec3f normal =
+        cross(model.vert(face[1]) - a, model.vert(face[2]) - a).normalize();
+    if (normal * direction > 0.f) normal = normal * -1.f;
+
+    Vec3f point = camera.eye + direction * hit.t + normal * SURFACE_OFFSET;
+
+    if (options.shadows) {
+      RayHit blocker;
+      STATS_ADD(stats, secondaryRays, 1);
+      if (bvh.intersect(point, light, blocker)) visibility = SHADOW_AMBIENT;
+    }
+
+    if (options.occlusionRays > 0) {
+      visibility *= 1.f - occlusion(bvh, point, normal, options.occlusionRays,
+                                    options.occlusionRadius, pixelTurn(x, y),
+                                    stats);
+    }
+  }
+
+  if (visibility < 1.f) color = color * visibility;
+  color[3] = 255;
+
+  long pixel = x + (long)y * ctx.width;
+  std::memcpy((uint32_t*)ctx.framebuffer.buffer() + pixel, color.bgra, 4);
+  ctx.zbuffer[pixel] = bar.x * screen[0].z + bar.y * screen[1].z +
+                       bar.z * screen[2].z;
+}
+
+void raycastView(RenderContext& ctx, const Bvh& bvh, const CameraPose& pose,
+                 Vec3f light, const RaycastOptions& options) {
+  TRACE_SCOPE("raycastView");
+
+  ctx.clear();
+  applyCamera(ctx, pose);
+
+  if (ctx.shadow.size > 0) renderShadowMap(ctx, light, pose.center);
+
+  RayCamera camera;
+  camera.eye = pose.eye;
+  (ctx.ViewPort * ctx.Projection * ctx.ModelView).inverse(camera.toObject);
+
+  STATS_TIMER(ctx.stats, STAGE_TRACE);
+
+  int tileSize = std::max(2, options.tileSize & ~1);  // whole packets
+  int tilesX = (ctx.width + tileSize - 1) / tileSize;
+  int tilesY = (ctx.height + tileSize - 1) / tileSize;
+  int tiles = tilesX * tilesY;
+
+  int threads = options.threads;
+  if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, tiles);
+
+  std::vector<PipelineStats> threadStats(threads);
+  std::atomic<int> next(0);
+
+  auto worker = [&](int thread) {
+    TRACE_THREAD("raycast worker");
+
+    PipelineStats& stats = threadStats[thread];
+    TexturingShader shader;
+    shader.setup(ctx, light);
+
+    for (int tile = next++; tile < tiles; tile = next++) {
+      int x0 = tile % tilesX * tileSize;
+      int y0 = tile / tilesX * tileSize;
+      int x1 = std::min(ctx.width, x0 + tileSize);
+      int y1 = std::min(ctx.height, y0 + tileSize);
+
+      for (int y = y0; y < y1; y += 2) {
+        for (int x = x0; x < x1; x += 2) {
+          // 2x2 pixels, lanes past the image edge repeat an inside pixel
+          RayPacket packet;
+          packet.active = 0;
+          int xs[4], ys[4];
+          Vec3f directions[4];
+
+          for (int lane = 0; lane < 4; lane++) {
+            int px = x + (lane & 1);
+            int py = y + (lane >> 1);
+            if (px < x1 && py < y1) packet.active |= 1 << lane;
+
+            xs[lane] = std::min(px, x1 - 1);
+            ys[lane] = std::min(py, y1 - 1);
+            directions[lane] = camera.direction(xs[lane], ys[lane]);
+            packet.set(lane, camera.eye, directions[lane]);
+          }
+
+          RayHit hits[4];
+          int hitMask = bvh.intersectPacket(packet, hits);
+          STATS_ADD(stats, cameraRays, __builtin_popcount(packet.active));
+
+          for (int lane = 0; lane < 4; lane++) {
+            if (!(hitMask & (1 << lane))) continue;
+            shadeHit(ctx, shader, bvh, camera, xs[lane], ys[lane],
+                     directions[lane], hits[lane], light, options, stats);
+          }
+        }
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int i = 1; i < threads; i++) workers.emplace_back(worker, i);
+  worker(0);
+  for (std::thread& t : workers) t.join();
+
+  for (const PipelineStats& stats : threadStats) ctx.stats += stats;
+}
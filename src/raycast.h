@@ -0,0 +1,29 @@
+#ifndef __RAYCAST_H__
+#define __RAYCAST_H__
+
+#include "batch.h"
+#include "bvh.h"
+#include "geometry.h"
+#include "gl.h"
+
+struct RaycastOptions {
+  int threads = 0;      // 0 = one per core
+  int tileSize = 32;    // pixels per side of the unit of work of a thread
+  bool shadows = false;  // a ray towards the light from every visible point
+  int occlusionRays = 0;  // ambient occlusion rays per pixel, 0 = off
+  float occlusionRadius = 0.3f;  // how far they look, object units
+};
+
+// renderView with rays instead of the rasterizer: the visible face of every
+// pixel comes from casting 2x2 pixel packets through bvh (built over
+// ctx.model) and it is shaded by the same TexturingShader, with barycentrics
+// taken the way the rasterizer takes them. The framebuffer and zbuffer end
+// up as renderView leaves them, raster coords and the same depths, so images
+// of the two compare pixel for pixel and can be mixed by depth. A sized
+// ctx.shadow still gets its shadow pass, ray shadows and occlusion darken on
+// top. One ray per pixel, ctx.samples and the shading rate are ignored.
+// Timed as STAGE_TRACE
+void raycastView(RenderContext& ctx, const Bvh& bvh, const CameraPose& pose,
+                 Vec3f light, const RaycastOptions& options);
+
+#endif  //__RAYCAST_H__
@@ -0,0 +1,177 @@
+#include "scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "geometry.h"
+#include "gl.h"
+#include "lod.h"
+#include "model.h"
+#include "shader.h"
+#include "trace.h"
+
+int Scene::addMesh(Model* model) {
+  for (int i = 0; i < (int)meshes.size(); i++) {
+    if (meshes[i].model == model) return i;
+  }
+
+  meshes.emplace_back();
+  meshes.back().model = model;
+  return meshes.size() - 1;
+}
+
+void Scene::addInstance(Model* model, const Matrix& transform) {
+  meshes[addMesh(model)].transforms.push_back(transform);
+}
+
+long Scene::instanceCount() const {
+  long count = 0;
+  for (const SceneMesh& mesh : meshes) count += mesh.transforms.size();
+  return count;
+}
+
+long Scene::triangleCount() const {
+  long count = 0;
+  for (const SceneMesh& mesh : meshes) {
+    count += (long)mesh.model->nfaces() * mesh.transforms.size();
+  }
+  return count;
+}
+
+float Scene::boundingRadius(Vec3f center) const {
+  float radius = 0.f;
+
+  for (const SceneMesh& mesh : meshes) {
+    const Vec3SoA& positions = mesh.model->positions();
+
+    float modelRadius = 0.f;
+    for (int i = 0; i < positions.size(); i++) {
+      modelRadius = std::max(modelRadius, positions[i].norm());
+    }
+
+    // a sphere around each instance origin, as big as its largest axis
+    for (const Matrix& transform : mesh.transforms) {
+      Vec3f origin(transform(0, 3), transform(1, 3), transform(2, 3));
+      float scale = 0.f;
+      for (int j = 0; j < 3; j++) {
+        Vec3f axis(transform(0, j), transform(1, j), transform(2, j));
+        scale = std::max(scale, axis.norm());
+      }
+
+      radius = std::max(radius, (origin - center).norm() + modelRadius * scale);
+    }
+  }
+
+  return radius;
+}
+
+Matrix instanceMatrix(Vec3f position, float yaw, float scale) {
+  float c = std::cos(yaw) * scale;
+  float s = std::sin(yaw) * scale;
+
+  Matrix result = Matrix::identity(4);
+  result(0, 0) = c;
+  result(0, 2) = s;
+  result(1, 1) = scale;
+  result(2, 0) = -s;
+  result(2, 2) = c;
+
+  for (int i = 0; i < 3; i++) result(i, 3) = position[i];
+  return result;
+}
+
+Scene crowdScene(Model* model, int count) {
+  Scene scene;
+  int side = std::max(1, (int)std::ceil(std::sqrt((float)count)));
+  float scale = 1.f / side;
+  float spacing = 2.f * scale;  // models are about 2 units across
+  float start = -(side - 1) * spacing / 2.f;
+
+  for (int i = 0; i < count; i++) {
+    Vec3f position(start + (i % side) * spacing, 0.f,
+                   start + (i / side) * spacing);
+    scene.addInstance(model, instanceMatrix(position, i * 0.4f, scale));
+  }
+
+  return scene;
+}
+
+// the instances of mesh drawn at level, in their order. Without lods they
+// are all at level 0
+static void instancesAtLevel(const RenderContext& ctx, const SceneMesh& mesh,
+                             int level, std::pmr::vector<Matrix>& out) {
+  out.clear();
+  for (const Matrix& transform : mesh.transforms) {
+    int selected = mesh.lods ? mesh.lods->select(ctx, transform,
+                                                 ctx.lodPixelError)
+                             : 0;
+    if (selected == level) out.push_back(transform);
+  }
+}
+
+static int levelCount(const SceneMesh& mesh) {
+  return mesh.lods ? mesh.lods->levelCount() : 1;
+}
+
+static Model* levelModel(const SceneMesh& mesh, int level) {
+  return mesh.lods ? mesh.lods->level(level) : mesh.model;
+}
+
+void renderScene(RenderContext& ctx, const Scene& scene,
+                 const CameraPose& pose, Vec3f light) {
+  TRACE_SCOPE("renderScene");
+
+  ctx.clear();
+  STATS_ONLY(long allocations = heapAllocationCount());
+
+  applyCamera(ctx, pose);
+
+  std::pmr::vector<Matrix> transforms(&ctx.arena);
+
+  if (ctx.shadow.size > 0) {
+    fitShadowMap(ctx, light, pose.center, scene.boundingRadius(pose.center));
+
+    for (const SceneMesh& mesh : scene.meshes) {
+      for (int level = 0; level < levelCount(mesh); level++) {
+        instancesAtLevel(ctx, mesh, level, transforms);
+        if (transforms.empty()) continue;
+        drawShadowCasters(ctx, *levelModel(mesh, level), transforms.data(),
+                          transforms.size());
+      }
+    }
+  }
+
+  Model* model = ctx.model;
+  const Bvh* bvh = ctx.bvh;
+  const Meshlets* meshlets = ctx.meshlets;
+
+  for (const SceneMesh& mesh : scene.meshes) {
+    for (int level = 0; level < levelCount(mesh); level++) {
+      instancesAtLevel(ctx, mesh, level, transforms);
+      if (transforms.empty()) continue;
+
+      // the bvh and the meshlets only know the faces of the full model
+      ctx.model = levelModel(mesh, level);
+      ctx.bvh = level == 0 ? mesh.bvh : nullptr;
+      ctx.meshlets = level == 0 ? mesh.meshlets : nullptr;
+      if (mesh.lods) STATS_ADD(ctx.stats, lodDraws[level], transforms.size());
+
+      // drawInstanced transforms the model for each instance
+      TexturingShader shader(&ctx.arena);
+      shader.bind(ctx, light);
+      ctx.shader = &shader;
+
+      drawInstanced(ctx, transforms.data(), transforms.size());
+
+      ctx.shader = nullptr;
+    }
+  }
+
+  ctx.model = model;
+  ctx.bvh = bvh;
+  ctx.meshlets = meshlets;
+  resolveSamples(ctx);
+
+  STATS_ADD(ctx.stats, heapAllocations, heapAllocationCount() - allocations);
+  STATS_ADD(ctx.stats, arenaBytes, ctx.arena.used());
+}
@@ -0,0 +1,49 @@
+#ifndef __SCENE_H__
+#define __SCENE_H__
+
+#include <vector>
+
+#include "batch.h"
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+
+// a loaded model and every place it is drawn at. An instance is only its
+// transform, faces, vertices and textures stay in the shared model
+struct SceneMesh {
+  Model* model = nullptr;
+  const Bvh* bvh = nullptr;            // of model, culls instances and faces
+  const LodChain* lods = nullptr;      // of model, each instance picks a level
+  const Meshlets* meshlets = nullptr;  // of model, culls instead of bvh
+  std::vector<Matrix> transforms;      // object to world, one per instance
+};
+
+struct Scene {
+  std::vector<SceneMesh> meshes;
+
+  // index of the mesh that draws model, added the first time
+  int addMesh(Model* model);
+  void addInstance(Model* model, const Matrix& transform);
+
+  long instanceCount() const;
+  long triangleCount() const;  // over all the instances
+
+  // distance from center that holds every instance
+  float boundingRadius(Vec3f center) const;
+};
+
+// scale, then a turn around y, then a move to position
+Matrix instanceMatrix(Vec3f position, float yaw, float scale = 1.f);
+
+// count copies of model on a square grid on the xz plane, scaled down so the
+// grid takes the room of one model around the origin (the projection has no
+// field of view to zoom out with), each copy turned a bit more than the last
+Scene crowdScene(Model* model, int count);
+
+// renderView for a scene: camera from pose, a shadow pass over every instance
+// when ctx.shadow has a size, then one drawInstanced per mesh, or per level
+// of detail of a mesh with lods
+void renderScene(RenderContext& ctx, const Scene& scene,
+                 const CameraPose& pose, Vec3f light);
+
+#endif  //__SCENE_H__
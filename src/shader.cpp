@@ -0,0 +1,171 @@
+#include "shader.h"
+
+#include <algorithm>
+
+#include "geometry.h"
+#include "gl.h"
+#include "meshlet.h"
+#include "model.h"
+#include "tgaimage.h"
+#include "trace.h"
+
+TexturingShader::TexturingShader(std::pmr::memory_resource* scratch)
+    : scratch(scratch),
+      clipVerts(scratch),
+      ndcVerts(scratch),
+      screenVerts(scratch),
+      eyeNormals(scratch),
+      shadowClip(scratch),
+      shadowVerts(scratch) {}
+
+void TexturingShader::bind(const RenderContext& ctx, Vec3f light) {
+  model = ctx.model;
+
+  uniform_camera = ctx.Projection * ctx.ModelView;
+  uniform_VP = ctx.ViewPort;
+  lightDirection = Vec4f(uniform_camera * Vec4f(light, 0.)).xyz();
+  shadow = ctx.shadow.size > 0 ? &ctx.shadow : nullptr;
+  meshlets = ctx.meshlets;
+}
+
+void TexturingShader::setup(const RenderContext& ctx, Vec3f light) {
+  TRACE_SCOPE("shader.setup");
+
+  bind(ctx, light);
+  setInstance(Matrix::identity(4));
+}
+
+void TexturingShader::setInstance(const Matrix& transform) {
+  TRACE_SCOPE("shader.setInstance");
+
+  uniform_MV = uniform_camera * transform;
+  uniform_MV.inverse(uniform_MVIT);
+  uniform_MVIT = uniform_MVIT.transpose();
+  if (shadow) {
+    shadowMatrix = shadow->Projection * shadow->ModelView * transform;
+  }
+
+  if (meshlets) {
+    // sized once, shadeMeshlets fills the parts that get drawn
+    int copies = meshlets->positions.size();
+    clipVerts.resize(copies);
+    ndcVerts.resize(copies);
+    screenVerts.resize(copies);
+    eyeNormals.resize(meshlets->normals.size());
+    if (shadow) {
+      shadowClip.resize(copies);
+      shadowVerts.resize(copies);
+    }
+    return;
+  }
+
+  transformBatch(uniform_MV, model->positions(), 1.f, clipVerts);
+  projectBatch(clipVerts, uniform_VP, screenVerts, &ndcVerts);
+  transformBatch(uniform_MVIT, model->normals(), 0.f, eyeNormals);
+
+  if (shadow) {
+    transformBatch(shadowMatrix, model->positions(), 1.f, shadowClip);
+    projectBatch(shadowClip, shadow->ViewPort, shadowVerts);
+  }
+}
+
+// meshlets per thread at the least, a few thousand vertices
+const int MESHLET_GRAIN = 32;
+
+void TexturingShader::shadeMeshlets(const Meshlets& meshlets,
+                                    const int* visible, int count,
+                                    int threads) {
+  parallelFor(count, MESHLET_GRAIN, threads, [&](int begin, int end) {
+    for (int i = begin; i < end; i++) {
+      const Meshlet& meshlet = meshlets.meshlets[visible[i]];
+      int first = meshlet.vertexOffset;
+      int last = first + meshlet.vertexCount;
+
+      transformRange(uniform_MV, meshlets.positions, 1.f, clipVerts, first,
+                     last);
+      projectRange(clipVerts, uniform_VP, screenVerts, &ndcVerts, first,
+                   last);
+      transformRange(uniform_MVIT, meshlets.normals, 0.f, eyeNormals,
+                     meshlet.normalOffset,
+                     meshlet.normalOffset + meshlet.normalCount);
+
+      if (shadow) {
+        transformRange(shadowMatrix, meshlets.positions, 1.f, shadowClip,
+                       first, last);
+        projectRange(shadowClip, shadow->ViewPort, shadowVerts, nullptr,
+                     first, last);
+      }
+    }
+  });
+}
+
+Vec3f TexturingShader::vertex(int face, int idVert) {
+  varying_uv.setColumn(
+      idVert, Vec4f(model->textCoord(model->texture(face)[idVert]), 0.));
+
+  // meshlets have their own copies of the vertices and normals of a face
+  int vertex, normal;
+  if (meshlets) {
+    vertex = meshlets->corners[face * 6 + idVert];
+    normal = meshlets->corners[face * 6 + 3 + idVert];
+  } else {
+    vertex = model->face(face)[idVert];
+    normal = model->vertexNomalsIds(face)[idVert];
+  }
+
+  varying_nrm.setColumn(idVert, eyeNormals[normal]);
+
+  if (shadow) varying_shadow[idVert] = shadowVerts[vertex];
+
+  varying_tri.setColumn(idVert, clipVerts[vertex]);
+  ndc_tri.setColumn(idVert, Vec4f(ndcVerts[vertex], 1.f));
+
+  return screenVerts[vertex];
+}
+
+bool TexturingShader::fragment(Vec4f bar, TGAColor& color) {
+  Vec4f normalBar = (varying_nrm * Matrix(bar));
+  Vec4f uvBar = varying_uv * Matrix(bar);
+
+  Matrix A = Matrix::identity(3);
+
+  A.setColumn(0, ndc_tri.getColumn(1) - ndc_tri.getColumn(0));
+  A.setColumn(1, ndc_tri.getColumn(2) - ndc_tri.getColumn(0));
+  A.setColumn(2, normalBar.normalize());
+  A = A.transpose();
+
+  Matrix AI(3, 3);
+  A.inverse(AI);
+
+  AI = AI.incrementDimenesion();
+
+  Vec4f i = AI * Matrix(Vec4f(varying_uv(0, 1) - varying_uv(0, 0),
+                              varying_uv(0, 2) - varying_uv(0, 0), 0., 0.));
+
+  Vec4f j = AI * Matrix(Vec4f(varying_uv(1, 1) - varying_uv(1, 0),
+                              varying_uv(1, 2) - varying_uv(1, 0), 0., 0.));
+
+  Matrix BTN = Matrix(4, 4);
+
+  BTN.setColumn(0, i.normalize());
+  BTN.setColumn(1, j.normalize());
+  BTN.setColumn(2, normalBar);
+
+  Vec3f normalMapped =
+      (BTN * (Vec4f(model->getNormal(uvBar.xy()), 0)).normalize())
+          .getColumn(0)
+          .xyz();
+
+  float lightIntensity = std::max((normalMapped * lightDirection), 0.f);
+
+  if (shadow) {
+    Vec3f point = varying_shadow[0] * bar.x + varying_shadow[1] * bar.y +
+                  varying_shadow[2] * bar.z;
+    lightIntensity *=
+        SHADOW_AMBIENT + (1.f - SHADOW_AMBIENT) * shadow->lit(point);
+  }
+
+  color = model->getDiffuse(uvBar.xy()) * lightIntensity;
+
+  return false;
+}
@@ -0,0 +1,70 @@
+#ifndef __SHADER_H__
+#define __SHADER_H__
+
+#include "geometry.h"
+#include "gl.h"
+#include "model.h"
+#include "tgaimage.h"
+
+// light left in the shadows, TexturingShader has no ambient term otherwise
+const float SHADOW_AMBIENT = 0.3f;
+
+struct TexturingShader : public IShader {
+  Model* model = nullptr;
+  Vec3f lightDirection = Vec3f(1., 1., 1.);  // light in eye space
+
+  Matrix varying_uv = Matrix(4, 4);   // uv coords
+  Matrix varying_tri = Matrix(4, 4);  // triangle ModelView
+  Matrix varying_nrm = Matrix(4, 4);  // normal per vertex
+  Matrix ndc_tri = Matrix(4, 4);      // triangle in device coordenates
+
+  Matrix uniform_camera = Matrix(4, 4);  // Projection * ModelView
+  Matrix uniform_MV = Matrix(4, 4);    // Model view matrix
+  Matrix uniform_MVIT = Matrix(4, 4);  // ModelView inverse traspose
+  Matrix uniform_VP = Matrix(4, 4);    // ViewPort
+
+  std::pmr::memory_resource* scratch;  // per-frame arrays below
+
+  // every model vertex and normal transformed at once by setup
+  Vec4SoA clipVerts;    // uniform_MV * vertex
+  Vec3SoA ndcVerts;     // clipVerts after the perspective divide
+  Vec3SoA screenVerts;  // clipVerts through the viewport
+  Vec4SoA eyeNormals;   // uniform_MVIT * normal
+
+  // the context ones. The arrays above then hold the vertex and normal
+  // copies of the meshlets instead of the model ones, each meshlet shaded by
+  // shadeMeshlets when it is visible
+  const Meshlets* meshlets = nullptr;
+
+  const ShadowMap* shadow = nullptr;   // the context one when it has a size
+  Matrix shadowMatrix = Matrix(4, 4);  // instance to light clip space
+  Vec4SoA shadowClip;                  // light clip space, scratch
+  Vec3SoA shadowVerts;                 // vertices in the shadow map
+  Vec3f varying_shadow[3];             // triangle in the shadow map
+
+  // scratch is where the transformed model goes, the context arena keeps
+  // frames free of heap allocations
+  TexturingShader(std::pmr::memory_resource* scratch =
+                      std::pmr::get_default_resource());
+
+  // takes the uniforms, the model and the shadow map from the context,
+  // nothing is transformed until setInstance
+  void bind(const RenderContext& ctx, Vec3f light);
+
+  // bind, then the whole model transformed as it is
+  void setup(const RenderContext& ctx, Vec3f light);
+
+  // transforms the whole model again for an instance, into the same arrays.
+  // With meshlets only the uniforms change
+  virtual void setInstance(const Matrix& transform) override;
+
+  // transforms the copies of every visible meshlet, split over threads
+  virtual void shadeMeshlets(const Meshlets& meshlets, const int* visible,
+                             int count, int threads) override;
+
+  virtual Vec3f vertex(int face, int idVert) override;
+
+  virtual bool fragment(Vec4f bar, TGAColor& color) override;
+};
+
+#endif  //__SHADER_H__
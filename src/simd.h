@@ -0,0 +1,193 @@
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+// 4 float lanes on SSE or NEON, plain floats elsewhere. Lane order is
+// x y z w. Everything is lane wise IEEE math in the same order as the scalar
+// code so results do not depend on the build, except rsqrtFast
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define TINYRENDERER_SIMD_SSE 1
+#include <emmintrin.h>
+typedef __m128 float4;
+#elif defined(__ARM_NEON)
+#define TINYRENDERER_SIMD_NEON 1
+#include <arm_neon.h>
+typedef float32x4_t float4;
+#else
+struct float4 {
+  float lane[4];
+};
+#endif
+
+#include <cmath>
+
+#if defined(TINYRENDERER_SIMD_SSE)
+
+inline float4 f4set(float x, float y, float z, float w) {
+  return _mm_set_ps(w, z, y, x);
+}
+inline float4 f4splat(float f) { return _mm_set1_ps(f); }
+inline float4 f4add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 f4sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 f4mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 f4min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+inline float4 f4max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+inline float4 f4div(float4 a, float4 b) { return _mm_div_ps(a, b); }
+
+inline float4 f4load(const float* p) { return _mm_loadu_ps(p); }
+inline void f4store(float* p, float4 a) { _mm_storeu_ps(p, a); }
+
+// bit i set where lane i of a < b (<= b), false for NaN
+inline int f4lessMask(float4 a, float4 b) {
+  return _mm_movemask_ps(_mm_cmplt_ps(a, b));
+}
+inline int f4lessEqualMask(float4 a, float4 b) {
+  return _mm_movemask_ps(_mm_cmple_ps(a, b));
+}
+
+// x + y + z of a, added left to right
+inline float f4sum3(float4 a) {
+  __m128 sum = _mm_add_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)));
+  return _mm_cvtss_f32(sum);
+}
+
+inline float f4sum4(float4 a) {
+  __m128 sum = _mm_add_ss(_mm_set_ss(f4sum3(a)),
+                          _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)));
+  return _mm_cvtss_f32(sum);
+}
+
+// xyz cross product, w is 0 when both w are 0
+inline float4 f4cross3(float4 a, float4 b) {
+  __m128 ayzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 azxy = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+  __m128 byzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 bzxy = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+  return _mm_sub_ps(_mm_mul_ps(ayzx, bzxy), _mm_mul_ps(azxy, byzx));
+}
+
+// 1 / sqrt(f) from the hardware estimate and one newton step, ~1e-6 relative
+inline float rsqrtFast(float f) {
+  __m128 v = _mm_set_ss(f);
+  __m128 r = _mm_rsqrt_ss(v);
+  __m128 half = _mm_mul_ss(v, _mm_set_ss(0.5f));
+  __m128 rr = _mm_mul_ss(r, r);
+  r = _mm_mul_ss(r, _mm_sub_ss(_mm_set_ss(1.5f), _mm_mul_ss(half, rr)));
+  return _mm_cvtss_f32(r);
+}
+
+#elif defined(TINYRENDERER_SIMD_NEON)
+
+inline float4 f4set(float x, float y, float z, float w) {
+  float lanes[4] = {x, y, z, w};
+  return vld1q_f32(lanes);
+}
+inline float4 f4splat(float f) { return vdupq_n_f32(f); }
+inline float4 f4add(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 f4sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+inline float4 f4mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+inline float4 f4min(float4 a, float4 b) { return vminq_f32(a, b); }
+inline float4 f4max(float4 a, float4 b) { return vmaxq_f32(a, b); }
+inline float4 f4div(float4 a, float4 b) { return vdivq_f32(a, b); }
+
+inline float4 f4load(const float* p) { return vld1q_f32(p); }
+inline void f4store(float* p, float4 a) { vst1q_f32(p, a); }
+
+inline int f4maskBits(uint32x4_t mask) {
+  const uint32_t bits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(mask, vld1q_u32(bits)));
+}
+inline int f4lessMask(float4 a, float4 b) {
+  return f4maskBits(vcltq_f32(a, b));
+}
+inline int f4lessEqualMask(float4 a, float4 b) {
+  return f4maskBits(vcleq_f32(a, b));
+}
+
+inline float f4sum3(float4 a) {
+  return vgetq_lane_f32(a, 0) + vgetq_lane_f32(a, 1) + vgetq_lane_f32(a, 2);
+}
+
+inline float f4sum4(float4 a) { return f4sum3(a) + vgetq_lane_f32(a, 3); }
+
+// y z x and z x y of a, the last lane is garbage
+inline float4 f4yzx(float4 a) {
+  return vsetq_lane_f32(vgetq_lane_f32(a, 0), vextq_f32(a, a, 1), 2);
+}
+inline float4 f4zxy(float4 a) {
+  float4 r = vextq_f32(a, a, 2);
+  r = vsetq_lane_f32(vgetq_lane_f32(a, 0), r, 1);
+  return vsetq_lane_f32(vgetq_lane_f32(a, 1), r, 2);
+}
+
+inline float4 f4cross3(float4 a, float4 b) {
+  float4 r = vsubq_f32(vmulq_f32(f4yzx(a), f4zxy(b)),
+                       vmulq_f32(f4zxy(a), f4yzx(b)));
+  return vsetq_lane_f32(0.f, r, 3);
+}
+
+inline float rsqrtFast(float f) {
+  float32x2_t v = vdup_n_f32(f);
+  float32x2_t r = vrsqrte_f32(v);
+  r = vmul_f32(r, vrsqrts_f32(vmul_f32(v, r), r));
+  return vget_lane_f32(r, 0);
+}
+
+#else
+
+inline float4 f4set(float x, float y, float z, float w) {
+  return float4{{x, y, z, w}};
+}
+inline float4 f4splat(float f) { return float4{{f, f, f, f}}; }
+
+#define TINYRENDERER_F4_LANEWISE(name, expression)             \
+  inline float4 name(float4 a, float4 b) {                     \
+    float4 r;                                                  \
+    for (int i = 0; i < 4; i++) {                              \
+      float x = a.lane[i], y = b.lane[i];                      \
+      r.lane[i] = expression;                                  \
+    }                                                          \
+    return r;                                                  \
+  }
+TINYRENDERER_F4_LANEWISE(f4add, x + y)
+TINYRENDERER_F4_LANEWISE(f4sub, x - y)
+TINYRENDERER_F4_LANEWISE(f4mul, x * y)
+TINYRENDERER_F4_LANEWISE(f4min, x < y ? x : y)
+TINYRENDERER_F4_LANEWISE(f4max, x > y ? x : y)
+TINYRENDERER_F4_LANEWISE(f4div, x / y)
+#undef TINYRENDERER_F4_LANEWISE
+
+inline float4 f4load(const float* p) {
+  return float4{{p[0], p[1], p[2], p[3]}};
+}
+inline void f4store(float* p, float4 a) {
+  for (int i = 0; i < 4; i++) p[i] = a.lane[i];
+}
+
+inline int f4lessMask(float4 a, float4 b) {
+  int mask = 0;
+  for (int i = 0; i < 4; i++) mask |= (a.lane[i] < b.lane[i]) << i;
+  return mask;
+}
+inline int f4lessEqualMask(float4 a, float4 b) {
+  int mask = 0;
+  for (int i = 0; i < 4; i++) mask |= (a.lane[i] <= b.lane[i]) << i;
+  return mask;
+}
+
+inline float f4sum3(float4 a) { return a.lane[0] + a.lane[1] + a.lane[2]; }
+inline float f4sum4(float4 a) { return f4sum3(a) + a.lane[3]; }
+
+inline float4 f4cross3(float4 a, float4 b) {
+  const float* u = a.lane;
+  const float* v = b.lane;
+  return f4set(u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2],
+               u[0] * v[1] - u[1] * v[0], 0.f);
+}
+
+inline float rsqrtFast(float f) { return 1.f / std::sqrt(f); }
+
+#endif
+
+#endif  //__SIMD_H__
@@ -0,0 +1,184 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ostream>
+
+#include "cpu.h"
+
+// bumped by the counting operator new of countingallocator.h, the library
+// itself leaves the allocator of its host alone
+static thread_local long allocations = 0;
+
+void countHeapAllocation() { allocations++; }
+
+long heapAllocationCount() { return allocations; }
+
+const char* stageName(PipelineStage stage) {
+  switch (stage) {
+    case STAGE_SHADOW:
+      return "shadow";
+    case STAGE_VERTEX:
+      return "vertex";
+    case STAGE_SETUP:
+      return "setup";
+    case STAGE_RASTER:
+      return "raster";
+    case STAGE_SHADE:
+      return "shade";
+    case STAGE_RESOLVE:
+      return "resolve";
+    case STAGE_PAGE_IN:
+      return "paging";
+    case STAGE_TRACE:
+      return "trace";
+    case STAGE_PRESENT:
+      return "present";
+    default:
+      return "?";
+  }
+}
+
+double PipelineStats::overdraw(long coveredPixels) const {
+  return coveredPixels > 0 ? (double)depthPasses / coveredPixels : 0.;
+}
+
+double PipelineStats::totalMilliseconds() const {
+  double total = 0.;
+  for (int i = 0; i < STAGE_COUNT; i++) total += stageMilliseconds[i];
+  return total;
+}
+
+PipelineStats& PipelineStats::operator+=(const PipelineStats& other) {
+  instancesDrawn += other.instancesDrawn;
+  instancesCulled += other.instancesCulled;
+  facesCulled += other.facesCulled;
+  meshletsDrawn += other.meshletsDrawn;
+  meshletsCulled += other.meshletsCulled;
+  trianglesSubmitted += other.trianglesSubmitted;
+  trianglesCulled += other.trianglesCulled;
+  trianglesRasterized += other.trianglesRasterized;
+  pixelsTested += other.pixelsTested;
+  depthPasses += other.depthPasses;
+  fragmentsShaded += other.fragmentsShaded;
+  fragmentDiscards += other.fragmentDiscards;
+  fragmentsReused += other.fragmentsReused;
+  shadowTriangles += other.shadowTriangles;
+  shadowDepthWrites += other.shadowDepthWrites;
+  samplesCovered += other.samplesCovered;
+  cameraRays += other.cameraRays;
+  secondaryRays += other.secondaryRays;
+  for (int i = 0; i < LOD_LEVELS; i++) lodDraws[i] += other.lodDraws[i];
+  chunksPagedIn += other.chunksPagedIn;
+  pageInBytes += other.pageInBytes;
+  residentBytes = std::max(residentBytes, other.residentBytes);
+  heldBytes = std::max(heldBytes, other.heldBytes);
+  heapAllocations += other.heapAllocations;
+  arenaBytes = std::max(arenaBytes, other.arenaBytes);
+
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    stageMilliseconds[i] += other.stageMilliseconds[i];
+  }
+
+  return *this;
+}
+
+void PipelineStats::print(std::ostream& out, long coveredPixels) const {
+#if TINYRENDERER_STATS
+  char line[256];
+  snprintf(line, sizeof(line),
+           "tris %ld submitted %ld culled %ld rasterized | pixels %ld tested "
+           "%ld depth passes %ld shaded %ld discarded | overdraw %.2f\n",
+           trianglesSubmitted, trianglesCulled, trianglesRasterized,
+           pixelsTested, depthPasses, fragmentsShaded, fragmentDiscards,
+           overdraw(coveredPixels));
+  out << line;
+
+  out << "ms";
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    snprintf(line, sizeof(line), " %s %.2f", stageName((PipelineStage)i),
+             stageMilliseconds[i]);
+    out << line;
+  }
+  snprintf(line, sizeof(line), " | total %.2f | %s kernels\n",
+           totalMilliseconds(), cpuPathName(activeCpuPath()));
+  out << line;
+
+  if (instancesDrawn) {
+    snprintf(line, sizeof(line), "instances %ld drawn, %.0f tris each\n",
+             instancesDrawn, (double)trianglesSubmitted / instancesDrawn);
+    out << line;
+  }
+
+  if (facesCulled) {
+    snprintf(line, sizeof(line),
+             "cull %ld faces %ld instances before the vertex stage\n",
+             facesCulled, instancesCulled);
+    out << line;
+  }
+
+  if (meshletsDrawn || meshletsCulled) {
+    snprintf(line, sizeof(line), "meshlets %ld drawn %ld culled\n",
+             meshletsDrawn, meshletsCulled);
+    out << line;
+  }
+
+  if (shadowTriangles) {
+    snprintf(line, sizeof(line), "shadow %ld tris %ld depth writes\n",
+             shadowTriangles, shadowDepthWrites);
+    out << line;
+  }
+
+  if (fragmentsReused) {
+    snprintf(line, sizeof(line),
+             "rate %ld shaded %ld reused, %.1f%% of the fragments shaded\n",
+             fragmentsShaded, fragmentsReused,
+             100. * fragmentsShaded / (fragmentsShaded + fragmentsReused));
+    out << line;
+  }
+
+  if (samplesCovered) {
+    snprintf(line, sizeof(line),
+             "msaa %ld samples covered, %.2f per shaded fragment\n",
+             samplesCovered,
+             fragmentsShaded ? (double)samplesCovered / fragmentsShaded : 0.);
+    out << line;
+  }
+
+  if (std::any_of(lodDraws, lodDraws + LOD_LEVELS,
+                  [](long draws) { return draws > 0; })) {
+    out << "lod draws per level";
+    for (int i = 0; i < LOD_LEVELS; i++) out << " " << lodDraws[i];
+    out << "\n";
+  }
+
+  if (cameraRays) {
+    double milliseconds = stageMilliseconds[STAGE_TRACE];
+    snprintf(line, sizeof(line),
+             "rays %ld camera %ld secondary, %.2f Mrays/s\n", cameraRays,
+             secondaryRays,
+             milliseconds > 0.
+                 ? (cameraRays + secondaryRays) / (milliseconds * 1e3)
+                 : 0.);
+    out << line;
+  }
+
+  if (chunksPagedIn || residentBytes) {
+    double milliseconds = stageMilliseconds[STAGE_PAGE_IN];
+    snprintf(line, sizeof(line),
+             "paging %ld chunks in, %.1f MB at %.1f MB/s | %.1f MB "
+             "resident %.1f MB held\n",
+             chunksPagedIn, pageInBytes / 1048576.,
+             milliseconds > 0. ? pageInBytes / 1048.576 / milliseconds : 0.,
+             residentBytes / 1048576., heldBytes / 1048576.);
+    out << line;
+  }
+
+  snprintf(line, sizeof(line), "memory %ld heap allocations | arena %.1f KB\n",
+           heapAllocations, arenaBytes / 1024.);
+  out << line;
+#else
+  (void)out;
+  (void)coveredPixels;
+#endif
+}
@@ -0,0 +1,106 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <chrono>
+#include <ostream>
+
+// the counters are cheap enough to stay on, build with TINYRENDERER_STATS=0
+// to compile every STATS_ macro away
+#ifndef TINYRENDERER_STATS
+#define TINYRENDERER_STATS 1
+#endif
+
+const int LOD_LEVELS = 6;  // most levels of detail a model gets
+
+enum PipelineStage {
+  STAGE_SHADOW,  // light space depth pass
+  STAGE_VERTEX,
+  STAGE_SETUP,
+  STAGE_RASTER,
+  STAGE_SHADE,
+  STAGE_RESOLVE,  // multisample buffers into the framebuffer
+  STAGE_TRACE,    // ray casting, wall time of the tiles with their shading
+  STAGE_PAGE_IN,  // chunks of a paged model read from disk
+  STAGE_PRESENT,
+  STAGE_COUNT
+};
+
+const char* stageName(PipelineStage stage);
+
+struct PipelineStats {
+  long instancesDrawn = 0;   // by drawInstanced
+  long instancesCulled = 0;  // entirely off screen
+  long facesCulled = 0;      // by the bvh or meshlets, before vertex shading
+  long meshletsDrawn = 0;
+  long meshletsCulled = 0;   // off screen or facing away
+  long trianglesSubmitted = 0;
+  long trianglesCulled = 0;  // degenerate or outside the viewport
+  long trianglesRasterized = 0;
+  long pixelsTested = 0;  // inside the triangle bounding boxes
+  long depthPasses = 0;
+  long fragmentsShaded = 0;
+  long fragmentDiscards = 0;  // shader.fragment returned true
+  long fragmentsReused = 0;   // colored by a coarse shading block
+  long shadowTriangles = 0;    // rasterized into the shadow map
+  long shadowDepthWrites = 0;
+  long samplesCovered = 0;     // msaa samples that passed the depth test
+  long cameraRays = 0;         // one per pixel with the ray caster
+  long secondaryRays = 0;      // shadow and ambient occlusion rays
+  long lodDraws[LOD_LEVELS] = {};  // models and instances drawn per level
+  long chunksPagedIn = 0;     // of a paged model
+  long pageInBytes = 0;
+  long residentBytes = 0;     // paged chunks in memory at the end of a frame
+  long heldBytes = 0;         // the same with evicted ones still held
+  long heapAllocations = 0;   // operator new calls while rendering
+  long arenaBytes = 0;        // frame arena in use at the end of the frame
+
+  double stageMilliseconds[STAGE_COUNT] = {};
+
+  void reset() { *this = PipelineStats(); }
+
+  // fragments that passed the depth test per covered pixel
+  double overdraw(long coveredPixels) const;
+  double totalMilliseconds() const;
+
+  PipelineStats& operator+=(const PipelineStats& other);
+
+  void print(std::ostream& out, long coveredPixels) const;
+};
+
+// operator new calls made by this thread so far. They are only counted in
+// programs that include countingallocator.h, 0 everywhere else
+long heapAllocationCount();
+void countHeapAllocation();
+
+// adds its lifetime to one stage
+class StageTimer {
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  PipelineStats& stats;
+  PipelineStage stage;
+  Clock::time_point start;
+
+ public:
+  StageTimer(PipelineStats& stats, PipelineStage stage)
+      : stats(stats), stage(stage), start(Clock::now()) {}
+
+  ~StageTimer() {
+    stats.stageMilliseconds[stage] +=
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+  }
+};
+
+// STATS_ONLY keeps a statement, such as a local only the counters read
+#if TINYRENDERER_STATS
+#define STATS_ADD(stats, counter, n) ((stats).counter += (n))
+#define STATS_TIMER(stats, stage) StageTimer stageTimer_##stage((stats), stage)
+#define STATS_ONLY(...) __VA_ARGS__
+#else
+#define STATS_ADD(stats, counter, n) ((void)0)
+#define STATS_TIMER(stats, stage) ((void)0)
+#define STATS_ONLY(...)
+#endif
+
+#endif  //__STATS_H__
@@ -0,0 +1,156 @@
+#include "texturecache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <streambuf>
+#include <vector>
+
+#include "trace.h"
+
+// fnv-1a, 64 bits
+static uint64_t hashBytes(const std::vector<char>& bytes) {
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : bytes) {
+    hash ^= (unsigned char)c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// reads bytes in place, so a file read once is hashed and decoded from the
+// same buffer
+struct BytesBuffer : std::streambuf {
+  explicit BytesBuffer(std::vector<char>& bytes) {
+    setg(bytes.data(), bytes.data(), bytes.data() + bytes.size());
+  }
+};
+
+void TextureCacheStats::print(std::ostream& out) const {
+  char line[160];
+  snprintf(line, sizeof(line),
+           "textures %ld decoded %ld hits (%ld by content) %ld evicted | "
+           "%ld held, %.1f MB\n",
+           misses, hits, contentHits, evictions, textures, bytes / 1048576.);
+  out << line;
+}
+
+TextureCache::TextureCache(size_t budget) : budget_(budget) {}
+
+TextureCache& TextureCache::global() {
+  static TextureCache cache;
+  return cache;
+}
+
+std::shared_ptr<TGAImage> TextureCache::hit(Entry& entry) {
+  entry.lastUse = ++useClock_;
+  stats_.hits++;
+  return entry.image;
+}
+
+std::shared_ptr<TGAImage> TextureCache::load(const std::string& path,
+                                             bool* decoded) {
+  TRACE_SCOPE("TextureCache::load");
+
+  if (decoded) *decoded = false;
+  std::error_code error;
+  int64_t size = std::filesystem::file_size(path, error);
+  if (error) return nullptr;
+  int64_t time =
+      std::filesystem::last_write_time(path, error).time_since_epoch().count();
+
+  // a path seen before and unchanged since
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto known = paths_.find(path);
+    if (known != paths_.end() && known->second.content.size == size &&
+        known->second.time == time) {
+      auto found = textures_.find(known->second.content);
+      if (found != textures_.end()) return hit(found->second);
+    }
+  }
+
+  std::vector<char> bytes(size);
+  std::ifstream in(path, std::ios::binary);
+  if (!in.read(bytes.data(), size)) return nullptr;
+  Content content{hashBytes(bytes), size};
+
+  // the same bytes under another path
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    paths_[path] = PathEntry{time, content};
+    auto found = textures_.find(content);
+    if (found != textures_.end()) {
+      stats_.contentHits++;
+      return hit(found->second);
+    }
+  }
+
+  std::shared_ptr<TGAImage> image = std::make_shared<TGAImage>();
+  BytesBuffer buffer(bytes);
+  std::istream tga(&buffer);
+  if (!image->read_tga(tga)) return nullptr;
+  image->flip_vertically();
+
+  // another thread may have decoded the same bytes meanwhile
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = textures_.find(content);
+  if (found != textures_.end()) {
+    stats_.contentHits++;
+    return hit(found->second);
+  }
+  stats_.misses++;
+  if (decoded) *decoded = true;
+
+  Entry& entry = textures_[content];
+  entry.image = image;
+  entry.bytes = (size_t)image->get_width() * image->get_height() *
+                image->get_bytespp();
+  entry.lastUse = ++useClock_;
+  stats_.bytes += entry.bytes;
+  stats_.textures++;
+
+  evictTo(budget_);
+  return image;
+}
+
+void TextureCache::evictTo(size_t bytes) {
+  while (stats_.bytes > bytes) {
+    auto oldest = textures_.end();
+    for (auto it = textures_.begin(); it != textures_.end(); ++it) {
+      if (it->second.image.use_count() > 1) continue;  // a model holds it
+      if (oldest == textures_.end() ||
+          it->second.lastUse < oldest->second.lastUse) {
+        oldest = it;
+      }
+    }
+    if (oldest == textures_.end()) return;
+
+    stats_.bytes -= oldest->second.bytes;
+    stats_.textures--;
+    stats_.evictions++;
+    textures_.erase(oldest);
+  }
+}
+
+size_t TextureCache::budget() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_;
+}
+
+void TextureCache::setBudget(size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = bytes;
+  evictTo(budget_);
+}
+
+void TextureCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  evictTo(0);
+}
+
+TextureCacheStats TextureCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
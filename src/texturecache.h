@@ -0,0 +1,86 @@
+#ifndef __TEXTURECACHE_H__
+#define __TEXTURECACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "tgaimage.h"
+
+struct TextureCacheStats {
+  long hits = 0;         // served without decoding, by path or by content
+  long contentHits = 0;  // of them, a new path with the bytes of a known one
+  long misses = 0;       // decoded
+  long evictions = 0;
+  long textures = 0;     // held now
+  size_t bytes = 0;      // decoded texels held now
+
+  void print(std::ostream& out) const;
+};
+
+// decoded textures shared by every model of the process. A file is known by
+// its path, size and write time, and its texture by a hash of its bytes and
+// their count, so a path that changed gets decoded again and two paths with
+// the same bytes share one texture. Files are read and decoded outside the
+// lock. Textures are handed out as shared pointers and never change after
+// loading. Above the memory budget the least recently used ones no model
+// holds any more are dropped; the ones still in use stay
+class TextureCache {
+ private:
+  struct Entry {
+    std::shared_ptr<TGAImage> image;
+    size_t bytes = 0;
+    long lastUse = 0;
+  };
+
+  // a hash of the bytes and their count
+  struct Content {
+    uint64_t hash = 0;
+    int64_t size = 0;
+    bool operator==(const Content& other) const {
+      return hash == other.hash && size == other.size;
+    }
+  };
+  struct ContentHash {
+    size_t operator()(const Content& content) const {
+      return content.hash;
+    }
+  };
+
+  struct PathEntry {
+    int64_t time = 0;
+    Content content;
+  };
+
+  std::unordered_map<Content, Entry, ContentHash> textures_;
+  std::unordered_map<std::string, PathEntry> paths_;
+  size_t budget_;
+  long useClock_ = 0;
+  TextureCacheStats stats_;
+  mutable std::mutex mutex_;
+
+  void evictTo(size_t bytes);
+  std::shared_ptr<TGAImage> hit(Entry& entry);
+
+ public:
+  explicit TextureCache(size_t budget = 256u << 20);
+
+  // the one Model uses
+  static TextureCache& global();
+
+  // the tga at path decoded and flipped vertically, or nullptr when it
+  // can't be read. decoded tells a miss from a hit
+  std::shared_ptr<TGAImage> load(const std::string& path,
+                                 bool* decoded = nullptr);
+
+  size_t budget() const;
+  void setBudget(size_t bytes);  // evicts down to it what it can
+  void clear();                  // drops the ones no model holds
+  TextureCacheStats stats() const;
+};
+
+#endif  //__TEXTURECACHE_H__
@@ -8,6 +8,9 @@
 
 #include <fstream>
 #include <iostream>
+#include <utility>
+
+#include "trace.h"
 
 TGAImage::TGAImage() : data(NULL), width(0), height(0), bytespp(0) {}
 
@@ -42,20 +45,33 @@ TGAImage &TGAImage::operator=(const TGAImage &img) {
   return *this;
 }
 
+void TGAImage::swap(TGAImage &img) {
+  std::swap(data, img.data);
+  std::swap(width, img.width);
+  std::swap(height, img.height);
+  std::swap(bytespp, img.bytespp);
+}
+
 bool TGAImage::read_tga_file(const char *filename) {
-  if (data) delete[] data;
-  data = NULL;
+  TRACE_SCOPE("TGAImage::read_tga_file");
+
   std::ifstream in;
   in.open(filename, std::ios::binary);
   if (!in.is_open()) {
+    if (data) delete[] data;
+    data = NULL;
     std::cerr << "can't open file " << filename << "\n";
-    in.close();
     return false;
   }
+  return read_tga(in);
+}
+
+bool TGAImage::read_tga(std::istream &in) {
+  if (data) delete[] data;
+  data = NULL;
   TGA_Header header;
   in.read((char *)&header, sizeof(header));
   if (!in.good()) {
-    in.close();
     std::cerr << "an error occured while reading the header\n";
     return false;
   }
@@ -64,7 +80,6 @@ bool TGAImage::read_tga_file(const char *filename) {
   bytespp = header.bitsperpixel >> 3;
   if (width <= 0 || height <= 0 ||
       (bytespp != GRAYSCALE && bytespp != RGB && bytespp != RGBA)) {
-    in.close();
     std::cerr << "bad bpp (or width/height) value\n";
     return false;
   }
@@ -73,18 +88,15 @@ bool TGAImage::read_tga_file(const char *filename) {
   if (3 == header.datatypecode || 2 == header.datatypecode) {
     in.read((char *)data, nbytes);
     if (!in.good()) {
-      in.close();
       std::cerr << "an error occured while reading the data\n";
       return false;
     }
   } else if (10 == header.datatypecode || 11 == header.datatypecode) {
     if (!load_rle_data(in)) {
-      in.close();
       std::cerr << "an error occured while reading the data\n";
       return false;
     }
   } else {
-    in.close();
     std::cerr << "unknown file format " << (int)header.datatypecode << "\n";
     return false;
   }
@@ -95,11 +107,10 @@ bool TGAImage::read_tga_file(const char *filename) {
     flip_horizontally();
   }
   std::cerr << width << "x" << height << "/" << bytespp * 8 << "\n";
-  in.close();
   return true;
 }
 
-bool TGAImage::load_rle_data(std::ifstream &in) {
+bool TGAImage::load_rle_data(std::istream &in) {
   unsigned long pixelcount = width * height;
   unsigned long currentpixel = 0;
   unsigned long currentbyte = 0;
@@ -149,6 +160,8 @@ bool TGAImage::load_rle_data(std::ifstream &in) {
 }
 
 bool TGAImage::write_tga_file(const char *filename, bool rle) {
+  TRACE_SCOPE("TGAImage::write_tga_file");
+
   unsigned char developer_area_ref[4] = {0, 0, 0, 0};
   unsigned char extension_area_ref[4] = {0, 0, 0, 0};
   unsigned char footer[18] = {'T', 'R', 'U', 'E', 'V', 'I', 'S', 'I', 'O',
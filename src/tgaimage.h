@@ -69,7 +69,7 @@ class TGAImage {
   int height;
   int bytespp;
 
-  bool load_rle_data(std::ifstream &in);
+  bool load_rle_data(std::istream &in);
   bool unload_rle_data(std::ofstream &out);
 
  public:
@@ -79,6 +79,7 @@ class TGAImage {
   TGAImage(int w, int h, int bpp);
   TGAImage(const TGAImage &img);
   bool read_tga_file(const char *filename);
+  bool read_tga(std::istream &in);  // a whole tga file from in
   bool write_tga_file(const char *filename, bool rle = true);
   bool flip_horizontally();
   bool flip_vertically();
@@ -88,6 +89,7 @@ class TGAImage {
   bool set(int x, int y, const TGAColor &c);
   ~TGAImage();
   TGAImage &operator=(const TGAImage &img);
+  void swap(TGAImage &img);  // exchanges the pixels without copying them
   int get_width();
   int get_height();
   int get_bytespp();
@@ -0,0 +1,161 @@
+#include "trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceEvent {
+  const char* name;
+  long long begin;
+  long long end;
+};
+
+// every thread appends to its own buffer, the lock is only contended while
+// stop() writes the file
+struct ThreadTrace {
+  int id;
+  std::string name;
+  std::mutex mutex;
+  std::vector<TraceEvent> events;
+};
+
+std::atomic<bool> Tracer::active(false);
+
+static std::mutex tracesMutex;
+static std::vector<std::unique_ptr<ThreadTrace> > traces;
+static std::string tracePath;
+static const std::chrono::steady_clock::time_point traceEpoch =
+    std::chrono::steady_clock::now();
+
+static ThreadTrace& threadTrace() {
+  thread_local ThreadTrace* trace = nullptr;
+
+  if (!trace) {
+    std::lock_guard<std::mutex> lock(tracesMutex);
+    traces.emplace_back(new ThreadTrace());
+    trace = traces.back().get();
+    trace->id = traces.size();
+  }
+
+  return *trace;
+}
+
+// text as a json string, quotes, backslashes and control characters escaped
+static void writeJsonString(FILE* file, const char* text) {
+  fputc('"', file);
+  for (const char* c = text; *c; c++) {
+    unsigned char u = (unsigned char)*c;
+    if (u == '"' || u == '\\') {
+      fputc('\\', file);
+      fputc(u, file);
+    } else if (u < 0x20) {
+      fprintf(file, "\\u%04x", u);
+    } else {
+      fputc(u, file);
+    }
+  }
+  fputc('"', file);
+}
+
+bool Tracer::start(const char* path) {
+  std::lock_guard<std::mutex> lock(tracesMutex);
+
+  if (active) return false;
+
+  FILE* file = fopen(path, "w");  // fail now rather than at exit
+  if (!file) {
+    fprintf(stderr, "can't open trace file %s\n", path);
+    return false;
+  }
+  fclose(file);
+
+  static bool registered = false;
+  if (!registered) {
+    registered = std::atexit(Tracer::stop) == 0;
+  }
+
+  tracePath = path;
+  active = true;
+  return true;
+}
+
+void Tracer::startFromEnvironment() {
+  const char* path = std::getenv("TINYRENDERER_TRACE");
+  if (path && *path) start(path);
+}
+
+void Tracer::stop() {
+  std::lock_guard<std::mutex> lock(tracesMutex);
+
+  if (!active) return;
+  active = false;
+
+  FILE* file = fopen(tracePath.c_str(), "w");
+  if (!file) {
+    fprintf(stderr, "can't write trace file %s\n", tracePath.c_str());
+    return;
+  }
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  const char* separator = "";
+  size_t count = 0;
+
+  for (std::unique_ptr<ThreadTrace>& trace : traces) {
+    std::lock_guard<std::mutex> threadLock(trace->mutex);
+
+    if (!trace->name.empty()) {
+      fprintf(file,
+              "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"tid\":%d,\"args\":{\"name\":",
+              separator, trace->id);
+      writeJsonString(file, trace->name.c_str());
+      fprintf(file, "}}");
+      separator = ",\n";
+    }
+
+    for (const TraceEvent& event : trace->events) {
+      fprintf(file, "%s{\"name\":", separator);
+      writeJsonString(file, event.name);
+      fprintf(file,
+              ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,"
+              "\"dur\":%lld}",
+              trace->id, event.begin, event.end - event.begin);
+      separator = ",\n";
+    }
+
+    count += trace->events.size();
+    trace->events.clear();
+  }
+
+  fprintf(file, "\n]}\n");
+  fclose(file);
+
+  fprintf(stderr, "trace: %zu zones written to %s\n", count,
+          tracePath.c_str());
+}
+
+long long Tracer::now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - traceEpoch)
+      .count();
+}
+
+void Tracer::record(const char* name, long long begin, long long end) {
+  ThreadTrace& trace = threadTrace();
+
+  std::lock_guard<std::mutex> lock(trace.mutex);
+  trace.events.push_back(TraceEvent{name, begin, end});
+}
+
+void Tracer::setThreadName(const char* name) {
+  if (!enabled()) return;
+
+  ThreadTrace& trace = threadTrace();
+
+  std::lock_guard<std::mutex> lock(trace.mutex);
+  trace.name = name;
+}
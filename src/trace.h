@@ -0,0 +1,57 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <atomic>
+
+// chrome trace-event timeline (chrome://tracing or ui.perfetto.dev). While
+// collection is off every zone costs one relaxed load, build with
+// TINYRENDERER_TRACE=0 to remove the zones completely
+#ifndef TINYRENDERER_TRACE
+#define TINYRENDERER_TRACE 1
+#endif
+
+class Tracer {
+ private:
+  static std::atomic<bool> active;
+
+ public:
+  // starts collecting, the file is written by stop() or at exit
+  static bool start(const char* path);
+  // starts if TINYRENDERER_TRACE=path is set in the environment
+  static void startFromEnvironment();
+  static void stop();
+
+  static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+  static long long now();  // microseconds
+  static void record(const char* name, long long begin, long long end);
+  static void setThreadName(const char* name);
+};
+
+// records its lifetime as a zone of the calling thread
+class TraceScope {
+ private:
+  const char* name;
+  long long begin;
+
+ public:
+  TraceScope(const char* name)
+      : name(name), begin(Tracer::enabled() ? Tracer::now() : -1) {}
+
+  ~TraceScope() {
+    if (begin >= 0) Tracer::record(name, begin, Tracer::now());
+  }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#if TINYRENDERER_TRACE
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_THREAD(name) Tracer::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#endif
+
+#endif  //__TRACE_H__
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+#include "../src/arena.h"
+#include "../src/geometry.h"
+#include "../src/stats.h"
+
+inline void testArenaAlignment() {
+  FrameArena arena;
+
+  char* c = arena.make<char>(3);
+  double* d = arena.make<double>(5);
+  float4* v = arena.make<float4>(2);
+
+  assert(c && d && v);
+  assert((uintptr_t)d % alignof(double) == 0);
+  assert((uintptr_t)v % alignof(float4) == 0);
+  assert(arena.used() == 3 + 5 * sizeof(double) + 2 * sizeof(float4));
+
+  std::cout << "✅ testArenaAlignment passed!\n";
+}
+
+inline void testArenaReset() {
+  FrameArena arena;
+
+  // outgrows the first block, reset merges the blocks into one
+  for (int i = 0; i < 64; i++) arena.make<char>(16 * 1024);
+  size_t capacity = arena.capacity();
+  assert(capacity >= 64 * 16 * 1024);
+
+  arena.reset();
+  assert(arena.used() == 0);
+  assert(arena.capacity() == capacity);
+
+  long allocations = heapAllocationCount();
+  for (int frame = 0; frame < 3; frame++) {
+    for (int i = 0; i < 64; i++) arena.make<char>(16 * 1024);
+    arena.reset();
+  }
+#if TINYRENDERER_STATS
+  assert(heapAllocationCount() == allocations);
+#else
+  (void)allocations;
+#endif
+
+  std::cout << "✅ testArenaReset passed!\n";
+}
+
+inline void testArenaContainers() {
+  FrameArena arena;
+
+  Vec4SoA points(&arena);
+  points.resize(1000);
+  points.w[999] = 1.f;
+  assert(arena.used() >= 4 * 1000 * sizeof(float));
+
+  std::cout << "✅ testArenaContainers passed!\n";
+}
+
+inline void testArena() {
+  testArenaAlignment();
+  testArenaReset();
+  testArenaContainers();
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../src/blocktexture.h"
+#include "../src/imagecompare.h"
+#include "../src/model.h"
+#include "../src/tgaimage.h"
+#include "textureCacheTest.h"
+
+// every texel read through the decoded block cache matches the whole image
+// decoded at once, zero outside
+inline bool sameAsDecoded(const BlockTexture& blocks) {
+  TGAImage decoded = blocks.decode();
+  for (int y = 0; y < blocks.height(); y++) {
+    for (int x = 0; x < blocks.width(); x++) {
+      TGAColor a = blocks.get(x, y), b = decoded.get(x, y);
+      if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2]) return false;
+    }
+  }
+  TGAColor outside = blocks.get(-1, 0);
+  TGAColor below = blocks.get(0, blocks.height());
+  return outside[0] == 0 && outside[2] == 0 && below[1] == 0;
+}
+
+inline void testBlockTextureBc1() {
+  // gradients along both axes at once, about the worst smooth case for one
+  // line of colors per block. Not a multiple of 4 either way
+  TGAImage image(30, 18, TGAImage::RGB);
+  for (int y = 0; y < 18; y++) {
+    for (int x = 0; x < 30; x++) {
+      image.set(x, y, TGAColor(x * 8, y * 12, 200 - x * 3, 255));
+    }
+  }
+
+  BlockTexture blocks(image, BLOCK_BC1);
+  assert(blocks.width() == 30 && blocks.height() == 18);
+  assert(blocks.bytes() == 8 * 8 * 5);
+  assert(sameAsDecoded(blocks));
+
+  TGAImage decoded = blocks.decode();
+  ImageDiff diff = compareImages(decoded, image, 8);
+  assert(diff.sameSize && diff.psnr > 30. && diff.maxDifference <= 24);
+
+  // a color 565 holds exactly comes back exactly
+  TGAImage flat(8, 8, TGAImage::RGB);
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 8; x++) flat.set(x, y, TGAColor(255, 0, 132, 255));
+  }
+  TGAImage flatDecoded = BlockTexture(flat, BLOCK_BC1).decode();
+  assert(compareImages(flatDecoded, flat, 0).maxDifference == 0);
+
+  std::cout << "✅ testBlockTextureBc1 passed!\n";
+}
+
+inline void testBlockTextureBc5() {
+  // a bump, tangent space normals stored as (n + 1) / 2
+  TGAImage image(16, 16, TGAImage::RGB);
+  for (int y = 0; y < 16; y++) {
+    for (int x = 0; x < 16; x++) {
+      Vec3f n = Vec3f((x - 7.5f) / 10.f, (y - 7.5f) / 10.f, 1.f).normalize();
+      image.set(x, y,
+                TGAColor((n.x + 1.f) * 127.5f, (n.y + 1.f) * 127.5f,
+                         (n.z + 1.f) * 127.5f, 255));
+    }
+  }
+
+  BlockTexture blocks(image, BLOCK_BC5);
+  assert(blocks.bytes() == 16 * 4 * 4);
+  assert(sameAsDecoded(blocks));
+
+  // blue comes back from red and green as the unit z
+  float worst = 1.f;
+  for (int y = 0; y < 16; y++) {
+    for (int x = 0; x < 16; x++) {
+      TGAColor a = image.get(x, y), b = blocks.get(x, y);
+      Vec3f na = Vec3f(a[2], a[1], a[0]) * (2.f / 255.f) - Vec3f(1, 1, 1);
+      Vec3f nb = Vec3f(b[2], b[1], b[0]) * (2.f / 255.f) - Vec3f(1, 1, 1);
+      worst = std::min(worst, na.normalize() * nb.normalize());
+    }
+  }
+  assert(worst > 0.999f);
+
+  std::cout << "✅ testBlockTextureBc5 passed!\n";
+}
+
+inline void testBlockTextureModel() {
+  std::string obj =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_blocks.obj")
+          .string();
+  std::string diffuse =
+      writeTestTexture("tinyrenderer_blocks_diffuse.tga", 8, 40);
+  std::ofstream(obj) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n"
+                        "f 1/1/1 2/1/1 3/1/1\n";
+
+  std::ostringstream quiet;
+  std::streambuf* log = std::cerr.rdbuf(quiet.rdbuf());
+  Model plain(obj.c_str()), compressed(obj.c_str());
+  std::cerr.rdbuf(log);
+
+  assert(compressed.textureBytes() == 8 * 8 * 3);
+  compressed.compressTextures();
+  assert(compressed.textureBytes() == 4 * 8);
+
+  // close to the decoded map, and models made from it keep sampling blocks
+  Model part(compressed, {{0, 1, 2}}, {{0, 0, 0}}, {{0, 0, 0}});
+  int worst = 0;
+  for (int i = 0; i < 64; i++) {
+    Vec2f uv((i % 8 + 0.5f) / 8.f, (i / 8 + 0.5f) / 8.f);
+    TGAColor a = plain.getDiffuse(uv), b = compressed.getDiffuse(uv);
+    TGAColor c = part.getDiffuse(uv);
+    for (int channel = 0; channel < 3; channel++) {
+      worst = std::max(worst, std::abs(a[channel] - b[channel]));
+      assert(b[channel] == c[channel]);
+    }
+  }
+  assert(worst <= 24);
+  assert(part.textureBytes() == 4 * 8);
+
+  std::filesystem::remove(obj);
+  std::filesystem::remove(diffuse);
+  std::cout << "✅ testBlockTextureModel passed!\n";
+}
+
+inline void testBlockTexture() {
+  testBlockTextureBc1();
+  testBlockTextureBc5();
+  testBlockTextureModel();
+}
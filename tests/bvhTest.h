@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "../src/bvh.h"
+#include "../src/model.h"
+#include "testModels.h"
+
+// plain Moller-Trumbore over every face, what the bvh has to agree with
+inline float bruteForceHit(Model* model, Vec3f origin, Vec3f direction) {
+  float best = std::numeric_limits<float>::infinity();
+
+  for (int i = 0; i < model->nfaces(); i++) {
+    const std::vector<int>& face = model->face(i);
+    Vec3f a = model->vert(face[0]);
+    Vec3f e1 = model->vert(face[1]) - a;
+    Vec3f e2 = model->vert(face[2]) - a;
+
+    Vec3f p = cross(direction, e2);
+    float det = e1 * p;
+    if (std::abs(det) < 1e-12f) continue;
+
+    Vec3f s = origin - a;
+    float u = (s * p) / det;
+    Vec3f q = cross(s, e1);
+    float v = (direction * q) / det;
+    float t = (e2 * q) / det;
+    if (u >= 0.f && v >= 0.f && u + v <= 1.f && t >= 0.f && t < best) {
+      best = t;
+    }
+  }
+
+  return best;
+}
+
+inline void testBvhIntersect() {
+  Model* model = loadGridModel(16);
+  Bvh bvh;
+  bvh.build(*model);
+  assert(!bvh.empty());
+  assert(bvh.triangles.size() == (size_t)model->nfaces());
+
+  // rays down onto the height field from all around, some of them missing
+  int hits = 0;
+  for (int i = 0; i < 200; i++) {
+    Vec3f origin(std::sin(i * 1.7f) * 1.3f, 2.f, std::cos(i * 2.3f) * 1.3f);
+    Vec3f direction(std::sin(i * 0.9f) * 0.3f, -1.f, 0.2f);
+
+    RayHit hit;
+    bool found = bvh.intersect(origin, direction, hit);
+    float expected = bruteForceHit(model, origin, direction);
+
+    assert(found == std::isfinite(expected));
+    if (!found) continue;
+    hits++;
+    assert(std::abs(hit.t - expected) < 1e-4f);
+
+    // the barycentrics land on the face that was reported
+    const std::vector<int>& face = model->face(hit.face);
+    Vec3f a = model->vert(face[0]);
+    Vec3f point = a + (model->vert(face[1]) - a) * hit.u +
+                  (model->vert(face[2]) - a) * hit.v;
+    assert((point - (origin + direction * hit.t)).norm() < 1e-4f);
+
+    // nothing closer than the hit when t is capped before it
+    RayHit capped;
+    assert(!bvh.intersect(origin, direction, capped, expected * 0.99f));
+  }
+  assert(hits > 50 && hits < 200);
+
+  delete model;
+  std::cout << "✅ testBvhIntersect passed!\n";
+}
+
+inline void testBvhNearestFace() {
+  Model* model = loadGridModel(16);
+  Bvh bvh;
+  bvh.build(*model);
+
+  for (int i = 0; i < 100; i++) {
+    Vec3f point(std::sin(i * 1.3f) * 1.5f, std::cos(i * 0.7f) * 0.8f,
+                std::sin(i * 2.9f) * 1.5f);
+
+    Vec3f closest;
+    int found = bvh.nearestFace(point, closest);
+    assert(found >= 0);
+    float distance = (closest - point).norm();
+
+    // no vertex and no face centre of any face is closer
+    for (int f = 0; f < model->nfaces(); f++) {
+      const std::vector<int>& face = model->face(f);
+      Vec3f centre(0, 0, 0);
+      for (int j = 0; j < 3; j++) {
+        Vec3f v = model->vert(face[j]);
+        assert(distance <= (v - point).norm() + 1e-5f);
+        centre = centre + v * (1.f / 3.f);
+      }
+      assert(distance <= (centre - point).norm() + 1e-5f);
+    }
+
+    // and the point is on the face it came with
+    const std::vector<int>& face = model->face(found);
+    Vec3f a = model->vert(face[0]);
+    Vec3f n = cross(model->vert(face[1]) - a, model->vert(face[2]) - a);
+    assert(std::abs((closest - a) * n.normalize()) < 1e-4f);
+
+    Vec3f none;
+    assert(bvh.nearestFace(point, none, distance * 0.99f) == -1);
+  }
+
+  delete model;
+  std::cout << "✅ testBvhNearestFace passed!\n";
+}
+
+inline void testBvhCullFaces() {
+  Model* model = loadGridModel(32);
+  Bvh bvh;
+  bvh.build(*model);
+
+  // x doubled, only the middle half of the grid is in the clip volume
+  Matrix clip = Matrix::identity(4);
+  clip(0, 0) = 2.f;
+
+  std::vector<int> faces;
+  int culled = bvh.cullFaces(clip, faces);
+  assert(culled > 0);
+  assert(culled + (int)faces.size() == model->nfaces());
+
+  // every face with a corner inside is kept
+  std::vector<bool> kept(model->nfaces(), false);
+  for (int face : faces) kept[face] = true;
+  for (int f = 0; f < model->nfaces(); f++) {
+    for (int j = 0; j < 3; j++) {
+      if (std::abs(model->vert(model->face(f)[j]).x) < 0.5f) assert(kept[f]);
+    }
+  }
+
+  // behind the eye nothing is left
+  clip(3, 3) = -5.f;
+  assert(bvh.cullFaces(clip, faces) == model->nfaces());
+  assert(faces.empty());
+
+  delete model;
+  std::cout << "✅ testBvhCullFaces passed!\n";
+}
+
+inline void testBvhParallelBuild() {
+  Model* model = loadGridModel(64);  // enough faces to split across threads
+  Bvh serial;
+  serial.build(*model, 1);
+  Bvh parallel;
+  parallel.build(*model, 4);
+
+  // the same tree, the threads only change who builds which subtree
+  assert(serial.nodes.size() == parallel.nodes.size());
+  assert(std::memcmp(serial.nodes.data(), parallel.nodes.data(),
+                     serial.nodes.size() * sizeof(BvhNode)) == 0);
+  assert(serial.triangles.size() == parallel.triangles.size());
+  for (size_t i = 0; i < serial.triangles.size(); i++) {
+    assert(serial.triangles[i].face == parallel.triangles[i].face);
+  }
+
+  delete model;
+  std::cout << "✅ testBvhParallelBuild passed!\n";
+}
+
+inline void testBvh() {
+  testBvhIntersect();
+  testBvhNearestFace();
+  testBvhCullFaces();
+  testBvhParallelBuild();
+}
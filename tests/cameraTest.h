@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "../src/camera.h"
+#include "../src/frameclock.h"
+
+inline bool nearVec(Vec3f a, Vec3f b) { return (a - b).norm() < 1e-4f; }
+
+inline void testOrbitCamera() {
+  // the pose it starts from, then a quarter turn around the vertical axis
+  OrbitCamera camera(Vec3f(2, 1, 1), Vec3f(1, 1, 0));
+  assert(std::fabs(camera.distance - std::sqrt(2.f)) < 1e-5f);
+  assert(std::fabs(camera.yaw - M_PI / 4) < 1e-5f);
+  assert(std::fabs(camera.pitch) < 1e-5f);
+  assert(nearVec(camera.eye(), Vec3f(2, 1, 1)));
+  camera.orbit(M_PI / 2, 0.f);
+  assert(nearVec(camera.eye(), Vec3f(2, 1, -1)));
+
+  // straight above, the center stays at the same distance
+  camera.orbit(0.f, 10.f);
+  assert(camera.pitch == 1.5f);
+  Vec3f eye = camera.eye();
+  assert(eye.y > 2.3f && std::fabs((eye - camera.center).norm() -
+                                   camera.distance) < 1e-5f);
+  camera.orbit(0.f, -20.f);
+  assert(camera.pitch == -1.5f);
+
+  camera.zoom(0.01f);
+  assert(camera.distance == 1.05f);
+  camera.zoom(1000.f);
+  assert(camera.distance == 50.f);
+  camera.zoom(0.5f);
+  assert(camera.distance == 25.f);
+
+  std::cout << "✅ testOrbitCamera passed!\n";
+}
+
+inline void testFrameClock() {
+  FrameClock clock;
+  assert(clock.lastFrame() == 0. && clock.averageFrame() == 0.);
+  assert(clock.fps() == 0.);
+
+  clock.pace(20.);
+  assert(clock.elapsed() >= 20.);
+  std::vector<double> frames = {clock.tick()};
+  assert(frames[0] >= 20. && clock.lastFrame() == frames[0]);
+  assert(clock.averageFrame() == frames[0]);
+
+  // the average only covers the last FRAME_HISTORY frames
+  for (int i = 0; i < FRAME_HISTORY; i++) frames.push_back(clock.tick());
+  double sum = 0.;
+  for (size_t i = 1; i < frames.size(); i++) sum += frames[i];
+  assert(clock.lastFrame() == frames.back());
+  assert(std::fabs(clock.averageFrame() - sum / FRAME_HISTORY) < 1e-6);
+  assert(clock.averageFrame() < frames[0]);
+  assert(std::fabs(clock.fps() - 1000. / clock.averageFrame()) < 1e-6);
+
+  std::cout << "✅ testFrameClock passed!\n";
+}
+
+inline void testCamera() {
+  testOrbitCamera();
+  testFrameClock();
+}
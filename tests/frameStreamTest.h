@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/batch.h"
+#include "../src/framestream.h"
+#include "../src/tgaimage.h"
+#include "testModels.h"
+
+inline std::vector<unsigned char> readBytes(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<unsigned char>(std::istreambuf_iterator<char>(in),
+                                    std::istreambuf_iterator<char>());
+}
+
+// a framebuffer in raster coords whose pixels all differ
+inline void fillStreamFrame(TGAImage& frame, int seed) {
+  for (int y = 0; y < frame.get_height(); y++) {
+    for (int x = 0; x < frame.get_width(); x++) {
+      frame.set(x, y, TGAColor(seed * 50 + x, y * 20, x * 30 + y, 200 + x));
+    }
+  }
+}
+
+inline void testFrameStreamOrder() {
+  std::string path =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_stream.rgb")
+          .string();
+  const int W = 5, H = 3;
+
+  // two renderers, each in ascending order, the first one finishing view 1
+  // before the other one starts on view 0
+  {
+    FrameStream stream(path, STREAM_RGB, W, H, 30., 2);
+    assert(stream.isOpen());
+
+    auto renderer = [&](int first) {
+      TGAImage frame(W, H, TGAImage::RGBA);
+      for (int index = first; index < 4; index += 2) {
+        fillStreamFrame(frame, 3 - index);
+        stream.submit(index, frame);
+        assert(frame.get_width() == W && frame.get_height() == H);
+      }
+    };
+    TGAImage early(W, H, TGAImage::RGBA);
+    fillStreamFrame(early, 2);
+    stream.submit(1, early);
+
+    std::thread other(renderer, 0);
+    fillStreamFrame(early, 0);
+    stream.submit(3, early);
+    other.join();
+
+    bool finished = stream.finish();
+    assert(finished);
+    FrameStreamStats stats = stream.stats();
+    assert(stats.frames == 4 && stats.bytes == 4 * W * H * 3);
+  }
+
+  // in index order, top row first, as orientForDisplay would leave them
+  std::vector<unsigned char> bytes = readBytes(path);
+  assert(bytes.size() == 4 * W * H * 3);
+  for (int index = 0; index < 4; index++) {
+    TGAImage expected(W, H, TGAImage::RGBA);
+    fillStreamFrame(expected, 3 - index);
+    orientForDisplay(expected);
+
+    const unsigned char* frame = &bytes[index * W * H * 3];
+    for (int y = 0; y < H; y++) {
+      for (int x = 0; x < W; x++) {
+        TGAColor c = expected.get(x, y);
+        const unsigned char* rgb = &frame[(y * W + x) * 3];
+        assert(rgb[0] == c[2] && rgb[1] == c[1] && rgb[2] == c[0]);
+      }
+    }
+  }
+
+  std::filesystem::remove(path);
+  std::cout << "✅ testFrameStreamOrder passed!\n";
+}
+
+inline void testFrameStreamFormats() {
+  std::string path =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_stream.y4m")
+          .string();
+  const int W = 5, H = 3;
+
+  // gray is y 126 and no chroma, odd sizes round the chroma planes up
+  {
+    FrameStream stream(path, STREAM_Y4M, W, H, 24., 1);
+    TGAImage frame(W, H, TGAImage::RGBA);
+    for (int index = 0; index < 2; index++) {
+      for (int i = 0; i < W * H; i++) {
+        frame.set(i % W, i / W, TGAColor(128, 128, 128, 255));
+      }
+      stream.submit(index, frame);
+    }
+  }
+
+  std::vector<unsigned char> bytes = readBytes(path);
+  std::string header = "YUV4MPEG2 W5 H3 F24000:1000 Ip A1:1 C420jpeg\n";
+  const size_t FRAME_BYTES = 6 + W * H + 2 * 3 * 2;
+  assert(bytes.size() == header.size() + 2 * FRAME_BYTES);
+  assert(!std::memcmp(bytes.data(), header.data(), header.size()));
+  for (int index = 0; index < 2; index++) {
+    const unsigned char* frame = &bytes[header.size() + index * FRAME_BYTES];
+    assert(!std::memcmp(frame, "FRAME\n", 6));
+    for (int i = 0; i < W * H; i++) assert(frame[6 + i] == 126);
+    for (int i = 0; i < 12; i++) assert(frame[6 + W * H + i] == 128);
+  }
+
+  // bgra is the framebuffer bytes reversed in place
+  {
+    FrameStream stream(path, STREAM_BGRA, W, H, 0., 1);
+    TGAImage frame(W, H, TGAImage::RGBA);
+    fillStreamFrame(frame, 1);
+    stream.submit(0, frame);
+  }
+  TGAImage expected(W, H, TGAImage::RGBA);
+  fillStreamFrame(expected, 1);
+  std::vector<unsigned char> raster(expected.buffer(),
+                                    expected.buffer() + W * H * 4);
+  bytes = readBytes(path);
+  assert(bytes.size() == raster.size());
+  for (int i = 0; i < W * H; i++) {
+    assert(!std::memcmp(&bytes[i * 4], &raster[(W * H - 1 - i) * 4], 4));
+  }
+
+  StreamFormat format;
+  assert(parseStreamFormat("rgba", format) && format == STREAM_RGBA);
+  assert(!parseStreamFormat("png", format));
+  FrameStream missing(path + ".missing/frames", STREAM_RGB, W, H, 0., 1);
+  assert(!missing.isOpen());
+
+  std::filesystem::remove(path);
+  std::cout << "✅ testFrameStreamFormats passed!\n";
+}
+
+// a batch reports the views the stream wrote, not the ones it was handed
+inline void testFrameStreamBatch() {
+  std::string path =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_batch.rgb")
+          .string();
+  Model* model = loadGridModel(4);
+  std::vector<CameraPose> poses =
+      turntable(3, Vec3f(0.f, 1.f, 3.f), Vec3f(0.f, 0.f, 0.f));
+
+  BatchOptions options;
+  options.threads = 2;
+  for (int size : {16, 64}) {
+    options.width = size;
+    options.height = size;
+    {
+      FrameStream stream(path, STREAM_RGB, size, size, 0., 2);
+      options.stream = &stream;
+      BatchReport report = renderBatch(*model, poses, options);
+      assert(report.stream.frames == 3 && !report.stream.failed);
+      for (const ViewReport& view : report.views) assert(view.written);
+    }
+    assert(std::filesystem::file_size(path) == (size_t)3 * size * size * 3);
+
+    // a full device fails the final flush of the small frames and the
+    // first write of the large ones, neither counts as written
+    if (!std::filesystem::exists("/dev/full")) continue;
+    FrameStream full("/dev/full", STREAM_RGB, size, size, 0., 2);
+    options.stream = &full;
+    BatchReport report = renderBatch(*model, poses, options);
+    assert(report.stream.failed);
+    for (const ViewReport& view : report.views) assert(!view.written);
+  }
+
+  delete model;
+  std::filesystem::remove(path);
+  std::cout << "✅ testFrameStreamBatch passed!\n";
+}
+
+inline void testFrameStream() {
+  testFrameStreamOrder();
+  testFrameStreamFormats();
+  testFrameStreamBatch();
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include "../src/geometry.h"
+
+inline Vec3SoA batchPoints(int count) {
+  Vec3SoA points;
+  for (int i = 0; i < count; i++) {
+    points.push_back(Vec3f(std::sin(i * 0.3f), std::cos(i * 0.7f) * 2.f,
+                           std::sin(i * 1.1f) - 0.5f));
+  }
+  return points;
+}
+
+inline Matrix batchMatrix() {
+  Matrix m = Matrix::identity(4);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) m(i, j) += std::cos(i * 4.f + j) * 0.3f;
+  }
+  m(3, 0) = 0.f;
+  m(3, 1) = 0.f;
+  m(3, 2) = -0.25f;
+  m(3, 3) = 1.f;
+  return m;
+}
+
+inline void testTransformBatch() {
+  Matrix m = batchMatrix();
+  Vec3SoA points = batchPoints(37);  // not a multiple of any vector width
+
+  Vec4SoA out;
+  transformBatch(m, points, 1.f, out);
+  assert(out.size() == points.size());
+
+  for (int i = 0; i < points.size(); i++) {
+    Vec4f expected = m * Matrix(Vec4f(points[i], 1.f));
+    for (int c = 0; c < 4; c++) assert(out[i][c] == expected[c]);
+  }
+
+  std::cout << "✅ testTransformBatch passed!\n";
+}
+
+inline void testProjectBatch() {
+  Matrix m = batchMatrix();
+  Matrix viewport = Matrix::identity(4);
+  viewport(0, 0) = viewport(0, 3) = 350.f;
+  viewport(1, 1) = viewport(1, 3) = 350.f;
+  viewport(2, 2) = viewport(2, 3) = 127.5f;
+
+  Vec4SoA clip;
+  transformBatch(m, batchPoints(37), 1.f, clip);
+
+  Vec3SoA screen, ndc;
+  projectBatch(clip, viewport, screen, &ndc);
+
+  for (int i = 0; i < clip.size(); i++) {
+    Vec3f expectedNdc = clip[i].hogenize().xyz();
+    Vec3f expectedScreen =
+        Vec4f(viewport * Matrix(clip[i])).hogenize().xyz();
+
+    for (int c = 0; c < 3; c++) {
+      assert(ndc[i][c] == expectedNdc[c]);
+      assert(screen[i][c] == expectedScreen[c]);
+    }
+  }
+
+  std::cout << "✅ testProjectBatch passed!\n";
+}
+
+inline void testParallelBatch() {
+  Matrix m = batchMatrix();
+  Vec3SoA points = batchPoints(100000);
+
+  Vec4SoA serial, parallel;
+  transformBatch(m, points, 0.f, serial, 1);
+  transformBatch(m, points, 0.f, parallel, 4);
+
+  assert(serial.x == parallel.x && serial.y == parallel.y);
+  assert(serial.z == parallel.z && serial.w == parallel.w);
+
+  std::cout << "✅ testParallelBatch passed!\n";
+}
+
+inline void testGeometryBatch() {
+  testTransformBatch();
+  testProjectBatch();
+  testParallelBatch();
+}
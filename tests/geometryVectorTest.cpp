@@ -1,8 +1,97 @@
 #include <cassert>
+#include <cmath>
 #include <iostream>
 
-void testVectorDotProduct() {}
+#include "../src/geometry.h"
 
-void testVectorCrossProduct() {}
+void testVectorDotProduct() {
+  Vec3f a(1.f, 2.f, 3.f);
+  Vec3f b(4.f, -5.f, 6.f);
+  assert(a * b == 12.f);
+  assert(dot(a, b) == 12.f);
 
-void testVectorSum() {}
+  Vec4f c(1.f, 2.f, 3.f, 4.f);
+  assert(c * c == 30.f);
+
+  Vec3i d(1, 2, 3);
+  assert(dot(d, d) == 14);
+
+  std::cout << "✅ testVectorDotProduct passed!\n";
+}
+
+void testVectorCrossProduct() {
+  Vec3f x(1.f, 0.f, 0.f);
+  Vec3f y(0.f, 1.f, 0.f);
+  Vec3f z = x ^ y;
+  assert(z.x == 0.f && z.y == 0.f && z.z == 1.f);
+
+  Vec3f a(0.3f, -1.2f, 2.5f);
+  Vec3f b(-0.7f, 0.4f, 1.1f);
+  Vec3f c = cross(a, b);
+  assert(c.x == a.y * b.z - a.z * b.y);
+  assert(c.y == a.z * b.x - a.x * b.z);
+  assert(c.z == a.x * b.y - a.y * b.x);
+
+  Vec4f w = Vec4f(x, 7.f) ^ Vec4f(y, 1.f);
+  assert(w.z == 1.f && w.w == 7.f);
+
+  std::cout << "✅ testVectorCrossProduct passed!\n";
+}
+
+void testVectorSum() {
+  Vec4f a(1.f, 2.f, 3.f, 4.f);
+  Vec4f b(0.5f, 0.5f, 0.5f, 0.5f);
+  Vec4f sum = a + b;
+  assert(sum.x == 1.5f && sum.w == 4.5f);
+
+  Vec4f difference = a - b;
+  assert(difference.y == 1.5f && difference.w == 3.5f);
+
+  Vec3f scaled = Vec3f(1.f, -2.f, 4.f) * 0.5f;
+  assert(scaled.raw[0] == 0.5f && scaled[1] == -1.f && scaled.z == 2.f);
+
+  std::cout << "✅ testVectorSum passed!\n";
+}
+
+void testVectorNormalize() {
+  Vec3f a(3.f, 4.f, 12.f);
+  Vec3f exact = a;
+  exact.normalize();
+  assert(exact.x == 3.f * (1.f / 13.f));
+
+  Vec3f fast = a;
+  fast.normalizeFast();
+  assert(std::fabs(fast.norm() - 1.f) < 1e-5f);
+
+  Vec4f b(1.f, 1.f, 1.f, 1.f);
+  b.normalize(2.f);
+  assert(b.x == 1.f && b.w == 1.f);
+
+  std::cout << "✅ testVectorNormalize passed!\n";
+}
+
+void testVectorLerpMinMax() {
+  Vec3f a(0.f, 10.f, -4.f);
+  Vec3f b(2.f, 0.f, 4.f);
+
+  Vec3f half = lerp(a, b, 0.5f);
+  assert(half.x == 1.f && half.y == 5.f && half.z == 0.f);
+
+  Vec3f low = componentMin(a, b);
+  Vec3f high = componentMax(a, b);
+  assert(low.x == 0.f && low.y == 0.f && low.z == -4.f);
+  assert(high.x == 2.f && high.y == 10.f && high.z == 4.f);
+
+  Vec4f c = componentMax(Vec4f(1.f, 5.f, 2.f, 0.f), Vec4f(3.f, 4.f, 2.f, 1.f));
+  assert(c.x == 3.f && c.y == 5.f && c.w == 1.f);
+
+  std::cout << "✅ testVectorLerpMinMax passed!\n";
+}
+
+void testGeometryVector() {
+  testVectorDotProduct();
+  testVectorCrossProduct();
+  testVectorSum();
+  testVectorNormalize();
+  testVectorLerpMinMax();
+}
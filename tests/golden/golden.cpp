@@ -0,0 +1,180 @@
+// renders fixed scenes headless and checks them against the reference images
+// in this directory, every scene also has to fit in its time budget
+//
+// TinyRenderer_golden [--update] [--assets dir] [--tolerance N]
+//                     [--budget-scale F] [--out dir]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "../../src/batch.h"
+#include "../../src/bvh.h"
+#include "../../src/geometry.h"
+#include "../../src/gl.h"
+#include "../../src/imagecompare.h"
+#include "../../src/model.h"
+#include "../../src/raycast.h"
+#include "../../src/scene.h"
+#include "../../src/tgaimage.h"
+
+struct GoldenScene {
+  const char* name;
+  Vec3f eye;
+  int size;
+  double budgetMilliseconds;  // unoptimized build, scaled by --budget-scale
+  int shadowMapSize = 0;      // 0 = no shadow pass
+  int samples = 1;            // msaa
+  int instances = 0;          // > 0 renders crowdScene instead
+  int occlusionRays = -1;     // >= 0 casts rays with ray shadows instead
+};
+
+const GoldenScene SCENES[] = {
+    {"front", Vec3f(1, 1, 3), 256, 4000.},
+    {"side", Vec3f(3, 0.5, -0.5), 256, 4000.},
+    {"above", Vec3f(0.5, 2.5, 1.5), 192, 3000.},
+    {"close", Vec3f(0.4, 0.2, 1.4), 320, 8000.},
+    {"shadow", Vec3f(1, 1, 3), 256, 4000., 512},
+    {"msaa4", Vec3f(1, 1, 3), 256, 8000., 0, 4},
+    {"crowd", Vec3f(1, 1, 3), 256, 8000., 512, 1, 9},
+    {"rays", Vec3f(1, 1, 3), 256, 8000., 0, 1, 0, 8},
+};
+
+const double MIN_PSNR = 40.;          // dB
+const double MAX_MISMATCHED = 0.002;  // fraction of the pixels
+const int DEFAULT_TOLERANCE = 8;      // per channel
+
+int main(int argc, char** argv) {
+  bool update = false;
+  std::string assets = ".";
+  std::string out = ".";
+  int tolerance = DEFAULT_TOLERANCE;
+  double budgetScale = 1.;
+
+  if (const char* scale = std::getenv("TINYRENDERER_GOLDEN_BUDGET_SCALE")) {
+    budgetScale = atof(scale);
+  }
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+
+    if (!strcmp(argv[i], "--update")) {
+      update = true;
+    } else if (!strcmp(argv[i], "--assets") && hasValue) {
+      assets = argv[++i];
+    } else if (!strcmp(argv[i], "--out") && hasValue) {
+      out = argv[++i];
+    } else if (!strcmp(argv[i], "--tolerance") && hasValue) {
+      tolerance = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--budget-scale") && hasValue) {
+      budgetScale = atof(argv[++i]);
+    }
+  }
+
+  std::unique_ptr<Model> model;
+  {
+    std::ostringstream quiet;  // loader logs
+    std::streambuf* log = std::cerr.rdbuf(quiet.rdbuf());
+    model.reset(new Model((assets + "/obj/african_head.obj").c_str()));
+    std::cerr.rdbuf(log);
+  }
+
+  if (model->nfaces() == 0) {
+    std::cerr << "can't load " << assets << "/obj/african_head.obj\n";
+    return 1;
+  }
+
+  Bvh bvh;
+  bvh.build(*model);
+
+  int failures = 0;
+
+  for (const GoldenScene& scene : SCENES) {
+    RenderContext ctx(scene.size, scene.size);
+    ctx.model = model.get();
+    ctx.shadow.resize(scene.shadowMapSize);
+    ctx.setSamples(scene.samples);
+
+    CameraPose pose;
+    pose.eye = scene.eye;
+    pose.center = Vec3f(0, 0, 0);
+
+    Scene crowd = crowdScene(model.get(), scene.instances);
+
+    auto start = std::chrono::steady_clock::now();
+    if (scene.instances > 0) {
+      renderScene(ctx, crowd, pose, Vec3f(1., 1., 1.));
+    } else if (scene.occlusionRays >= 0) {
+      RaycastOptions options;
+      options.shadows = true;
+      options.occlusionRays = scene.occlusionRays;
+      raycastView(ctx, bvh, pose, Vec3f(1., 1., 1.), options);
+    } else {
+      renderView(ctx, pose, Vec3f(1., 1., 1.));
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+    orientForDisplay(ctx.framebuffer);
+
+    std::string reference = assets + "/tests/golden/" + scene.name + ".tga";
+
+    if (update) {
+      bool written = ctx.framebuffer.write_tga_file(reference.c_str());
+      std::cout << (written ? "updated " : "FAILED to write ") << reference
+                << "\n";
+      failures += !written;
+      continue;
+    }
+
+    TGAImage expected;
+    {
+      std::ostringstream quiet;
+      std::streambuf* log = std::cerr.rdbuf(quiet.rdbuf());
+      expected.read_tga_file(reference.c_str());
+      std::cerr.rdbuf(log);
+    }
+
+    ImageDiff diff = compareImages(ctx.framebuffer, expected, tolerance);
+    double budget = scene.budgetMilliseconds * budgetScale;
+
+    bool matches = diff.sameSize && diff.psnr >= MIN_PSNR &&
+                   diff.mismatchedFraction() <= MAX_MISMATCHED;
+    bool inBudget = budget <= 0. || milliseconds <= budget;
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "%-6s %s  psnr %6.2f dB  mismatched %5.3f%%  max diff %3d  "
+             "%8.2f ms (budget %.0f ms)%s\n",
+             scene.name, matches && inBudget ? "ok  " : "FAIL", diff.psnr,
+             diff.mismatchedFraction() * 100., diff.maxDifference,
+             milliseconds, budget, inBudget ? "" : " OVER BUDGET");
+    std::cout << line;
+
+    if (!diff.sameSize) {
+      std::cout << "       missing or different size reference " << reference
+                << "\n";
+    }
+
+    if (!matches) {
+      std::string actual = out + "/" + scene.name + "_actual.tga";
+      ctx.framebuffer.write_tga_file(actual.c_str());
+      std::cout << "       rendered image written to " << actual << "\n";
+    }
+
+    failures += !(matches && inBudget);
+  }
+
+  if (failures) {
+    std::cout << failures << " golden scene(s) failed\n";
+    return 1;
+  }
+
+  std::cout << "all golden scenes passed\n";
+  return 0;
+}
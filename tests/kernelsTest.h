@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../src/cpu.h"
+#include "../src/tgaimage.h"
+
+// every supported path has to give bit identical results to the scalar one
+inline void testKernelPathsMatch() {
+  KernelTable reference;
+  scalarKernels(&reference);
+
+  RasterTriangle triangle = {3.5f, 1.25f, 0.021f, -0.013f, -0.008f,
+                             0.027f,  40.f,  120.f,   75.f};
+  const int width = 67;
+
+  std::vector<float> u, v, x, y, z;
+  for (int i = 0; i < 45; i++) {
+    u.push_back(std::sin(i * 0.37f) * 0.6f + 0.5f);
+    v.push_back(std::cos(i * 0.91f) * 0.6f + 0.5f);
+    x.push_back(i * 0.5f - 3.f);
+    y.push_back(std::sin(i * 1.7f));
+    z.push_back(std::cos(i * 0.3f) * 2.f);
+  }
+  u.push_back(0.99f);  // last texel, the gathers must not read past it
+  v.push_back(0.99f);
+  x.push_back(1.f);
+  y.push_back(2.f);
+  z.push_back(3.f);
+
+  float matrix[16];
+  for (int i = 0; i < 16; i++) matrix[i] = std::sin(i + 0.5f);
+
+  unsigned char texels[7 * 5 * 4];
+  for (int i = 0; i < (int)sizeof(texels); i++) texels[i] = i * 37;
+
+  for (int path = CPU_SSE2; path < CPU_PATH_COUNT; path++) {
+    if (!selectCpuPath((CpuPath)path)) continue;
+    const KernelTable& candidate = kernels();
+
+    for (int row = -5; row < 60; row++) {
+      std::vector<float> depthA(width, -1000.f), depthB(width, -1000.f);
+      std::vector<int> xsA(width), xsB(width);
+      std::vector<float> barsA(width * 3), barsB(width * 3);
+
+      int a = reference.rasterRow(&triangle, row, 1, width, depthA.data(),
+                                  xsA.data(), barsA.data());
+      int b = candidate.rasterRow(&triangle, row, 1, width, depthB.data(),
+                                  xsB.data(), barsB.data());
+
+      assert(a == b);
+      assert(depthA == depthB);
+      assert(!memcmp(xsA.data(), xsB.data(), a * sizeof(int)));
+      assert(!memcmp(barsA.data(), barsB.data(), a * 3 * sizeof(float)));
+
+      // the depth only kernel writes exactly what the full one writes
+      std::vector<float> depthC(width, -1000.f);
+      assert(candidate.depthRow(&triangle, row, 1, width, depthC.data()) == a);
+      assert(depthC == depthA);
+    }
+
+    int count = x.size();
+    std::vector<float> outA(count * 4), outB(count * 4);
+    reference.transform(matrix, x.data(), y.data(), z.data(), 1.f, count,
+                        &outA[0], &outA[count], &outA[count * 2],
+                        &outA[count * 3]);
+    candidate.transform(matrix, x.data(), y.data(), z.data(), 1.f, count,
+                        &outB[0], &outB[count], &outB[count * 2],
+                        &outB[count * 3]);
+    assert(outA == outB);
+
+    for (int bytespp : {1, 3, 4}) {
+      std::vector<unsigned char> sampleA(count * 4), sampleB(count * 4);
+      reference.sampleNearest(texels, 7, 5, bytespp, u.data(), v.data(),
+                              count, sampleA.data());
+      candidate.sampleNearest(texels, 7, 5, bytespp, u.data(), v.data(),
+                              count, sampleB.data());
+      assert(sampleA == sampleB);
+    }
+
+    std::cout << "✅ testKernelPathsMatch " << cpuPathName((CpuPath)path)
+              << " passed!\n";
+  }
+
+  selectCpuPath(bestCpuPath());
+}
+
+// Model samples its maps through the kernels, every path has to read the
+// texels TGAImage::get does, zero outside
+inline void testSampleMatchesImage() {
+  for (int bytespp : {1, 3, 4}) {
+    TGAImage image(7, 5, bytespp);
+    for (int i = 0; i < 7 * 5 * bytespp; i++) image.buffer()[i] = i * 37 + 1;
+
+    for (int path = CPU_SCALAR; path < CPU_PATH_COUNT; path++) {
+      if (!selectCpuPath((CpuPath)path)) continue;
+      for (int i = 0; i < 81; i++) {
+        float u = (i % 9) * 0.15f - 0.1f, v = (i / 9) * 0.15f - 0.1f;
+        unsigned char texel[4];
+        kernels().sampleNearest(image.buffer(), 7, 5, bytespp, &u, &v, 1,
+                                texel);
+        TGAColor expected = image.get(int(u * 7), int(v * 5));
+        assert(!memcmp(texel, expected.bgra, 4));
+      }
+    }
+  }
+
+  selectCpuPath(bestCpuPath());
+  std::cout << "✅ testSampleMatchesImage passed!\n";
+}
+
+inline void testKernels() {
+  testKernelPathsMatch();
+  testSampleMatchesImage();
+}
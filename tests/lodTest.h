@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "../src/gl.h"
+#include "../src/lod.h"
+#include "../src/model.h"
+#include "../src/scene.h"
+#include "testModels.h"
+
+// vertices of level on the border of the [-1, 1] grid
+inline int borderVertices(Model* level) {
+  int count = 0;
+  for (int i = 0; i < level->nverts(); i++) {
+    Vec3f v = level->vert(i);
+    if (std::abs(v.x) > 0.999f || std::abs(v.z) > 0.999f) count++;
+  }
+  return count;
+}
+
+inline void testLodLevels() {
+  Model* model = loadGridModel(24);
+  LodOptions options;
+  options.minFaces = 16;
+  options.maxError = 1.f;
+  LodChain chain;
+  buildLods(*model, chain, options);
+
+  assert(chain.level(0) == model);
+  assert(chain.levelCount() > 2);
+  assert((int)chain.errors.size() == chain.levelCount());
+  assert(chain.radius > 1.f);
+
+  for (int i = 1; i < chain.levelCount(); i++) {
+    Model* level = chain.level(i);
+    Model* previous = chain.level(i - 1);
+
+    // each about ratio times the last, the error only grows
+    assert(level->nfaces() < previous->nfaces());
+    assert(level->nfaces() <= previous->nfaces() * 0.9f);
+    assert(chain.errors[i] >= chain.errors[i - 1]);
+
+    // the open border never moves, so all of it is still there
+    assert(borderVertices(level) == 4 * 24);
+
+    for (int f = 0; f < level->nfaces(); f++) {
+      for (int j = 0; j < 3; j++) {
+        assert(level->face(f)[j] < level->nverts());
+        assert(level->texture(f)[j] == 0);
+      }
+    }
+  }
+
+  // a tight error bound stops the run early
+  options.maxError = 1e-4f;
+  LodChain tight;
+  buildLods(*model, tight, options);
+  assert(tight.levelCount() < chain.levelCount());
+
+  delete model;
+  std::cout << "✅ testLodLevels passed!\n";
+}
+
+inline void testLodSeams() {
+  // a flat grid textured in two halves, the middle column has two uvs
+  const int side = 8;
+  std::ostringstream obj;
+  for (int z = 0; z <= side; z++) {
+    for (int x = 0; x <= side; x++) {
+      obj << "v " << -1.f + 2.f * x / side << " 0 " << -1.f + 2.f * z / side
+          << "\n";
+    }
+  }
+  obj << "vt 0 0\nvt 1 1\nvn 0 1 0\n";
+  for (int z = 0; z < side; z++) {
+    for (int x = 0; x < side; x++) {
+      int a = z * (side + 1) + x + 1;
+      int b = a + 1, c = a + side + 1, d = c + 1;
+      int t = x < side / 2 ? 1 : 2;
+      obj << "f " << a << "/" << t << "/1 " << b << "/" << t << "/1 " << d
+          << "/" << t << "/1\n";
+      obj << "f " << a << "/" << t << "/1 " << d << "/" << t << "/1 " << c
+          << "/" << t << "/1\n";
+    }
+  }
+  Model* model = loadObjText(obj.str());
+
+  LodOptions options;
+  options.minFaces = 8;
+  LodChain chain;
+  buildLods(*model, chain, options);
+  assert(chain.levelCount() > 1);
+
+  for (int i = 1; i < chain.levelCount(); i++) {
+    Model* level = chain.level(i);
+    int seam = 0;
+    for (int v = 0; v < level->nverts(); v++) {
+      if (std::abs(level->vert(v).x) < 1e-6f) seam++;
+    }
+    assert(seam == side + 1);
+
+    // no face crosses the seam, each keeps the uv of its half
+    for (int f = 0; f < level->nfaces(); f++) {
+      float sum = 0.f;
+      for (int j = 0; j < 3; j++) sum += level->vert(level->face(f)[j]).x;
+      Vec2f uv = level->textCoord(level->texture(f)[0]);
+      assert((sum < 0.f) == (uv.x == 0.f));
+    }
+  }
+
+  delete model;
+  std::cout << "✅ testLodSeams passed!\n";
+}
+
+inline void testLodCache() {
+  Model* model = loadGridModel(16);
+  LodOptions options;
+  options.minFaces = 16;
+  options.maxError = 1.f;
+  LodChain built;
+  buildLods(*model, built, options);
+
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "tinyrenderer_test.lod";
+  bool saved = saveLodCache(built, options, path.string());
+  assert(saved);
+
+  LodChain loaded;
+  bool fromCache = loadLodCache(*model, loaded, options, path.string());
+  assert(fromCache);
+  assert(loaded.levelCount() == built.levelCount());
+  assert(loaded.errors == built.errors);
+  assert(loaded.corners == built.corners);
+  for (int i = 1; i < loaded.levelCount(); i++) {
+    assert(loaded.level(i)->nfaces() == built.level(i)->nfaces());
+    assert(loaded.level(i)->nverts() == built.level(i)->nverts());
+  }
+
+  // other options, a model moved without changing its counts or a damaged
+  // file are rebuilt instead
+  LodOptions other = options;
+  other.ratio = 0.25f;
+  fromCache = loadLodCache(*model, loaded, other, path.string());
+  assert(!fromCache);
+  Model* edited = loadGridModel(16, 0.3f);
+  assert(edited->nverts() == model->nverts());
+  fromCache = loadLodCache(*edited, loaded, options, path.string());
+  assert(!fromCache);
+  delete edited;
+
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+  fromCache = loadLodCache(*model, loaded, options, path.string());
+  assert(!fromCache);
+  fromCache = loadOrBuildLods(*model, loaded, options, path.string());
+  assert(!fromCache);
+  fromCache = loadOrBuildLods(*model, loaded, options, path.string());
+  assert(fromCache);
+  assert(loaded.corners == built.corners);
+
+  std::filesystem::remove(path);
+  assert(siblingPath("obj/head.obj", ".lod") == "obj/head.lod");
+  assert(siblingPath("obj.d/head", ".pages") == "obj.d/head.pages");
+
+  delete model;
+  std::cout << "✅ testLodCache passed!\n";
+}
+
+inline void testLodSelect() {
+  Model* model = loadGridModel(24);
+  LodOptions options;
+  options.minFaces = 16;
+  options.maxError = 1.f;
+  LodChain chain;
+  buildLods(*model, chain, options);
+
+  CameraPose pose;
+  pose.eye = Vec3f(0.5f, 2.f, 1.5f);
+  pose.center = Vec3f(0, 0, 0);
+
+  // the smaller the image the coarser the level
+  int previous = -1;
+  for (int size : {1024, 256, 64, 16}) {
+    RenderContext ctx(size, size);
+    applyCamera(ctx, pose);
+    int level = chain.select(ctx, Matrix::identity(4), 1.f);
+    assert(level >= previous);
+    previous = level;
+  }
+  assert(previous > 0);
+
+  // a copy scaled down is as good as a smaller image
+  RenderContext ctx(256, 256);
+  applyCamera(ctx, pose);
+  Matrix tenth = instanceMatrix(Vec3f(0, 0, 0), 0.f, 0.1f);
+  int full = chain.select(ctx, Matrix::identity(4), 1.f);
+  int small = chain.select(ctx, tenth, 1.f);
+  assert(small > full);
+  assert(chain.select(ctx, Matrix::identity(4), 0.f) == 0);
+
+  // one small and one full size copy draw at different levels
+  Scene scene;
+  scene.addInstance(model, Matrix::identity(4));
+  scene.addInstance(model, tenth);
+  scene.meshes[0].lods = &chain;
+  ctx.model = model;
+  renderScene(ctx, scene, pose, Vec3f(1, 1, 1));
+  assert(ctx.model == model);
+  assert(ctx.coveredPixels() > 0);
+#if TINYRENDERER_STATS
+  assert(ctx.stats.lodDraws[full] == 1);
+  assert(ctx.stats.lodDraws[small] == 1);
+  assert(ctx.stats.instancesDrawn == 2);
+  assert(ctx.stats.trianglesSubmitted ==
+         chain.level(full)->nfaces() + chain.level(small)->nfaces());
+#endif
+
+  delete model;
+  std::cout << "✅ testLodSelect passed!\n";
+}
+
+inline void testLod() {
+  testLodLevels();
+  testLodSeams();
+  testLodCache();
+  testLodSelect();
+}
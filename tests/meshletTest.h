@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "../src/batch.h"
+#include "../src/gl.h"
+#include "../src/meshlet.h"
+#include "../src/model.h"
+#include "../src/scene.h"
+#include "testModels.h"
+
+inline void testMeshletBuild() {
+  Model* model = loadGridModel(24);
+  MeshletOptions options;
+  Meshlets meshlets;
+  meshlets.build(*model, options);
+  assert(!meshlets.empty());
+
+  // every face in exactly one meshlet
+  std::vector<int> owner(model->nfaces(), -1);
+  for (int i = 0; i < (int)meshlets.meshlets.size(); i++) {
+    const Meshlet& meshlet = meshlets.meshlets[i];
+    assert(meshlet.faceCount > 0 && meshlet.faceCount <= options.maxFaces);
+    assert(meshlet.vertexCount <= options.maxVertices);
+
+    for (int j = 0; j < meshlet.faceCount; j++) {
+      int face = meshlets.faces[meshlet.faceOffset + j];
+      assert(owner[face] < 0);
+      owner[face] = i;
+
+      Vec3f a = model->vert(model->face(face)[0]);
+      Vec3f n = cross(model->vert(model->face(face)[1]) - a,
+                      model->vert(model->face(face)[2]) - a)
+                    .normalize();
+      float sine = meshlet.coneCutoff;
+      assert(sine >= 1.f ||
+             n * meshlet.coneAxis >= std::sqrt(1.f - sine * sine) - 1e-5f);
+
+      // the corners are copies inside the meshlet's own range, of the
+      // vertex and normal the face has
+      for (int k = 0; k < 3; k++) {
+        int copy = meshlets.corners[face * 6 + k];
+        assert(copy >= meshlet.vertexOffset &&
+               copy < meshlet.vertexOffset + meshlet.vertexCount);
+        assert(meshlets.vertexIds[copy] == model->face(face)[k]);
+        Vec3f p = meshlets.positions[copy];
+        assert((p - model->vert(model->face(face)[k])).norm() == 0.f);
+        assert((p - meshlet.center).norm() <= meshlet.radius + 1e-5f);
+
+        int normal = meshlets.corners[face * 6 + 3 + k];
+        assert(normal >= meshlet.normalOffset &&
+               normal < meshlet.normalOffset + meshlet.normalCount);
+        assert(meshlets.normalIds[normal] ==
+               model->vertexNomalsIds(face)[k]);
+      }
+    }
+  }
+  for (int face = 0; face < model->nfaces(); face++) assert(owner[face] >= 0);
+
+  // tighter limits, more meshlets
+  options.maxFaces = 16;
+  Meshlets small;
+  small.build(*model, options);
+  assert(small.meshlets.size() > meshlets.meshlets.size());
+  for (const Meshlet& meshlet : small.meshlets) {
+    assert(meshlet.faceCount <= 16);
+  }
+
+  delete model;
+  std::cout << "✅ testMeshletBuild passed!\n";
+}
+
+inline void testMeshletCull() {
+  Model* model = loadGridModel(24, 0.f);  // flat, every face looks down
+  Meshlets meshlets;
+  meshlets.build(*model);
+  int count = meshlets.meshlets.size();
+
+  CameraPose above;
+  above.eye = Vec3f(0.2f, 2.f, 0.5f);
+  above.center = Vec3f(0, 0, 0);
+  CameraPose below = above;
+  below.eye.y = -2.f;
+
+  RenderContext ctx(64, 64);
+  applyCamera(ctx, above);
+  Matrix clip = ctx.Projection * ctx.ModelView;
+  std::vector<int> visible;
+
+  assert(meshlets.cull(clip, false, visible) == 0);
+  assert((int)visible.size() == count);
+
+  // seen from above every face turns away, from below none does
+  assert(meshlets.cull(clip, true, visible) == model->nfaces());
+  assert(visible.empty());
+  applyCamera(ctx, below);
+  clip = ctx.Projection * ctx.ModelView;
+  assert(meshlets.cull(clip, true, visible) == 0);
+
+  // moved far to the side nothing is in view, split over threads or not
+  Matrix away = clip * instanceMatrix(Vec3f(50, 0, 0), 0.f);
+  assert(meshlets.cull(away, false, visible, 3) == model->nfaces());
+  assert(visible.empty());
+
+  // half of it off screen, the same meshlets on any thread count. One face
+  // each so there are enough of them to split
+  MeshletOptions single;
+  single.maxFaces = 1;
+  Meshlets faces;
+  faces.build(*model, single);
+  Matrix half = clip * instanceMatrix(Vec3f(1.2f, 0, 0), 0.f);
+  faces.cull(half, false, visible, 1);
+  std::vector<int> threaded;
+  faces.cull(half, false, threaded, 4);
+  assert(visible == threaded);
+  assert(!visible.empty() && (int)visible.size() < model->nfaces());
+
+  delete model;
+  std::cout << "✅ testMeshletCull passed!\n";
+}
+
+inline void testMeshletDraw() {
+  Model* model = loadGridModel(24);
+  MeshletOptions options;
+  options.maxFaces = 4;  // enough meshlets for threads to split
+  Meshlets meshlets;
+  meshlets.build(*model, options);
+
+  CameraPose pose;
+  pose.eye = Vec3f(0.5f, -2.f, 1.5f);
+  pose.center = Vec3f(0, 0, 0);
+
+  // the same image with every face shaded from its meshlet's copies, with
+  // a shadow pass and over several threads
+  for (int threads : {1, 3}) {
+    RenderContext faces(64, 48), clusters(64, 48);
+    faces.model = clusters.model = model;
+    faces.shadow.resize(128);
+    clusters.shadow.resize(128);
+    clusters.meshlets = &meshlets;
+    clusters.meshletThreads = threads;
+
+    renderView(faces, pose, Vec3f(1, 1, 1));
+    renderView(clusters, pose, Vec3f(1, 1, 1));
+
+    assert(faces.coveredPixels() > 0);
+    assert(faces.zbuffer == clusters.zbuffer);
+    assert(!std::memcmp(faces.framebuffer.buffer(),
+                        clusters.framebuffer.buffer(), 64 * 48 * 4));
+#if TINYRENDERER_STATS
+    // the corners of the grid are off screen
+    assert(clusters.stats.meshletsCulled > 0);
+    assert(clusters.stats.meshletsDrawn + clusters.stats.meshletsCulled ==
+           (long)meshlets.meshlets.size());
+    assert(clusters.stats.trianglesSubmitted + clusters.stats.facesCulled ==
+           model->nfaces());
+#endif
+  }
+
+  // instances off screen are dropped whole
+  Scene scene;
+  scene.addInstance(model, Matrix::identity(4));
+  scene.addInstance(model, instanceMatrix(Vec3f(50, 0, 0), 0.f));
+  scene.meshes[0].meshlets = &meshlets;
+  RenderContext ctx(64, 48);
+  renderScene(ctx, scene, pose, Vec3f(1, 1, 1));
+  assert(ctx.coveredPixels() > 0);
+#if TINYRENDERER_STATS
+  assert(ctx.stats.instancesDrawn == 1);
+  assert(ctx.stats.instancesCulled == 1);
+  assert(ctx.stats.facesCulled >= model->nfaces());
+#endif
+
+  delete model;
+  std::cout << "✅ testMeshletDraw passed!\n";
+}
+
+inline void testMeshlet() {
+  testMeshletBuild();
+  testMeshletCull();
+  testMeshletDraw();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "../src/model.h"
+#include "testModels.h"
+
+inline bool sameModel(Model& a, Model& b) {
+  if (a.nverts() != b.nverts() || a.nfaces() != b.nfaces()) return false;
+  for (int i = 0; i < a.nverts(); i++) {
+    if ((a.vert(i) - b.vert(i)).norm() != 0.f) return false;
+  }
+  for (int i = 0; i < a.nfaces(); i++) {
+    if (a.face(i) != b.face(i) || a.texture(i) != b.texture(i) ||
+        a.vertexNomalsIds(i) != b.vertexNomalsIds(i)) {
+      return false;
+    }
+    for (int j = 0; j < (int)a.face(i).size(); j++) {
+      Vec2f ta = a.textCoord(a.texture(i)[j]);
+      Vec2f tb = b.textCoord(b.texture(i)[j]);
+      Vec3f na = a.vertexNomal(a.vertexNomalsIds(i)[j]);
+      Vec3f nb = b.vertexNomal(b.vertexNomalsIds(i)[j]);
+      if (ta.x != tb.x || ta.y != tb.y || (na - nb).norm() != 0.f) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// a height field written row by row, each row of faces right after the
+// vertices it needs, with ids counting back when relative is set. Large
+// enough to be parsed in several chunks, the relative ids reach into the
+// chunks before
+inline std::string rowsObjText(int side, bool relative) {
+  std::ostringstream obj;
+  obj << "# rows\r\n";
+  long written = 0;
+
+  for (int z = 0; z <= side; z++) {
+    for (int x = 0; x <= side; x++) {
+      float u = (float)x / side, v = (float)z / side;
+      obj << "v " << u << " " << u * v << " " << v << "\n";
+      obj << "vt " << u << " " << v << "\nvn 0 1 " << v << "\n";
+      written++;
+    }
+    if (z == 0) continue;
+
+    for (int x = 0; x < side; x++) {
+      long a = (z - 1) * (side + 1) + x + 1;
+      long ids[4] = {a, a + 1, a + side + 2, a + side + 1};
+      obj << "f";
+      for (long id : ids) {
+        if (relative) id -= written + 1;
+        obj << " " << id << "/" << id << "/" << id;
+      }
+      obj << "\n";
+    }
+  }
+  return obj.str();
+}
+
+inline void testModelParse() {
+  // split over any number of threads, the same model as on one
+  std::string text = rowsObjText(120, false);
+  std::unique_ptr<Model> serial(loadObjText(text, 1));
+  assert(serial->nverts() == 121 * 121 && serial->nfaces() == 120 * 120);
+  assert(serial->face(0).size() == 4);
+  for (int threads : {2, 3, 7, 0}) {
+    std::unique_ptr<Model> parallel(loadObjText(text, threads));
+    assert(sameModel(*serial, *parallel));
+  }
+
+  // ids counting back get the same vertices, across chunk borders too
+  std::string relativeText = rowsObjText(120, true);
+  for (int threads : {1, 4}) {
+    std::unique_ptr<Model> relative(loadObjText(relativeText, threads));
+    assert(sameModel(*serial, *relative));
+  }
+
+  // no newline at the end, blank and unknown lines
+  std::unique_ptr<Model> small(loadObjText(
+      "o tri\n\nv 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0.25 0.5\nvn 0 0 1\n"
+      "s off\nf 1/1/1 2/1/1 -1/-1/-1",
+      4));
+  assert(small->nverts() == 3 && small->nfaces() == 1);
+  assert(small->face(0)[2] == 2 && small->texture(0)[2] == 0);
+  assert(small->textCoord(0).x == 0.25f);
+
+  std::cout << "✅ testModelParse passed!\n";
+}
+
+inline void testModel() { testModelParse(); }
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+
+#include "../src/gl.h"
+
+// flat white, counts how often it runs
+struct CountingShader : IShader {
+  int calls = 0;
+
+  Vec3f vertex(int, int) override { return Vec3f(); }
+
+  bool fragment(Vec4f, TGAColor& color) override {
+    calls++;
+    color = TGAColor(255, 255, 255, 255);
+    return false;
+  }
+};
+
+inline void testMsaaSampleCounts() {
+  RenderContext ctx(4, 4);
+
+  ctx.setSamples(3);
+  assert(ctx.samples == 2);
+  assert(ctx.sampleColor.size() == 2 * 16);
+
+  ctx.setSamples(16);
+  assert(ctx.samples == 8);
+  assert(ctx.sampleDepth.size() == 8 * 16);
+
+  ctx.setSamples(1);
+  assert(ctx.samples == 1 && ctx.sampleColor.empty());
+
+  std::cout << "✅ testMsaaSampleCounts passed!\n";
+}
+
+inline void testMsaaSharedShading() {
+  RenderContext ctx(16, 16);
+  CountingShader shader;
+  ctx.shader = &shader;
+  ctx.setSamples(4);
+  ctx.clear();
+
+  // the diagonal of the whole viewport, its edge cuts through pixel samples
+  Vec3f points[3] = {Vec3f(0, 0, 10), Vec3f(16, 0, 10), Vec3f(0, 16, 10)};
+  drawTriangle(ctx, points);
+  resolveSamples(ctx);
+
+  // one shade per pixel, however many of its samples are covered
+  assert(shader.calls == ctx.coveredPixels());
+#if TINYRENDERER_STATS
+  assert(shader.calls == ctx.stats.fragmentsShaded);
+  assert(ctx.stats.samplesCovered > ctx.stats.fragmentsShaded);
+  assert(ctx.stats.samplesCovered <= 4 * ctx.stats.fragmentsShaded);
+#endif
+
+  // inside, on the edge and outside
+  assert(ctx.framebuffer.get(2, 2)[0] == 255);
+  int edge = ctx.framebuffer.get(8, 8)[0];
+  assert(edge > 0 && edge < 255);
+  assert(ctx.framebuffer.get(14, 14)[0] == 0);
+  assert(ctx.framebuffer.get(14, 14)[3] == 255);
+
+  // the nearest sample depth lands in the zbuffer
+  assert(ctx.zbuffer[2 + 2 * 16] == 10.f);
+
+  std::cout << "✅ testMsaaSharedShading passed!\n";
+}
+
+inline void testMsaa() {
+  testMsaaSampleCounts();
+  testMsaaSharedShading();
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/batch.h"
+#include "../src/gl.h"
+#include "../src/model.h"
+#include "../src/paged.h"
+#include "testModels.h"
+
+inline std::string pagedTestPath(const char* name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// texture loading complains about the missing files
+inline bool openQuietly(PagedModel& paged, const std::string& pages,
+                        const std::string& obj, long budget) {
+  std::ostringstream quiet;
+  std::streambuf* log = std::cerr.rdbuf(quiet.rdbuf());
+  bool opened = paged.open(pages, obj, budget);
+  std::cerr.rdbuf(log);
+  return opened;
+}
+
+// the corners of every face by position, sorted, to compare meshes whatever
+// their order and ids
+inline std::vector<std::array<float, 9> > faceCorners(Model& model) {
+  std::vector<std::array<float, 9> > faces;
+  for (int f = 0; f < model.nfaces(); f++) {
+    std::array<float, 9> face;
+    for (int k = 0; k < 3; k++) {
+      Vec3f v = model.vert(model.face(f)[k]);
+      for (int i = 0; i < 3; i++) face[k * 3 + i] = v.raw[i];
+    }
+    faces.push_back(face);
+  }
+  std::sort(faces.begin(), faces.end());
+  return faces;
+}
+
+inline void testPagedConvert() {
+  std::string obj = pagedTestPath("tinyrenderer_paged.obj");
+  std::string pages = pagedTestPath("tinyrenderer_paged.pages");
+  std::ofstream(obj) << gridObjText(32);
+  Model* model = loadGridModel(32);
+
+  // buffers, blocks and chunks far smaller than the model
+  PagingOptions options;
+  options.memoryBudget = 16 << 10;
+  options.chunkFaces = 100;
+  options.readBlock = 100;
+  bool converted = convertToPages(obj, pages, options);
+  assert(converted);
+
+  PagedModel paged;
+  bool opened = openQuietly(paged, pages, obj, 1L << 30);
+  assert(opened);
+  assert(paged.faceCount() == model->nfaces());
+  assert(paged.chunkCount() > model->nfaces() / 100);
+
+  // every face in one chunk, inside its box
+  PipelineStats stats;
+  std::vector<std::array<float, 9> > faces;
+  for (int i = 0; i < paged.chunkCount(); i++) {
+    const PagedChunk& chunk = paged.chunk(i);
+    std::shared_ptr<Model> part = paged.pageIn(i, stats);
+    assert(part && part->nfaces() == chunk.faces && chunk.faces <= 100);
+    assert(part->nverts() == chunk.vertices);
+
+    for (int v = 0; v < part->nverts(); v++) {
+      for (int a = 0; a < 3; a++) {
+        assert(part->vert(v).raw[a] >= chunk.min.raw[a]);
+        assert(part->vert(v).raw[a] <= chunk.max.raw[a]);
+      }
+    }
+    std::vector<std::array<float, 9> > more = faceCorners(*part);
+    faces.insert(faces.end(), more.begin(), more.end());
+  }
+  std::sort(faces.begin(), faces.end());
+  assert(faces == faceCorners(*model));
+#if TINYRENDERER_STATS
+  assert(stats.chunksPagedIn == paged.chunkCount());
+#endif
+
+  // a changed obj makes the pages stale, they get converted again
+  std::ofstream(obj, std::ios::app) << "# changed\n";
+  PagedModel stale;
+  opened = openQuietly(stale, pages, obj, 1L << 30);
+  assert(!opened);
+  std::ostringstream quiet;
+  std::streambuf* log = std::cerr.rdbuf(quiet.rdbuf());
+  PagesStatus status = openOrConvertPages(stale, obj, pages, options);
+  assert(status == PAGES_CONVERTED);
+  assert(stale.chunkCount() == paged.chunkCount());
+  PagedModel again;
+  status = openOrConvertPages(again, obj, pages, options);
+  assert(status == PAGES_OPENED);
+  PagedModel missing;
+  status = openOrConvertPages(missing, obj + ".missing", pages + ".missing",
+                              options);
+  std::cerr.rdbuf(log);
+  assert(status == PAGES_FAILED);
+
+  // a quad with negative ids is split in two, a face without normals gets
+  // its own
+  std::ofstream(obj) << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nvt 0.5 0.5\n"
+                        "vn 0 0 1\nf -4/1/1 -3/1/1 -2/1/1 -1/1/1\nf 1 3 2\n";
+  converted = convertToPages(obj, pages, options);
+  PagedModel polygons;
+  opened = openQuietly(polygons, pages, obj, 1L << 30);
+  assert(converted && opened);
+  assert(polygons.faceCount() == 3 && polygons.chunkCount() == 1);
+  std::shared_ptr<Model> part = polygons.pageIn(0, stats);
+  assert(part->nfaces() == 3 && part->nverts() == 4);
+  Vec3f flat = part->vertexNomal(part->vertexNomalsIds(2)[0]);
+  assert(flat.z < -0.99f);
+  assert(part->textCoord(part->texture(0)[0]).x == 0.5f);
+
+  delete model;
+  std::filesystem::remove(obj);
+  std::filesystem::remove(pages);
+  std::cout << "✅ testPagedConvert passed!\n";
+}
+
+inline void testPagedRender() {
+  std::string obj = pagedTestPath("tinyrenderer_paged.obj");
+  std::string pages = pagedTestPath("tinyrenderer_paged.pages");
+  std::ofstream(obj) << gridObjText(32);
+  Model* model = loadGridModel(32);
+
+  PagingOptions options;
+  options.chunkFaces = 64;
+  bool converted = convertToPages(obj, pages, options);
+  PagedModel paged;
+  bool opened = openQuietly(paged, pages, obj, 1L << 30);
+  assert(converted && opened);
+
+  CameraPose pose;
+  pose.eye = Vec3f(0.5f, -2.f, 1.5f);
+  pose.center = Vec3f(0, 0, 0);
+
+  // the same depth, colors differ at most where chunks meet and the first
+  // of two faces on an edge wins
+  RenderContext whole(64, 48), chunks(64, 48);
+  whole.model = model;
+  chunks.shadow.resize(128);
+  whole.shadow.resize(128);
+  renderView(whole, pose, Vec3f(1, 1, 1));
+  renderPaged(chunks, paged, pose, Vec3f(1, 1, 1));
+
+  assert(whole.coveredPixels() > 0);
+  assert(whole.zbuffer == chunks.zbuffer);
+  const uint32_t* a = (const uint32_t*)whole.framebuffer.buffer();
+  const uint32_t* b = (const uint32_t*)chunks.framebuffer.buffer();
+  int differ = 0;
+  for (int i = 0; i < 64 * 48; i++) differ += a[i] != b[i];
+  assert(differ < 64 * 48 / 50);
+
+  // a large budget keeps the chunks in view, the next frame reads nothing
+  renderPaged(chunks, paged, pose, Vec3f(1, 1, 1));
+  assert(whole.zbuffer == chunks.zbuffer);
+#if TINYRENDERER_STATS
+  assert(chunks.stats.chunksPagedIn == 0);
+  long drawn = chunks.stats.trianglesSubmitted;
+#endif
+  paged.evictAll();
+  assert(paged.residentBytes() == 0);
+  renderPaged(chunks, paged, pose, Vec3f(1, 1, 1));
+#if TINYRENDERER_STATS
+  long inView = chunks.stats.chunksPagedIn;
+  assert(inView > 1 && chunks.stats.pageInBytes > 0);
+#endif
+
+  // a budget under one chunk keeps only the one drawn last. The shadow pass
+  // ends with the nearest one, the color pass starts with it, every other
+  // chunk in view is read for both passes and none stays held
+  paged.setMemoryBudget(1);
+  renderPaged(chunks, paged, pose, Vec3f(1, 1, 1));
+  long resident = paged.residentBytes();
+  assert(resident > 0 && resident < 64 * 200);
+  assert(paged.heldBytes() == resident);
+  assert(whole.zbuffer == chunks.zbuffer);
+#if TINYRENDERER_STATS
+  assert(chunks.stats.chunksPagedIn == 2 * inView - 1);
+  assert(chunks.stats.residentBytes == resident);
+  assert(chunks.stats.heldBytes == resident);
+  assert(chunks.stats.trianglesSubmitted == drawn);
+#endif
+
+  // evicted chunks a caller still holds count as held until released
+  PipelineStats stats;
+  std::shared_ptr<Model> held = paged.pageIn(0, stats);
+  paged.pageIn(1, stats);
+  assert(paged.heldBytes() > paged.residentBytes());
+  held.reset();
+  assert(paged.heldBytes() == paged.residentBytes());
+  paged.setMemoryBudget(1L << 30);
+  paged.evictAll();
+
+  // moved away nothing is paged in
+  CameraPose away = pose;
+  away.center = away.eye * 2.f;
+  renderPaged(chunks, paged, away, Vec3f(1, 1, 1));
+  assert(chunks.coveredPixels() == 0 && paged.residentBytes() == 0);
+
+  // workers share the pages, the frames match a single one
+  BatchOptions batch;
+  batch.width = 64;
+  batch.height = 48;
+  batch.threads = 3;
+  batch.paged = &paged;
+  batch.outputPrefix = pagedTestPath("tinyrenderer_paged");
+  paged.setMemoryBudget(2000);
+  BatchReport report =
+      renderBatch(*model, std::vector<CameraPose>(3, pose), batch);
+  for (const ViewReport& view : report.views) {
+    assert(view.faces == model->nfaces());
+    assert(view.coveredPixels == whole.coveredPixels());
+    std::filesystem::remove(view.filename);
+  }
+
+  delete model;
+  std::filesystem::remove(obj);
+  std::filesystem::remove(pages);
+  std::cout << "✅ testPagedRender passed!\n";
+}
+
+inline void testPaged() {
+  testPagedConvert();
+  testPagedRender();
+}
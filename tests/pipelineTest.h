@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <thread>
+
+#include "../src/pipeline.h"
+#include "testModels.h"
+
+inline void testPipelineOrder() {
+  std::unique_ptr<Model> model(loadGridModel(2));
+
+  // each frame keeps the x of its pose in its first pixel
+  FramePipeline pipeline(*model, 4, 4, 2,
+                         [](RenderContext& ctx, const CameraPose& pose) {
+                           unsigned char x = pose.eye.x;
+                           ctx.framebuffer.set(0, 0, TGAColor(x, 0, 0, 255));
+                         });
+  assert(pipeline.getQueueDepth() == 2);
+  assert(!pipeline.acquire(true) && !pipeline.acquire(false));
+
+  // a thread submitting while this one presents, frames come back in order
+  // and only the queue depth plus the one on screen ever exist
+  const int COUNT = 8;
+  std::thread submitter([&] {
+    for (int i = 0; i < COUNT; i++) {
+      CameraPose pose;
+      pose.eye = Vec3f(10.f * i, 0.f, 1.f);
+      bool queued = pipeline.submit(pose, true);
+      assert(queued);
+    }
+  });
+
+  std::set<Frame*> seen;
+  int presented = 0;
+  while (presented < COUNT) {
+    Frame* frame = pipeline.acquire(true);
+    if (!frame) {
+      std::this_thread::yield();  // the next pose isn't submitted yet
+      continue;
+    }
+    assert(frame->sequence == presented);
+    assert(frame->pose.eye.x == 10.f * presented);
+    assert(frame->context.framebuffer.get(0, 0).bgra[2] == 10 * presented);
+    seen.insert(frame);
+    pipeline.release(frame);
+    presented++;
+  }
+  submitter.join();
+  assert(seen.size() <= 3);
+
+  // drained, nothing left to wait for
+  assert(!pipeline.acquire(true) && !pipeline.acquire(false));
+
+  std::cout << "✅ testPipelineOrder passed!\n";
+}
+
+inline void testPipelineShutdown() {
+  std::unique_ptr<Model> model(loadGridModel(2));
+
+  std::atomic<bool> started(false), go(false);
+  std::atomic<int> renders(0);
+  std::unique_ptr<FramePipeline> pipeline(new FramePipeline(
+      *model, 4, 4, 1, [&](RenderContext&, const CameraPose&) {
+        started = true;
+        while (!go) std::this_thread::yield();
+        renders++;
+      }));
+
+  // one pose rendering and one waiting fill a depth of 1, the next is
+  // dropped without wait
+  CameraPose pose;
+  bool queued = pipeline->submit(pose, false);
+  assert(queued);
+  while (!started) std::this_thread::yield();
+  queued = pipeline->submit(pose, false);
+  assert(queued);
+  queued = pipeline->submit(pose, false);
+  assert(!queued);
+  assert(!pipeline->acquire(false));
+
+  // shut down with the frame still rendering: it finishes, the waiting
+  // pose is never rendered
+  std::thread closer([&] { pipeline.reset(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  go = true;
+  closer.join();
+  assert(renders == 1);
+
+  std::cout << "✅ testPipelineShutdown passed!\n";
+}
+
+inline void testPipelineOverlap() {
+  std::unique_ptr<Model> model(loadGridModel(2));
+
+  // each render waits a while for a present to be under way, and counts
+  // the ones it saw
+  std::atomic<bool> presenting(false);
+  std::atomic<int> overlapped(0);
+  auto render = [&](RenderContext&, const CameraPose&) {
+    auto until =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    while (!presenting && std::chrono::steady_clock::now() < until) {
+      std::this_thread::yield();
+    }
+    if (presenting) overlapped++;
+  };
+  FramePipeline pipeline(*model, 4, 4, 1, render);
+
+  // the loop of the interactive window: one pose in flight, the next one
+  // submitted before the frame before it is presented
+  const int COUNT = 6;
+  CameraPose pose;
+  bool queued = pipeline.submit(pose, true);
+  assert(queued);
+  for (int i = 0; i < COUNT; i++) {
+    Frame* frame = pipeline.acquire(true);
+    assert(frame && frame->sequence == i);
+    queued = pipeline.submit(pose, true);
+    assert(queued);
+
+    presenting = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    presenting = false;
+    pipeline.release(frame);
+  }
+
+  // all but the first frame, rendered before anything was on screen
+  Frame* last = pipeline.acquire(true);
+  assert(last && overlapped >= COUNT);
+  pipeline.release(last);
+
+  std::cout << "✅ testPipelineOverlap passed!\n";
+}
+
+inline void testPipeline() {
+  testPipelineOrder();
+  testPipelineOverlap();
+  testPipelineShutdown();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "../src/batch.h"
+#include "../src/bvh.h"
+#include "../src/gl.h"
+#include "../src/model.h"
+#include "../src/raycast.h"
+#include "testModels.h"
+
+inline void testIntersectPacket() {
+  Model* model = loadGridModel(16);
+  Bvh bvh;
+  bvh.build(*model);
+
+  // packets of neighbouring rays down onto the grid, like camera rays
+  for (int i = 0; i < 64; i++) {
+    RayPacket packet;
+    packet.active = i % 16 == 0 ? 0x5 : 0xf;  // some with lanes off
+    Vec3f origins[4], directions[4];
+
+    for (int lane = 0; lane < 4; lane++) {
+      origins[lane] = Vec3f(0.1f, 2.f, 0.2f);
+      directions[lane] = Vec3f(std::sin(i * 0.7f) * 0.6f + lane * 0.01f, -1.f,
+                               std::cos(i * 1.3f) * 0.6f - lane * 0.02f);
+      packet.set(lane, origins[lane], directions[lane]);
+    }
+
+    RayHit hits[4];
+    int mask = bvh.intersectPacket(packet, hits);
+    assert((mask & ~packet.active) == 0);
+
+    for (int lane = 0; lane < 4; lane++) {
+      if (!(packet.active & (1 << lane))) {
+        assert(hits[lane].face == -1);
+        continue;
+      }
+
+      RayHit single;
+      bool found = bvh.intersect(origins[lane], directions[lane], single);
+      assert(found == (bool)(mask & (1 << lane)));
+      if (!found) continue;
+      assert(std::abs(hits[lane].t - single.t) < 1e-5f);
+      assert(hits[lane].face == single.face);
+    }
+  }
+
+  // a limit in front of every hit leaves nothing
+  RayPacket packet;
+  for (int lane = 0; lane < 4; lane++) {
+    packet.set(lane, Vec3f(lane * 0.1f, 2.f, 0.f), Vec3f(0.f, -1.f, 0.f));
+  }
+  RayHit hits[4];
+  assert(bvh.intersectPacket(packet, hits, 1.f) == 0);
+  assert(bvh.intersectPacket(packet, hits) == 0xf);
+
+  delete model;
+  std::cout << "✅ testIntersectPacket passed!\n";
+}
+
+inline void testRaycastMatchesRaster() {
+  Model* model = loadGridModel(8);
+  Bvh bvh;
+  bvh.build(*model);
+
+  CameraPose pose;
+  pose.eye = Vec3f(0.5f, 2.f, 1.5f);
+  pose.center = Vec3f(0, 0, 0);
+
+  RenderContext raster(48, 40);
+  raster.model = model;
+  renderView(raster, pose, Vec3f(1, 1, 1));
+
+  RaycastOptions options;
+  options.threads = 1;
+  RenderContext rays(48, 40);
+  rays.model = model;
+  raycastView(rays, bvh, pose, Vec3f(1, 1, 1), options);
+
+  RenderContext empty(1, 1);
+  empty.clear();
+  float far = empty.zbuffer[0];
+
+  // same pixels covered at the same depths, up to the odd one on an edge
+  int differentCoverage = 0;
+  for (int i = 0; i < 48 * 40; i++) {
+    bool rasterCovered = raster.zbuffer[i] != far;
+    bool rayCovered = rays.zbuffer[i] != far;
+    if (rasterCovered != rayCovered) {
+      differentCoverage++;
+    } else if (rayCovered) {
+      assert(std::abs(rays.zbuffer[i] - raster.zbuffer[i]) < 0.5f);
+    }
+  }
+  assert(rays.coveredPixels() > 48 * 40 / 2);
+  assert(differentCoverage <= 48 * 40 / 100);
+
+#if TINYRENDERER_STATS
+  assert(rays.stats.cameraRays == 48 * 40);
+  assert(rays.stats.fragmentsShaded == rays.coveredPixels());
+#endif
+
+  // odd tiles over several threads give the same image
+  options.threads = 3;
+  options.tileSize = 6;
+  options.occlusionRays = 5;
+  options.shadows = true;
+  RenderContext single(48, 40);
+  single.model = model;
+  raycastView(rays, bvh, pose, Vec3f(1, 1, 1), options);
+  options.threads = 1;
+  raycastView(single, bvh, pose, Vec3f(1, 1, 1), options);
+
+  assert(rays.zbuffer == single.zbuffer);
+  assert(!std::memcmp(rays.framebuffer.buffer(), single.framebuffer.buffer(),
+                 48 * 40 * 4));
+#if TINYRENDERER_STATS
+  assert(rays.stats.secondaryRays == single.stats.secondaryRays);
+  assert(rays.stats.secondaryRays == rays.coveredPixels() * 6);
+#endif
+
+  delete model;
+  std::cout << "✅ testRaycastMatchesRaster passed!\n";
+}
+
+inline void testRaycast() {
+  testIntersectPacket();
+  testRaycastMatchesRaster();
+}
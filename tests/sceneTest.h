@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include "../src/gl.h"
+#include "../src/model.h"
+#include "../src/scene.h"
+#include "testModels.h"
+
+// counts the instances and vertices it is asked for
+struct InstanceCountingShader : IShader {
+  int instances = 0;
+  int vertices = 0;
+  Matrix last = Matrix::identity(4);
+
+  void setInstance(const Matrix& transform) override {
+    instances++;
+    last = transform;
+  }
+
+  Vec3f vertex(int, int idVert) override {
+    vertices++;
+    return Vec3f(idVert == 1 ? 8 : 1, idVert == 2 ? 8 : 1, 10);
+  }
+
+  bool fragment(Vec4f, TGAColor& color) override {
+    color = TGAColor(255, 255, 255, 255);
+    return false;
+  }
+};
+
+inline void testInstanceMatrix() {
+  Matrix m = instanceMatrix(Vec3f(1, 2, 3), M_PI / 2, 2.f);
+  Vec4f p = m * Matrix(Vec4f(1, 1, 0, 1));
+
+  // x turns to -z, then everything doubles and moves
+  assert(std::abs(p.x - 1.f) < 1e-5f);
+  assert(std::abs(p.y - 4.f) < 1e-5f);
+  assert(std::abs(p.z - 1.f) < 1e-5f);
+
+  std::cout << "✅ testInstanceMatrix passed!\n";
+}
+
+inline void testSceneInstances() {
+  // one triangle reaching 1 from the origin
+  Model* model = loadObjText("v 1 0 0\nv 0 1 0\nv 0 0 1\nvt 0 0\nvn 0 0 1\n"
+                             "f 1/1/1 2/1/1 3/1/1\n");
+  assert(model->nfaces() == 1);
+
+  Scene scene = crowdScene(model, 9);
+  assert(scene.meshes.size() == 1);
+  assert(scene.instanceCount() == 9);
+  assert(scene.triangleCount() == 9);
+  assert(scene.addMesh(model) == 0);
+
+  // a third of the size, the corner copies stay inside the model's room
+  float radius = scene.boundingRadius(Vec3f(0, 0, 0));
+  assert(radius > 0.9f && radius < 1.4f);
+
+  RenderContext ctx(16, 16);
+  InstanceCountingShader shader;
+  ctx.model = model;
+  ctx.shader = &shader;
+
+  const SceneMesh& mesh = scene.meshes[0];
+  drawInstanced(ctx, mesh.transforms.data(), mesh.transforms.size());
+
+  // the vertex stage runs again per instance on the same single face
+  assert(shader.instances == 9);
+  assert(shader.vertices == 9 * 3);
+  assert(shader.last(0, 3) == mesh.transforms[8](0, 3));
+#if TINYRENDERER_STATS
+  assert(ctx.stats.instancesDrawn == 9);
+  assert(ctx.stats.trianglesSubmitted == 9);
+#endif
+
+  delete model;
+  std::cout << "✅ testSceneInstances passed!\n";
+}
+
+inline void testScene() {
+  testInstanceMatrix();
+  testSceneInstances();
+}
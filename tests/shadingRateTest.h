@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+
+#include "../src/gl.h"
+
+// white, or a steep ramp along the second barycentric, counts its runs
+struct RampShader : IShader {
+  int calls = 0;
+  bool ramp = false;
+
+  Vec3f vertex(int, int) override { return Vec3f(); }
+
+  bool fragment(Vec4f bar, TGAColor& color) override {
+    calls++;
+    unsigned char value = ramp ? (int)(bar.y * 16 * 255) % 256 : 255;
+    color = TGAColor(value, value, value, 255);
+    return false;
+  }
+};
+
+// shader runs and covered pixels of a 32x32 right triangle
+inline int drawRated(int rate, int threshold, bool ramp, long& covered) {
+  RenderContext ctx(32, 32);
+  RampShader shader;
+  shader.ramp = ramp;
+  ctx.shader = &shader;
+  ctx.shadingRate = rate;
+  ctx.rateThreshold = threshold;
+
+  Vec3f points[3] = {Vec3f(0, 0, 10), Vec3f(32, 0, 10), Vec3f(0, 32, 10)};
+  drawTriangle(ctx, points);
+
+  covered = ctx.coveredPixels();
+  return shader.calls;
+}
+
+inline void testShadingRate() {
+  long fullCovered, coarseCovered, covered;
+  int full = drawRated(1, 0, false, fullCovered);
+  assert(full == fullCovered);
+
+  // a quarter of the shades, or a bit more along the edge, same coverage
+  int coarse = drawRated(2, 0, false, coarseCovered);
+  assert(coarseCovered == fullCovered);
+  assert(coarse < full / 3);
+  assert(drawRated(4, 0, false, covered) < coarse / 3);
+
+  // flat color passes the check with two shades per block, the ramp does not
+  int flat = drawRated(2, 4, false, covered);
+  assert(flat > coarse && flat < full / 2 + coarse);
+  assert(drawRated(2, 4, true, covered) > full * 9 / 10);
+
+  std::cout << "✅ testShadingRate passed!\n";
+}
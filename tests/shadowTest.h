@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cassert>
+#include <iostream>
+
+#include "../src/gl.h"
+
+inline void testShadowLookup() {
+  ShadowMap shadow;
+  shadow.resize(8);
+  shadow.bias = 0.5f;
+  shadow.pcf = 0;
+
+  // an occluder at depth 100 over the left half
+  for (int y = 0; y < 8; y++) {
+    for (int x = 0; x < 4; x++) shadow.depth[x + y * 8] = 100.f;
+  }
+
+  assert(shadow.lit(Vec3f(1.5f, 2.5f, 50.f)) == 0.f);   // behind it
+  assert(shadow.lit(Vec3f(1.5f, 2.5f, 99.8f)) == 1.f);  // within the bias
+  assert(shadow.lit(Vec3f(5.5f, 2.5f, 50.f)) == 1.f);   // nothing above
+  assert(shadow.lit(Vec3f(-3.f, 2.5f, 50.f)) == 1.f);   // off the map
+
+  shadow.pcf = 1;  // 3x3 taps across the edge, one column is lit
+  float edge = shadow.lit(Vec3f(3.5f, 2.5f, 50.f));
+  assert(edge > 0.33f && edge < 0.34f);
+
+  std::cout << "✅ testShadowLookup passed!\n";
+}
+
+inline void testShadow() { testShadowLookup(); }
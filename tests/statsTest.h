@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "../src/stats.h"
+
+inline void testStatsCounters() {
+  PipelineStats stats;
+  STATS_ADD(stats, trianglesSubmitted, 3);
+  STATS_ADD(stats, depthPasses, 8);
+  {
+    STATS_TIMER(stats, STAGE_RASTER);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+
+#if TINYRENDERER_STATS
+  assert(stats.trianglesSubmitted == 3 && stats.depthPasses == 8);
+  assert(stats.stageMilliseconds[STAGE_RASTER] >= 1.);
+  assert(stats.totalMilliseconds() == stats.stageMilliseconds[STAGE_RASTER]);
+  assert(stats.overdraw(4) == 2. && stats.overdraw(0) == 0.);
+#else
+  // compiled away, the counters and timers stay at zero
+  assert(stats.trianglesSubmitted == 0 && stats.depthPasses == 0);
+  assert(stats.totalMilliseconds() == 0.);
+#endif
+
+  // sums the counters and timers, keeps the largest of the sizes
+  PipelineStats other;
+  other.trianglesSubmitted = 2;
+  other.lodDraws[1] = 5;
+  other.residentBytes = 100;
+  other.stageMilliseconds[STAGE_SHADE] = 1.5;
+  stats.residentBytes = 40;
+  stats += other;
+  assert(stats.trianglesSubmitted == 2 + 3 * TINYRENDERER_STATS);
+  assert(stats.lodDraws[1] == 5 && stats.residentBytes == 100);
+  assert(stats.stageMilliseconds[STAGE_SHADE] == 1.5);
+
+  stats.reset();
+  assert(stats.trianglesSubmitted == 0 && stats.totalMilliseconds() == 0.);
+
+  // operator new calls are only counted with countingallocator.h
+  long before = heapAllocationCount();
+  std::unique_ptr<int> allocated(new int(1));
+  assert(heapAllocationCount() == before + TINYRENDERER_STATS);
+
+  std::cout << "✅ testStatsCounters passed!\n";
+}
+
+inline void testStatsPrint() {
+  assert(std::string(stageName(STAGE_PAGE_IN)) == "paging");
+  assert(std::string(stageName(STAGE_COUNT)) == "?");
+
+  PipelineStats stats;
+  stats.trianglesSubmitted = 12;
+  stats.depthPasses = 30;
+  stats.shadowTriangles = 4;
+  stats.stageMilliseconds[STAGE_VERTEX] = 0.5;
+  std::ostringstream out;
+  stats.print(out, 10);
+  std::string text = out.str();
+
+#if TINYRENDERER_STATS
+  // the optional lines only for the features that ran
+  assert(text.find("tris 12 submitted") != std::string::npos);
+  assert(text.find("overdraw 3.00") != std::string::npos);
+  assert(text.find(" vertex 0.50") != std::string::npos);
+  assert(text.find("shadow 4 tris") != std::string::npos);
+  assert(text.find("meshlets") == std::string::npos);
+  assert(text.find("chunks in") == std::string::npos);
+#else
+  assert(text.empty());
+#endif
+
+  std::cout << "✅ testStatsPrint passed!\n";
+}
+
+inline void testStats() {
+  testStatsCounters();
+  testStatsPrint();
+}
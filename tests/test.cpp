@@ -1,6 +1,50 @@
+#include "../src/countingallocator.h"
+#include "arenaTest.h"
+#include "blockTextureTest.h"
+#include "bvhTest.h"
+#include "cameraTest.h"
+#include "frameStreamTest.h"
+#include "geometryBatchTest.h"
 #include "geometryMatrixTest.h"
+#include "kernelsTest.h"
+#include "lodTest.h"
+#include "meshletTest.h"
+#include "modelTest.h"
+#include "msaaTest.h"
+#include "pagedTest.h"
+#include "pipelineTest.h"
+#include "raycastTest.h"
+#include "sceneTest.h"
+#include "shadingRateTest.h"
+#include "shadowTest.h"
+#include "statsTest.h"
+#include "textureCacheTest.h"
+#include "traceTest.h"
+
+void testGeometryVector();  // geometryVectorTest.cpp
 
 int main() {
+  testStats();
+  testKernels();
+  testGeometryBatch();
+  testGeometryVector();
+  testArena();
+  testShadow();
+  testMsaa();
+  testShadingRate();
+  testScene();
+  testBvh();
+  testRaycast();
+  testLod();
+  testMeshlet();
+  testPaged();
+  testModel();
+  testTextureCache();
+  testBlockTexture();
+  testFrameStream();
+  testPipeline();
+  testTrace();
+  testCamera();
   testGeometryMatrix();
   std::cout << "All tests passed!\n";
   return 0;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../src/model.h"
+
+// Model only loads files, obj goes through a temporary one. No textures,
+// parsed on threads (0 = one per core)
+inline Model* loadObjText(const std::string& obj, int threads = 0) {
+  std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "tinyrenderer_test.obj";
+  std::ofstream(path) << obj;
+
+  std::ostringstream quiet;
+  std::streambuf* log = std::cerr.rdbuf(quiet.rdbuf());
+  Model* model = new Model(path.string().c_str(), true, threads);
+  std::cerr.rdbuf(log);
+
+  std::filesystem::remove(path);
+  return model;
+}
+
+// side x side quads of a wavy height field over [-1, 1] on the xz plane, its
+// faces turn counter clockwise seen from below
+inline std::string gridObjText(int side, float height = 0.2f) {
+  std::ostringstream obj;
+
+  for (int z = 0; z <= side; z++) {
+    for (int x = 0; x <= side; x++) {
+      float u = -1.f + 2.f * x / side;
+      float v = -1.f + 2.f * z / side;
+      float y = height * std::sin(4.f * u) * std::cos(3.f * v);
+      obj << "v " << u << " " << y << " " << v << "\n";
+    }
+  }
+  obj << "vt 0 0\nvn 0 1 0\n";
+
+  for (int z = 0; z < side; z++) {
+    for (int x = 0; x < side; x++) {
+      int a = z * (side + 1) + x + 1;  // obj indices start at 1
+      int b = a + 1;
+      int c = a + side + 1;
+      int d = c + 1;
+      obj << "f " << a << "/1/1 " << b << "/1/1 " << d << "/1/1\n";
+      obj << "f " << a << "/1/1 " << d << "/1/1 " << c << "/1/1\n";
+    }
+  }
+
+  return obj.str();
+}
+
+inline Model* loadGridModel(int side, float height = 0.2f) {
+  return loadObjText(gridObjText(side, height));
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/model.h"
+#include "../src/texturecache.h"
+#include "../src/tgaimage.h"
+
+// a size x size tga filled with shade, written without rle
+inline std::string writeTestTexture(const char* name, int size,
+                                    unsigned char shade) {
+  std::string path =
+      (std::filesystem::temp_directory_path() / name).string();
+  TGAImage image(size, size, TGAImage::RGB);
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      image.set(x, y, TGAColor(shade, x * 10, y * 10, 255));
+    }
+  }
+  image.write_tga_file(path.c_str(), false);
+  return path;
+}
+
+inline void testTextureCacheSharing() {
+  std::string a = writeTestTexture("tinyrenderer_cache_a.tga", 8, 10);
+  std::string b = writeTestTexture("tinyrenderer_cache_b.tga", 8, 10);
+
+  std::ostringstream quiet;
+  std::streambuf* log = std::cout.rdbuf(quiet.rdbuf());
+  std::streambuf* errors = std::cerr.rdbuf(quiet.rdbuf());
+
+  TextureCache cache;
+  bool decoded = false;
+  std::shared_ptr<TGAImage> first = cache.load(a, &decoded);
+  assert(first && decoded);
+  assert(first->get_width() == 8 && first->get_bytespp() == 3);
+
+  // by path, then the same bytes under another path
+  std::shared_ptr<TGAImage> again = cache.load(a, &decoded);
+  assert(again == first && !decoded);
+  std::shared_ptr<TGAImage> copy = cache.load(b, &decoded);
+  assert(copy == first && !decoded);
+
+  TextureCacheStats stats = cache.stats();
+  assert(stats.misses == 1 && stats.hits == 2 && stats.contentHits == 1);
+  assert(stats.textures == 1 && stats.bytes == 8 * 8 * 3);
+
+  // a changed file is decoded again, the old texture stays with its users
+  writeTestTexture("tinyrenderer_cache_a.tga", 4, 20);
+  std::shared_ptr<TGAImage> changed = cache.load(a, &decoded);
+  assert(changed != first && decoded && changed->get_width() == 4);
+  assert(first->get_width() == 8);
+
+  assert(!cache.load(a + ".missing"));
+
+  // threads loading one new file at once all get the texture kept first
+  std::string rle =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_cache_rle.tga")
+          .string();
+  first->write_tga_file(rle.c_str(), true);
+  std::vector<std::shared_ptr<TGAImage> > loaded(4);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&, i] { loaded[i] = cache.load(rle); });
+  }
+  for (std::thread& thread : threads) thread.join();
+  stats = cache.stats();
+  assert(stats.misses == 3 && stats.textures == 3);
+  for (int i = 0; i < 4; i++) {
+    assert(loaded[i] && loaded[i] == loaded[0]);
+  }
+  assert(loaded[0]->get_width() == 8);
+  assert(loaded[0]->get(3, 5).bgra[2] == first->get(3, 5).bgra[2]);
+
+  std::cout.rdbuf(log);
+  std::cerr.rdbuf(errors);
+  std::filesystem::remove(a);
+  std::filesystem::remove(b);
+  std::filesystem::remove(rle);
+  std::cout << "✅ testTextureCacheSharing passed!\n";
+}
+
+inline void testTextureCacheEviction() {
+  std::string paths[3] = {
+      writeTestTexture("tinyrenderer_cache_0.tga", 8, 1),
+      writeTestTexture("tinyrenderer_cache_1.tga", 8, 2),
+      writeTestTexture("tinyrenderer_cache_2.tga", 8, 3)};
+
+  std::ostringstream quiet;
+  std::streambuf* log = std::cout.rdbuf(quiet.rdbuf());
+  std::streambuf* errors = std::cerr.rdbuf(quiet.rdbuf());
+
+  // room for two, the least recently used one without users goes
+  TextureCache cache(2 * 8 * 8 * 3);
+  std::shared_ptr<TGAImage> held = cache.load(paths[0]);
+  cache.load(paths[1]);
+  cache.load(paths[0]);
+  cache.load(paths[2]);
+  TextureCacheStats stats = cache.stats();
+  assert(stats.evictions == 1 && stats.textures == 2);
+
+  bool decoded = false;
+  cache.load(paths[0], &decoded);
+  assert(!decoded);
+  cache.load(paths[1], &decoded);
+  assert(decoded);
+
+  // a texture in use is never dropped, even over the budget
+  cache.setBudget(0);
+  stats = cache.stats();
+  assert(stats.textures == 1 && stats.bytes == 8 * 8 * 3);
+  cache.load(paths[0], &decoded);
+  assert(!decoded);
+  held.reset();
+  cache.clear();
+  assert(cache.stats().textures == 0 && cache.stats().bytes == 0);
+
+  // models with the same textures share them through the global cache
+  std::string obj =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_cache.obj")
+          .string();
+  std::string diffuse = writeTestTexture("tinyrenderer_cache_diffuse.tga", 8,
+                                         4);
+  std::ofstream(obj) << "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n"
+                        "f 1/1/1 2/1/1 3/1/1\n";
+  long hits = TextureCache::global().stats().hits;
+  {
+    Model a(obj.c_str()), b(obj.c_str());
+    assert(TextureCache::global().stats().hits == hits + 1);
+    assert(a.getDiffuse(Vec2f(0.f, 0.f)).bgra[2] == 4);
+  }
+
+  std::cout.rdbuf(log);
+  std::cerr.rdbuf(errors);
+  for (const std::string& path : paths) std::filesystem::remove(path);
+  std::filesystem::remove(obj);
+  std::filesystem::remove(diffuse);
+  std::cout << "✅ testTextureCacheEviction passed!\n";
+}
+
+inline void testTextureCache() {
+  testTextureCacheSharing();
+  testTextureCacheEviction();
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cassert>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../src/trace.h"
+
+// skips one json value of text at i, false when it isn't one
+inline bool skipJson(const std::string& text, size_t& i) {
+  auto space = [&] {
+    while (i < text.size() && std::isspace((unsigned char)text[i])) i++;
+  };
+  auto string = [&] {
+    if (text[i++] != '"') return false;
+    while (i < text.size() && text[i] != '"') i += text[i] == '\\' ? 2 : 1;
+    return i++ < text.size();
+  };
+
+  space();
+  if (i >= text.size()) return false;
+  char c = text[i];
+  if (c == '{' || c == '[') {
+    char close = c == '{' ? '}' : ']';
+    i++;
+    space();
+    bool first = true;
+    while (i >= text.size() || text[i] != close) {
+      if (!first && (i >= text.size() || text[i++] != ',')) return false;
+      first = false;
+      if (c == '{') {
+        space();
+        if (i >= text.size() || !string()) return false;
+        space();
+        if (i >= text.size() || text[i++] != ':') return false;
+      }
+      if (!skipJson(text, i)) return false;
+      space();
+    }
+    i++;
+    return true;
+  }
+  if (c == '"') return string();
+  size_t start = i;
+  while (i < text.size() &&
+         (std::isalnum((unsigned char)text[i]) || text[i] == '-' ||
+          text[i] == '+' || text[i] == '.')) {
+    i++;
+  }
+  return i > start;
+}
+
+inline size_t countOf(const std::string& text, const std::string& part) {
+  size_t count = 0;
+  for (size_t at = text.find(part); at != std::string::npos;
+       at = text.find(part, at + 1)) {
+    count++;
+  }
+  return count;
+}
+
+inline void testTrace() {
+  std::string path =
+      (std::filesystem::temp_directory_path() / "tinyrenderer_trace.json")
+          .string();
+
+  // zones only count while collecting, including the one begun before
+  assert(!Tracer::enabled());
+  { TraceScope zone("disabled zone"); }
+  std::unique_ptr<TraceScope> straddling(new TraceScope("straddling zone"));
+
+  assert(!Tracer::start((path + ".missing/trace.json").c_str()));
+  bool started = Tracer::start(path.c_str());
+  assert(started && Tracer::enabled());
+  assert(!Tracer::start(path.c_str()));
+  straddling.reset();
+
+  {
+    TraceScope outer("test zone");
+    { TraceScope inner("test inner zone"); }
+    { TraceScope quoted("say \"hi\" \\ tab\t"); }
+  }
+  std::thread worker([] {
+    Tracer::setThreadName("test worker");
+    TraceScope zone("test worker zone");
+  });
+  worker.join();
+  Tracer::stop();
+  assert(!Tracer::enabled());
+
+  std::ifstream in(path);
+  std::string text((std::istreambuf_iterator<char>(in)),
+                   std::istreambuf_iterator<char>());
+  size_t i = 0;
+  bool valid = skipJson(text, i);
+  while (i < text.size() && std::isspace((unsigned char)text[i])) i++;
+  assert(valid && i == text.size());
+
+  // names are escaped, the json stays valid
+  assert(countOf(text, "\"ph\":\"X\"") == 4);
+  assert(countOf(text, "\"say \\\"hi\\\" \\\\ tab\\u0009\"") == 1);
+  assert(countOf(text, "\"test zone\"") == 1);
+  assert(countOf(text, "\"test inner zone\"") == 1);
+  assert(countOf(text, "\"test worker zone\"") == 1);
+  assert(countOf(text, "\"thread_name\"") == 1);
+  assert(countOf(text, "\"test worker\"") == 1);
+  assert(countOf(text, "disabled zone") == 0);
+  assert(countOf(text, "straddling zone") == 0);
+
+  // stopped, nothing more is recorded or written
+  { TraceScope zone("stopped zone"); }
+  Tracer::stop();
+  std::ifstream again(path);
+  std::string after((std::istreambuf_iterator<char>(again)),
+                    std::istreambuf_iterator<char>());
+  assert(after == text);
+
+  std::filesystem::remove(path);
+  std::cout << "✅ testTrace passed!\n";
+}